@@ -20,8 +20,47 @@ public class Runner {
     protected native static void internalRun(long native_runnable,
                                              boolean is_auto_delete);
 
+    protected native static void onTimer();
+
     public native static String failureDetails(int index);
 
+    // 和JniProgressListener::EventType一一对应
+    static final int EVENT_RUNNER_START = 0;
+    static final int EVENT_RUNNER_END = 1;
+    static final int EVENT_TEST_START = 2;
+    static final int EVENT_FAILURE_ADD = 3;
+    static final int EVENT_TEST_END = 4;
+
+    // 每个事件在values中占的元素个数：类型和3个参数
+    static final int EVENT_STRIDE = 4;
+
+    // 由JniProgressListener在主线程上调用，把一批进度事件按顺序分发给listener，
+    // names中对应用例名（EVENT_TEST_START、EVENT_TEST_END）或者文件名（EVENT_FAILURE_ADD）
+    public static void dispatchProgress(ProgressListener listener, int[] values, String[] names) {
+        for (int index = 0; index < names.length; ++index) {
+            int offset = index * EVENT_STRIDE;
+            switch (values[offset]) {
+                case EVENT_RUNNER_START:
+                    listener.onRunnerStart(values[offset + 1]);
+                    break;
+                case EVENT_RUNNER_END:
+                    listener.onRunnerEnd(values[offset + 1]);
+                    break;
+                case EVENT_TEST_START:
+                    listener.onTestStart(names[index]);
+                    break;
+                case EVENT_FAILURE_ADD:
+                    listener.onFailureAdd(values[offset + 1], 0 != values[offset + 2], names[index], values[offset + 3]);
+                    break;
+                case EVENT_TEST_END:
+                    listener.onTestEnd(names[index], values[offset + 1], values[offset + 2], values[offset + 3]);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
     public static void asyncRunOnMainThread(long native_runnable, boolean is_auto_delete) {
         final long final_native_runnable = native_runnable;
         final boolean final_is_auto_delete = is_auto_delete;
@@ -52,4 +91,18 @@ public class Runner {
             }
         }, delay_ms);
     }
+
+    // 原生层时间轮的系统定时器：只保留一个延迟任务，重新设置时取消之前的
+    private static final Handler timerHandler = new Handler(Looper.getMainLooper());
+    private static final Runnable timerTask = new Runnable() {
+        @Override
+        public void run() {
+            onTimer();
+        }
+    };
+
+    public static void armTimer(long delay_ms) {
+        timerHandler.removeCallbacks(timerTask);
+        timerHandler.postDelayed(timerTask, delay_ms);
+    }
 }
@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#define TEST_CONFIG_FILE "test_config.xml"
+
+class TestConfig
+{
+public:
+	static TestConfig* GetInstance();
+
+	virtual bool Load() = 0;
+	virtual const char* GetTitle() = 0;
+	virtual unsigned int GetWorkerCount() = 0;
+	virtual const char* GetDurationHistoryFile() = 0;
+	virtual bool GetProcessIsolation() = 0;
+	virtual bool GetAsyncDispatch() = 0;
+	virtual const char* GetBaselineFile() = 0;
+	virtual const char* GetBaselineOutputFile() = 0;
+	virtual unsigned int GetRegressionThreshold() = 0;
+	virtual const char* GetEventStream() = 0;
+	virtual unsigned int GetTotalShards() = 0;
+	virtual unsigned int GetShardIndex() = 0;
+	virtual bool GetShardByDuration() = 0;
+	virtual unsigned int GetFailureRetention() = 0;
+};
@@ -0,0 +1,441 @@
+﻿#include "TestConfigImpl.h"
+#include "TestManifest.h"
+
+#include "cutest/Runner.h"
+#include "src/gtest-internal-inl.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+TestConfig* TestConfig::GetInstance()
+{
+	static TestConfigImpl s_testConfig;
+	return &s_testConfig;
+}
+
+TestConfigImpl::TestConfigImpl()
+	: m_workerCount(0)
+	, m_processIsolation(false)
+	, m_asyncDispatch(false)
+	, m_regressionThreshold(10)
+	, m_totalShards(0)
+	, m_shardIndex(0)
+	, m_shardByDuration(false)
+	, m_failureRetention(0)
+{}
+
+void TestConfigImpl::LoadFailedMsg(const std::string& libName)
+{
+	// 没有界面可以弹框，直接输出到stderr
+	const char* error = ::dlerror();
+	::fprintf(stderr, "%s load failed!!!\ninfo : %s\n",
+			  libName.c_str(), error ? error : "unknown");
+}
+
+void TestConfigImpl::MakeAbsolute(const std::string& dirPath, std::string& path)
+{
+	// 相对路径以配置文件所在的文件夹为准
+	if (!path.empty() && '/' != path[0])
+	{
+		path = dirPath + "/" + path;
+	}
+}
+
+bool TestConfigImpl::IsLibrarySelected(const TestManifest& manifest, const std::string& libPath)
+{
+	// 清单中没有记录、测试库有变化或者用例在加载之后才知道名字时，都要加载
+	const TestManifest::Library* library = manifest.Find(libPath);
+	if (!library || library->opaque)
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < library->tests.size(); ++i)
+	{
+		const std::string& name = library->tests[i];
+		std::string::size_type dot = name.find('.');
+		std::string suiteName = name.substr(0, dot);
+		std::string testName = (std::string::npos == dot) ? std::string() : name.substr(dot + 1);
+
+		// 只看--gtest_filter，不能用TestSuite::isSelected()：它会把用例分给分片，每个用例只能分配一次
+		if (testing::internal::UnitTestOptions::FilterMatchesTest(suiteName, testName))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void TestConfigImpl::LoadLibraries(const std::vector<std::string>& libNames, const std::vector<std::string>& libPaths)
+{
+	TestManifest manifest;
+	std::vector<bool> selected(libPaths.size(), true);
+	if (!m_manifestFile.empty())
+	{
+		// 先创建Runner，它会解析--gtest_filter等命令行参数，之后才能判断用例是否会被执行
+		CUTEST_NS::Runner::instance();
+		manifest.Load(m_manifestFile);
+		for (size_t i = 0; i < libPaths.size(); ++i)
+		{
+			selected[i] = IsLibrarySelected(manifest, libPaths[i]);
+		}
+	}
+
+	// 先让内核把所有测试库预读到page cache，dlopen时就不用逐个等待磁盘
+	for (size_t i = 0; i < libPaths.size(); ++i)
+	{
+		if (!selected[i])
+		{
+			continue;
+		}
+
+		int fd = ::open(libPaths[i].c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd >= 0)
+		{
+			::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			::close(fd);
+		}
+	}
+
+	// glibc的dlopen（包括测试库中注册用例的静态构造函数）持有全局的加载锁，多线程加载并不会更快，
+	// 所以按配置文件中的顺序逐个加载，用例的注册顺序也因此是确定的
+	std::vector<std::string> loadedPaths;
+	for (size_t i = 0; i < libPaths.size(); ++i)
+	{
+		if (!selected[i])
+		{
+			continue;
+		}
+
+		if (::dlopen(libPaths[i].c_str(), RTLD_NOW | RTLD_GLOBAL))
+		{
+			loadedPaths.push_back(libPaths[i]);
+		}
+		else
+		{
+			TestConfigImpl::LoadFailedMsg(libNames[i]);
+		}
+	}
+
+	if (!m_manifestFile.empty())
+	{
+		manifest.Update(loadedPaths);
+		manifest.Retain(libPaths);
+		if (!manifest.Save(m_manifestFile))
+		{
+			::fprintf(stderr, "Failed to save the test manifest to %s\n", m_manifestFile.c_str());
+		}
+	}
+}
+
+bool TestConfigImpl::GetAttribute(const std::string& element, const char* name, std::string& value)
+{
+	std::string key = std::string(" ") + name + "=";
+	std::string::size_type pos = element.find(key);
+	if (std::string::npos == pos)
+	{
+		return false;
+	}
+
+	pos += key.size();
+	if (pos >= element.size() || (element[pos] != '"' && element[pos] != '\''))
+	{
+		return false;
+	}
+
+	std::string::size_type end = element.find(element[pos], pos + 1);
+	if (std::string::npos == end)
+	{
+		return false;
+	}
+
+	value = element.substr(pos + 1, end - pos - 1);
+	return true;
+}
+
+bool TestConfigImpl::FileExists(const std::string& path)
+{
+	struct stat st;
+	return 0 == ::stat(path.c_str(), &st) && S_ISREG(st.st_mode);
+}
+
+bool TestConfigImpl::Load()
+{
+	char exePath[PATH_MAX] = {0};
+	if (::readlink("/proc/self/exe", exePath, sizeof(exePath) - 1) <= 0)
+	{
+		return false;
+	}
+
+	std::string dirPath(exePath);
+	std::string xmlPath;
+
+	{
+		// 优先加载可执行文件所在文件夹的配置文件
+		dirPath.erase(dirPath.rfind('/'));
+		xmlPath = dirPath + "/" TEST_CONFIG_FILE;
+	}
+
+	while (!FileExists(xmlPath))
+	{
+		// 再尝试加载上一级文件夹的配置文件
+		std::string::size_type pos = dirPath.rfind('/');
+		if (std::string::npos != pos && !dirPath.empty())
+		{
+			dirPath.erase(pos);
+			xmlPath = dirPath + "/" TEST_CONFIG_FILE;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	std::ifstream file(xmlPath.c_str());
+	if (!file)
+	{
+		return false;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	std::string xml = stream.str();
+
+	std::vector<std::string> libNames;
+	std::vector<std::string> libPaths;
+
+	// test_config.xml的结构很简单，逐个扫描元素即可，不必引入xml解析库
+	std::string::size_type pos = 0;
+	while (std::string::npos != (pos = xml.find('<', pos)))
+	{
+		if (0 == xml.compare(pos, 4, "<!--"))
+		{
+			// 跳过注释掉的test
+			pos = xml.find("-->", pos);
+			if (std::string::npos == pos)
+			{
+				break;
+			}
+			continue;
+		}
+
+		std::string::size_type end = xml.find('>', pos);
+		if (std::string::npos == end)
+		{
+			break;
+		}
+
+		std::string element = xml.substr(pos, end - pos);
+		pos = end;
+
+		// 空白统一换成空格，方便查找属性
+		for (std::string::size_type i = 0; i < element.size(); ++i)
+		{
+			if ('\t' == element[i] || '\r' == element[i] || '\n' == element[i])
+			{
+				element[i] = ' ';
+			}
+		}
+
+		if (0 == element.compare(0, 6, "<root "))
+		{
+			// 根据title的值来设置标题
+			GetAttribute(element, "title", m_title);
+
+			// workers大于1时并行执行用例，见CUTEST_NS::Runner::setParallelWorkerCount()
+			std::string workers;
+			if (GetAttribute(element, "workers", workers))
+			{
+				m_workerCount = (unsigned int)::strtoul(workers.c_str(), NULL, 10);
+			}
+
+			// 用例耗时的历史记录文件，相对路径以配置文件所在的文件夹为准
+			if (GetAttribute(element, "durationHistory", m_durationHistoryFile)
+				&& !m_durationHistoryFile.empty()
+				&& '/' != m_durationHistoryFile[0])
+			{
+				m_durationHistoryFile = dirPath + "/" + m_durationHistoryFile;
+			}
+
+			// 进程隔离，见CUTEST_NS::Runner::setProcessIsolation()
+			std::string isolation;
+			if (GetAttribute(element, "processIsolation", isolation))
+			{
+				m_processIsolation = ("true" == isolation || "1" == isolation);
+			}
+
+			// 异步分发进度事件，见CUTEST_NS::Runner::setAsyncProgressDispatch()
+			std::string asyncDispatch;
+			if (GetAttribute(element, "asyncDispatch", asyncDispatch))
+			{
+				m_asyncDispatch = ("true" == asyncDispatch || "1" == asyncDispatch);
+			}
+
+			// 性能基线，见CUTEST_NS::Runner::setPerformanceBaseline()
+			if (GetAttribute(element, "baseline", m_baselineFile))
+			{
+				MakeAbsolute(dirPath, m_baselineFile);
+			}
+			if (GetAttribute(element, "baselineOutput", m_baselineOutputFile))
+			{
+				MakeAbsolute(dirPath, m_baselineOutputFile);
+			}
+			std::string threshold;
+			if (GetAttribute(element, "regressionThreshold", threshold))
+			{
+				m_regressionThreshold = (unsigned int)::strtoul(threshold.c_str(), NULL, 10);
+			}
+
+			// JSON Lines事件流，见CUTEST_NS::Runner::setEventStream()，"unix:"之后的socket路径同样按相对路径处理
+			if (GetAttribute(element, "eventStream", m_eventStream))
+			{
+				if (0 == m_eventStream.compare(0, 5, "unix:"))
+				{
+					std::string socketPath = m_eventStream.substr(5);
+					MakeAbsolute(dirPath, socketPath);
+					m_eventStream = "unix:" + socketPath;
+				}
+				else
+				{
+					MakeAbsolute(dirPath, m_eventStream);
+				}
+			}
+
+			// 分片执行，见CUTEST_NS::Runner::setSharding()，环境变量GTEST_TOTAL_SHARDS、GTEST_SHARD_INDEX优先
+			std::string totalShards;
+			if (GetAttribute(element, "totalShards", totalShards))
+			{
+				m_totalShards = (unsigned int)::strtoul(totalShards.c_str(), NULL, 10);
+			}
+			std::string shardIndex;
+			if (GetAttribute(element, "shardIndex", shardIndex))
+			{
+				m_shardIndex = (unsigned int)::strtoul(shardIndex.c_str(), NULL, 10);
+			}
+			std::string shardBy;
+			if (GetAttribute(element, "shardBy", shardBy))
+			{
+				m_shardByDuration = ("duration" == shardBy);
+			}
+
+			// 每个用例最多保留的失败数，见CUTEST_NS::Runner::setFailureRetention()
+			std::string failureRetention;
+			if (GetAttribute(element, "failureRetention", failureRetention))
+			{
+				m_failureRetention = (unsigned int)::strtoul(failureRetention.c_str(), NULL, 10);
+			}
+
+			// 测试库清单，见TestManifest
+			if (GetAttribute(element, "manifest", m_manifestFile))
+			{
+				MakeAbsolute(dirPath, m_manifestFile);
+			}
+		}
+		else if (0 == element.compare(0, 6, "<test "))
+		{
+			std::string libName;
+			if (GetAttribute(element, "libName", libName))
+			{
+				// 根据libName的配置来加载so，未写后缀时按lib<name>.so处理
+				std::string libPath = libName;
+				if (std::string::npos == libPath.find(".so"))
+				{
+					libPath = "lib" + libPath + ".so";
+				}
+				if ('/' != libPath[0])
+				{
+					libPath = dirPath + "/" + libPath;
+				}
+
+				libNames.push_back(libName);
+				libPaths.push_back(libPath);
+			}
+		}
+	}
+
+	LoadLibraries(libNames, libPaths);
+
+	// CI一般通过环境变量给每个容器指定分片，两个变量要同时设置才生效
+	const char* totalShardsEnv = ::getenv("GTEST_TOTAL_SHARDS");
+	const char* shardIndexEnv = ::getenv("GTEST_SHARD_INDEX");
+	if (totalShardsEnv && *totalShardsEnv && shardIndexEnv && *shardIndexEnv)
+	{
+		m_totalShards = (unsigned int)::strtoul(totalShardsEnv, NULL, 10);
+		m_shardIndex = (unsigned int)::strtoul(shardIndexEnv, NULL, 10);
+	}
+
+	return true;
+}
+
+const char* TestConfigImpl::GetTitle()
+{
+	return m_title.c_str();
+}
+
+unsigned int TestConfigImpl::GetWorkerCount()
+{
+	return m_workerCount;
+}
+
+const char* TestConfigImpl::GetDurationHistoryFile()
+{
+	return m_durationHistoryFile.c_str();
+}
+
+bool TestConfigImpl::GetProcessIsolation()
+{
+	return m_processIsolation;
+}
+
+bool TestConfigImpl::GetAsyncDispatch()
+{
+	return m_asyncDispatch;
+}
+
+const char* TestConfigImpl::GetBaselineFile()
+{
+	return m_baselineFile.c_str();
+}
+
+const char* TestConfigImpl::GetBaselineOutputFile()
+{
+	return m_baselineOutputFile.c_str();
+}
+
+unsigned int TestConfigImpl::GetRegressionThreshold()
+{
+	return m_regressionThreshold;
+}
+
+const char* TestConfigImpl::GetEventStream()
+{
+	return m_eventStream.c_str();
+}
+
+unsigned int TestConfigImpl::GetTotalShards()
+{
+	return m_totalShards;
+}
+
+unsigned int TestConfigImpl::GetShardIndex()
+{
+	return m_shardIndex;
+}
+
+bool TestConfigImpl::GetShardByDuration()
+{
+	return m_shardByDuration;
+}
+
+unsigned int TestConfigImpl::GetFailureRetention()
+{
+	return m_failureRetention;
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "TestConfig.h"
+
+#include <string>
+#include <vector>
+
+class TestManifest;
+
+class TestConfigImpl : public TestConfig
+{
+public:
+	TestConfigImpl();
+
+	virtual bool Load();
+	virtual const char* GetTitle();
+	virtual unsigned int GetWorkerCount();
+	virtual const char* GetDurationHistoryFile();
+	virtual bool GetProcessIsolation();
+	virtual bool GetAsyncDispatch();
+	virtual const char* GetBaselineFile();
+	virtual const char* GetBaselineOutputFile();
+	virtual unsigned int GetRegressionThreshold();
+	virtual const char* GetEventStream();
+	virtual unsigned int GetTotalShards();
+	virtual unsigned int GetShardIndex();
+	virtual bool GetShardByDuration();
+	virtual unsigned int GetFailureRetention();
+
+protected:
+	static void LoadFailedMsg(const std::string& libName);
+	static bool GetAttribute(const std::string& element, const char* name, std::string& value);
+	static bool FileExists(const std::string& path);
+	static void MakeAbsolute(const std::string& dirPath, std::string& path);
+	static bool IsLibrarySelected(const TestManifest& manifest, const std::string& libPath);
+	void LoadLibraries(const std::vector<std::string>& libNames, const std::vector<std::string>& libPaths);
+
+protected:
+	std::string m_title;
+	unsigned int m_workerCount;
+	std::string m_durationHistoryFile;
+	bool m_processIsolation;
+	bool m_asyncDispatch;
+	std::string m_baselineFile;
+	std::string m_baselineOutputFile;
+	unsigned int m_regressionThreshold;
+	std::string m_eventStream;
+	unsigned int m_totalShards;
+	unsigned int m_shardIndex;
+	bool m_shardByDuration;
+	unsigned int m_failureRetention;
+	std::string m_manifestFile;
+};
@@ -0,0 +1,257 @@
+﻿#include "TestManifest.h"
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <dlfcn.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <set>
+
+namespace
+{
+	std::string RealPath(const char* path)
+	{
+		char resolved[PATH_MAX] = {0};
+		return ::realpath(path, resolved) ? std::string(resolved) : std::string(path);
+	}
+
+	// 遍历registry下所有的TestFactory，按所在的测试库（realpath）分组
+	class FactoryCollector
+	{
+	public:
+		typedef std::map<std::string, TestManifest::Library> Libraries;
+
+		explicit FactoryCollector(Libraries& libraries)
+			: m_libraries(libraries)
+		{}
+
+		void Collect(CPPUNIT_NS::TestFactoryRegistry* registry)
+		{
+			if (!m_visited.insert(registry).second)
+			{
+				return;
+			}
+
+			CppUnitVector<CPPUNIT_NS::TestFactory*> factories;
+			registry->getFactories(factories);
+			for (size_t i = 0; i < factories.size(); ++i)
+			{
+				CPPUNIT_NS::TestFactoryRegistry* child = dynamic_cast<CPPUNIT_NS::TestFactoryRegistry*>(factories[i]);
+				if (child)
+				{
+					Collect(child);
+					continue;
+				}
+
+				// TestMetadata是测试库中的静态变量，没有TestMetadata时看TestFactory本身在哪个测试库中
+				const CPPUNIT_NS::TestMetadata* metadata = factories[i]->metadata();
+				Dl_info info;
+				if (!::dladdr(metadata ? (const void*)metadata : (const void*)factories[i], &info) || !info.dli_fname)
+				{
+					continue;
+				}
+
+				Libraries::iterator it = m_libraries.find(Resolve(info.dli_fname));
+				if (m_libraries.end() == it)
+				{
+					continue;
+				}
+				if (metadata)
+				{
+					it->second.tests.push_back(std::string(metadata->suiteName) + "." + metadata->testName);
+				}
+				else
+				{
+					it->second.opaque = true;
+				}
+			}
+		}
+
+	protected:
+		const std::string& Resolve(const char* fileName)
+		{
+			std::map<std::string, std::string>::iterator it = m_resolved.find(fileName);
+			if (m_resolved.end() == it)
+			{
+				it = m_resolved.insert(std::make_pair(std::string(fileName), RealPath(fileName))).first;
+			}
+			return it->second;
+		}
+
+		Libraries& m_libraries;
+		std::set<CPPUNIT_NS::TestFactoryRegistry*> m_visited;
+		std::map<std::string, std::string> m_resolved; // dli_fname -> realpath
+	};
+}
+
+TestManifest::TestManifest()
+	: m_dirty(false)
+{}
+
+bool TestManifest::Stat(const std::string& path, long long& size, long long& mtime)
+{
+	struct stat st;
+	if (0 != ::stat(path.c_str(), &st))
+	{
+		return false;
+	}
+
+	size = (long long)st.st_size;
+	mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	return true;
+}
+
+bool TestManifest::Load(const std::string& path)
+{
+	m_libraries.clear();
+	m_dirty = false;
+
+	std::ifstream file(path.c_str());
+	if (!file)
+	{
+		return false;
+	}
+
+	// 每个测试库一行"lib\t大小\t修改时间\topaque\t路径"，后面每个用例一行"test\t用例名"
+	Library* library = NULL;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (0 == line.compare(0, 5, "test\t") && library)
+		{
+			library->tests.push_back(line.substr(5));
+		}
+		else if (0 == line.compare(0, 4, "lib\t"))
+		{
+			Library entry;
+			int opaque = 1;
+			int offset = 0;
+			if (3 != ::sscanf(line.c_str() + 4, "%lld\t%lld\t%d\t%n", &entry.size, &entry.mtime, &opaque, &offset) || 0 == offset)
+			{
+				library = NULL;
+				continue;
+			}
+			entry.opaque = (0 != opaque);
+			library = &(m_libraries[line.substr(4 + offset)] = entry);
+		}
+	}
+
+	return true;
+}
+
+bool TestManifest::Save(const std::string& path)
+{
+	if (!m_dirty)
+	{
+		return true;
+	}
+
+	// 先写到临时文件再改名，进程隔离时多个进程同时更新清单也不会读到写了一半的文件
+	char suffix[32] = {0};
+	::snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)::getpid());
+	std::string tempPath = path + suffix;
+	std::ofstream file(tempPath.c_str());
+	if (!file)
+	{
+		return false;
+	}
+
+	for (Libraries::const_iterator it = m_libraries.begin(); it != m_libraries.end(); ++it)
+	{
+		const Library& library = it->second;
+		file << "lib\t" << library.size << '\t' << library.mtime << '\t' << (library.opaque ? 1 : 0) << '\t' << it->first << '\n';
+		for (size_t i = 0; i < library.tests.size(); ++i)
+		{
+			file << "test\t" << library.tests[i] << '\n';
+		}
+	}
+
+	file.close();
+	if (!file || 0 != ::rename(tempPath.c_str(), path.c_str()))
+	{
+		::unlink(tempPath.c_str());
+		return false;
+	}
+
+	m_dirty = false;
+	return true;
+}
+
+const TestManifest::Library* TestManifest::Find(const std::string& path) const
+{
+	Libraries::const_iterator it = m_libraries.find(RealPath(path.c_str()));
+	if (m_libraries.end() == it)
+	{
+		return NULL;
+	}
+
+	long long size = 0;
+	long long mtime = 0;
+	if (!Stat(it->first, size, mtime) || size != it->second.size || mtime != it->second.mtime)
+	{
+		return NULL;
+	}
+	return &it->second;
+}
+
+void TestManifest::Update(const std::vector<std::string>& libPaths)
+{
+	FactoryCollector::Libraries loaded;
+	for (size_t i = 0; i < libPaths.size(); ++i)
+	{
+		Library library;
+		std::string realPath = RealPath(libPaths[i].c_str());
+		if (Stat(realPath, library.size, library.mtime))
+		{
+			library.opaque = false;
+			loaded[realPath] = library;
+		}
+	}
+
+	FactoryCollector collector(loaded);
+	collector.Collect(&CPPUNIT_NS::TestFactoryRegistry::getRegistry());
+
+	for (FactoryCollector::Libraries::iterator it = loaded.begin(); it != loaded.end(); ++it)
+	{
+		// 没有注册任何用例的测试库可能做了别的事情（比如注册全局的Environment），也当作总是要加载
+		if (it->second.tests.empty())
+		{
+			it->second.opaque = true;
+		}
+
+		Library& cached = m_libraries[it->first];
+		if (cached.size != it->second.size || cached.mtime != it->second.mtime
+			|| cached.opaque != it->second.opaque || cached.tests != it->second.tests)
+		{
+			cached = it->second;
+			m_dirty = true;
+		}
+	}
+}
+
+void TestManifest::Retain(const std::vector<std::string>& libPaths)
+{
+	std::set<std::string> retained;
+	for (size_t i = 0; i < libPaths.size(); ++i)
+	{
+		retained.insert(RealPath(libPaths[i].c_str()));
+	}
+
+	for (Libraries::iterator it = m_libraries.begin(); it != m_libraries.end();)
+	{
+		if (retained.count(it->first))
+		{
+			++it;
+		}
+		else
+		{
+			m_libraries.erase(it++);
+			m_dirty = true;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+	测试库清单：缓存每个测试库的大小、修改时间以及其中注册的用例名（TestCase.TestName），
+	测试库没有变化时，不用加载就能知道它有哪些用例，过滤之后一个都不执行的测试库就可以不加载了。
+	用例名取自TestMetadata，不需要构造用例；没有TestMetadata的用例（比如cppunit的TestSuite）
+	只有加载之后才知道名字，这样的测试库总是要加载。
+*/
+class TestManifest
+{
+public:
+	struct Library
+	{
+		Library()
+			: size(0)
+			, mtime(0)
+			, opaque(true)
+		{}
+
+		long long size;
+		long long mtime;                  // 单位：ns
+		bool opaque;                      // 为true时不能根据tests判断是否需要加载
+		std::vector<std::string> tests;
+	};
+
+	TestManifest();
+
+	bool Load(const std::string& path);
+	bool Save(const std::string& path);
+
+	// 清单中有path且文件没有变化时返回记录，否则返回NULL
+	const Library* Find(const std::string& path) const;
+
+	// 根据已经注册的用例重新生成libPaths中各测试库的记录，这些测试库都要已经加载
+	void Update(const std::vector<std::string>& libPaths);
+
+	// 只保留libPaths中的测试库，配置文件中去掉的测试库不再缓存
+	void Retain(const std::vector<std::string>& libPaths);
+
+protected:
+	static bool Stat(const std::string& path, long long& size, long long& mtime);
+
+protected:
+	typedef std::map<std::string, Library> Libraries;
+	Libraries m_libraries;
+	bool m_dirty; // 和文件中的内容不一致，需要Save()
+};
@@ -0,0 +1,57 @@
+﻿#include "TestConfig.h"
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include "cutest/Runner.h"
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char* argv[]) {
+    TestConfig::GetInstance()->Load();
+    CUTEST_NS::Runner::instance()->setParallelWorkerCount(TestConfig::GetInstance()->GetWorkerCount());
+    CUTEST_NS::Runner::instance()->setDurationHistoryFile(TestConfig::GetInstance()->GetDurationHistoryFile());
+    CUTEST_NS::Runner::instance()->setProcessIsolation(TestConfig::GetInstance()->GetProcessIsolation());
+    CUTEST_NS::Runner::instance()->setAsyncProgressDispatch(TestConfig::GetInstance()->GetAsyncDispatch());
+    CUTEST_NS::Runner::instance()->setPerformanceBaseline(
+        TestConfig::GetInstance()->GetBaselineFile(),
+        TestConfig::GetInstance()->GetBaselineOutputFile(),
+        TestConfig::GetInstance()->GetRegressionThreshold());
+    CUTEST_NS::Runner::instance()->setEventStream(TestConfig::GetInstance()->GetEventStream());
+    CUTEST_NS::Runner::instance()->setFailureRetention(TestConfig::GetInstance()->GetFailureRetention());
+
+    unsigned int totalShards = TestConfig::GetInstance()->GetTotalShards();
+    unsigned int shardIndex = TestConfig::GetInstance()->GetShardIndex();
+    if (totalShards > 1) {
+        if (shardIndex >= totalShards) {
+            ::fprintf(stderr, "Invalid shard index %u, the total number of shards is %u\n", shardIndex, totalShards);
+            return 1;
+        }
+
+        // 和gtest一样，通过GTEST_SHARD_STATUS_FILE告诉调用者支持分片
+        const char* statusFile = ::getenv("GTEST_SHARD_STATUS_FILE");
+        if (statusFile && *statusFile) {
+            FILE* file = ::fopen(statusFile, "w");
+            if (file) {
+                ::fclose(file);
+            }
+        }
+    }
+    CUTEST_NS::Runner::instance()->setSharding(totalShards, shardIndex, TestConfig::GetInstance()->GetShardByDuration());
+
+    // --gtest_list_tests：以JSON列出要执行的用例，不构造也不执行，--gtest_output=json:<path>时写到path
+    if (testing::GTEST_FLAG(list_tests)) {
+        std::string output = testing::GTEST_FLAG(output);
+        output = (0 == output.compare(0, 5, "json:")) ? output.substr(5) : std::string();
+        return CUTEST_NS::Runner::instance()->listTests(output.c_str()) ? 0 : 1;
+    }
+
+    CPPUNIT_NS::Test* allTests = CPPUNIT_NS::TestFactoryRegistry::getRegistry().makeTest();
+
+    CUTEST_NS::Runner::instance()->start(allTests);
+    CUTEST_NS::Runner::instance()->waitUntilAllTestEnd();
+    int failureCount = (int)CUTEST_NS::Runner::instance()->totalFailureCount();
+    delete allTests;
+
+    return failureCount ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+#include "cutest/Event.h"
+#include "cutest/Helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+/*
+    测量跨线程交接的延迟：调用线程像TestCaller、ProgressListenerManager那样，每次交接都创建一个事件，
+    把它交给服务线程post()，等待之后再destroy()；同时给出创建/销毁事件本身的耗时，
+    以及始终复用同一个事件时的交接延迟作为下限。Event::createInstance()会复用destroy()之后的事件，
+    两种交接方式的差距就是每次交接额外的开销。
+
+    用法：EventHandoffBenchmark [交接次数，默认100000]
+*/
+
+// 服务线程：每收到一个请求，就post()请求中带过来的事件，收到NULL时退出
+class HandoffServer {
+public:
+    HandoffServer()
+        : request(CUTEST_NS::Event::createInstance())
+        , reply(NULL)
+        , thread(&HandoffServer::serve, this) {}
+
+    ~HandoffServer() {
+        handoff(NULL);
+        this->thread.join();
+        this->request->destroy();
+    }
+
+    // 由调用线程调用，等服务线程收到reply之后才返回
+    void handoff(CUTEST_NS::Event* reply_in) {
+        this->reply = reply_in;
+        this->request->post();
+    }
+
+protected:
+    void serve() {
+        while (true) {
+            this->request->wait();
+            if (!this->reply) {
+                break;
+            }
+            this->reply->post();
+        }
+    }
+
+    CUTEST_NS::Event* request;
+    CUTEST_NS::Event* volatile reply;
+    std::thread thread;
+};
+
+static void
+report(const char* name, unsigned int count, unsigned long long elapsed_ns) {
+    ::printf("%-28s %u times in %s ms, %.0f ns/op\n",
+             name,
+             count,
+             CUTEST_NS::formatElapsedMs(elapsed_ns).c_str(),
+             count ? (double)elapsed_ns / count : 0.0);
+}
+
+static void
+measureCreateDestroy(unsigned int count) {
+    unsigned long long start = CUTEST_NS::tickCountNs();
+    for (unsigned int i = 0; i < count; ++i) {
+        CUTEST_NS::Event::createInstance()->destroy();
+    }
+    report("create + destroy", count, CUTEST_NS::tickCountNs() - start);
+}
+
+static void
+measureHandoffWithNewEvent(unsigned int count) {
+    HandoffServer server;
+
+    unsigned long long start = CUTEST_NS::tickCountNs();
+    for (unsigned int i = 0; i < count; ++i) {
+        CUTEST_NS::Event* event = CUTEST_NS::Event::createInstance();
+        server.handoff(event);
+        event->wait();
+        event->destroy();
+    }
+    report("hand-off, event per call", count, CUTEST_NS::tickCountNs() - start);
+}
+
+static void
+measureHandoffWithSameEvent(unsigned int count) {
+    HandoffServer server;
+    CUTEST_NS::Event* event = CUTEST_NS::Event::createInstance();
+
+    unsigned long long start = CUTEST_NS::tickCountNs();
+    for (unsigned int i = 0; i < count; ++i) {
+        server.handoff(event);
+        event->wait();
+    }
+    report("hand-off, same event", count, CUTEST_NS::tickCountNs() - start);
+
+    event->destroy();
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int count = 100000;
+    if (argc > 1) {
+        count = (unsigned int)::strtoul(argv[1], NULL, 10);
+    }
+
+    measureCreateDestroy(count);
+    measureHandoffWithNewEvent(count);
+    measureHandoffWithSameEvent(count);
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+﻿#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+  BENCHMARK_F的用例体会被反复执行，SetUp()/TearDown()只在测量前后各执行一次，
+  测量结果通过ProgressListener::onBenchmarkEnd()输出到日志和xml报告中
+*/
+class GTestBenchmarkTest : public testing::Test {
+ public:
+  virtual void SetUp() override {
+    for (int i = 0; i < 1000; ++i) {
+      values.push_back((i * 7919) % 1000);
+    }
+  }
+
+  std::vector<int> values;
+};
+
+BENCHMARK_F(GTestBenchmarkTest, sort_1000_ints) {
+  std::vector<int> copy(values);
+  std::sort(copy.begin(), copy.end());
+  ASSERT_EQ(0, copy.front());
+}
+
+BENCHMARK_F(GTestBenchmarkTest, find_in_1000_ints) {
+  ASSERT_TRUE(std::find(values.begin(), values.end(), 999) != values.end());
+}
@@ -1,18 +1,23 @@
 ﻿#include "gtest/gtest.h"
 #include "cutest/CountDownLatch.h"
-#include "SimpleTimer.h"
+#include "cutest/Runnable.h"
+#include "cutest/Runner.h"
 
+/*
+  这个用例不在主线程执行，并行执行时可能和其他用例同时进行，
+  所以不使用SimpleTimer这个单例，而是自己在主线程上延迟回调
+*/
 class GTestWaitAsynEndTest
   : public testing::Test
-  , public SimpleTimer::Callback {
+  , public CUTEST_NS::Runnable {
  public:
   GTestWaitAsynEndTest();
 
   virtual void SetUp() override;
   virtual void TearDown() override;
 
-  // 实现SimpleTimer::Callback
-  virtual void onTimeUp();
+  // 实现Runnable::run()
+  virtual void run();
 
   CUTEST_NS::CountDownLatch* time_up;
 };
@@ -25,18 +30,17 @@ void GTestWaitAsynEndTest::SetUp() {
 }
 
 void GTestWaitAsynEndTest::TearDown() {
-  SimpleTimer::instance()->removeCallback(this);
   delete time_up;
 }
 
-void GTestWaitAsynEndTest::onTimeUp() {
+void GTestWaitAsynEndTest::run() {
   time_up->countDown();
 }
 
 TEST_F(GTestWaitAsynEndTest, end_test_after_1s) {
   unsigned long long start = CUTEST_NS::tickCount64();
 
-  SimpleTimer::instance()->setCallback(1000, this);
+  CUTEST_NS::Runner::instance()->delayRunOnMainThread(1000, this, false);
 
   time_up->await();
 
@@ -31,6 +31,7 @@ LOCAL_C_INCLUDES := \
 
 LOCAL_SRC_FILES := \
     ./../CppUnitExplicitEndTest.cpp \
+	./../GTestBenchmarkTest.cpp \
 	./../GTestExplicitEndTest.cpp \
 	./../SimpleTimer.cpp
 
@@ -41,7 +41,9 @@ class MyGMock {	// 
 public:
 	MOCK_METHOD2(testFunc, int(int, int));
 	MOCK_METHOD2(testMethod, int(int, int));
+#ifdef _WIN32
 	MOCK_METHOD2(test64bits, __int64(__int64, __int64));
+#endif
 };
 
 TEST(FuncTest, testFunc_SetReturn) {
@@ -59,6 +61,7 @@ TEST(FuncTest, testFunc_SetReturn) {
 	EXPECT_EQ(7, testFunc(3, 4));
 }
 
+#ifdef _WIN32
 typedef int (*testFuncPtr)(int, int);
 TEST(FuncTest, testFunc_GetFuncAddrByName) {
 	// ͨpdbȡַ
@@ -70,9 +73,11 @@ TEST(FuncTest, testFunc_GetFuncAddrByName) {
 	EXPECT_EQ(3, funcPtr(1, 2));
 }
 
+#endif
+
 TEST(FuncTest, testFunc_ReplaceWithCustomFunc) {
 	int (*funcAddr)(int, int) = testFunc;
-	testing::GMockPlus objPtr(funcAddr, testFunc_Custom);	// Ҫ֤ testFunc_Custom ĺԭ testFunc ԭһ
+	testing::GMockPlus objPtr((void*)funcAddr, (void*)testFunc_Custom);	// Ҫ֤ testFunc_Custom ĺԭ testFunc ԭһ
 
 	EXPECT_EQ(-1, testFunc(1, 2));
 	EXPECT_EQ(-1, testFunc(3, 4));
@@ -94,6 +99,7 @@ TEST(MethodTest, testMethod_SetReturn) {
 	EXPECT_EQ(12, myC.testMethod(3, 4));
 }
 
+#ifdef _WIN32
 TEST(VirtualFunctionTest, testMethod_SetReturn) {
 	MyGMock mockObj;
 	CTest testObj;
@@ -135,3 +141,39 @@ TEST(Test64Bits, test64bits_SetReturn) {
 	EXPECT_EQ(123, test64bits(1, 2));
 	EXPECT_EQ(7, test64bits(3, 4));
 }
+#endif
+
+#ifndef _WIN32
+// ͨдlibGMockPlusDemo.soĵmock atoiatoiĴ벻޸
+class MyImportGMock {
+public:
+	MOCK_METHOD1(atoi, int(const char*));
+};
+
+int atoi_Custom(const char* str) {
+	return -1;
+}
+
+TEST(ImportTest, atoi_SetReturn) {
+	MyImportGMock mockObj;
+	testing::GMockPlusImport importObj("libGMockPlusDemo.so", "atoi", &mockObj, testing::internal::GetMethodAddr(&MyImportGMock::atoi), true, testing::CDECL_CALL, 1);
+	int (*srcAtoi)(const char*) = (int (*)(const char*))importObj.GetNewSrcAddr();	// ģ&atoiҲ滻
+
+	EXPECT_CALL(mockObj, atoi(testing::_))
+		.Times(2)
+		.WillOnce(testing::Return(123))	// һε÷ 123
+		.WillOnce(testing::Invoke(srcAtoi));	// ڶεֱӵԭʵ
+
+	EXPECT_EQ(123, atoi("1"));
+	EXPECT_EQ(7, atoi("7"));
+}
+
+TEST(ImportTest, atoi_ReplaceWithCustomFunc) {
+	{
+		testing::GMockPlusImport importObj("libGMockPlusDemo.so", "atoi", (void*)atoi_Custom);
+		EXPECT_TRUE(importObj.IsHooked());
+		EXPECT_EQ(-1, atoi("7"));
+	}
+	EXPECT_EQ(7, atoi("7"));	// ʱָ
+}
+#endif
@@ -0,0 +1,94 @@
+#include <cppunit/TestCase.h>
+#include <cppunit/TestSuite.h>
+#include "cutest/Helper.h"
+#include "cutest/ProgressListener.h"
+#include "cutest/Runner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    测量ProgressListener事件分发的吞吐量：执行大量空用例，分别在同步和异步分发
+    （见CUTEST_NS::Runner::setAsyncProgressDispatch()）两种方式下统计每秒分发的事件数。
+    Logger会把每个事件输出到stdout，结果输出到stderr，运行时可以把stdout重定向到/dev/null。
+
+    用法：ProgressDispatchBenchmark [用例数，默认100000]
+*/
+
+class EmptyTest : public CPPUNIT_NS::TestCase {
+public:
+    explicit EmptyTest(const std::string& name)
+        : CPPUNIT_NS::TestCase(name) {}
+
+    virtual void runTest() {}
+};
+
+class EventCounter : public CUTEST_NS::ProgressListener {
+public:
+    EventCounter()
+        : count(0) {}
+
+    virtual void onRunnerStart(CPPUNIT_NS::Test*) { ++count; }
+    virtual void onRunnerEnd(CPPUNIT_NS::Test*, unsigned int) { ++count; }
+    virtual void onSuiteStart(CPPUNIT_NS::Test*) { ++count; }
+    virtual void onSuiteEnd(CPPUNIT_NS::Test*, unsigned int) { ++count; }
+    virtual void onTestStart(CPPUNIT_NS::Test*) { ++count; }
+    virtual void onTestEnd(CPPUNIT_NS::Test*, unsigned int, unsigned int, unsigned int) { ++count; }
+    virtual void onFailureAdd(unsigned int, const CPPUNIT_NS::TestFailure&) { ++count; }
+
+    unsigned long long count;
+};
+
+static CPPUNIT_NS::Test*
+makeTests(unsigned int test_count) {
+    const unsigned int tests_per_suite = 100;
+
+    CPPUNIT_NS::TestSuite* root = new CPPUNIT_NS::TestSuite("All Tests");
+    CPPUNIT_NS::TestSuite* suite = NULL;
+    char name[64];
+    for (unsigned int i = 0; i < test_count; ++i) {
+        if (0 == i % tests_per_suite) {
+            ::sprintf(name, "Suite%u", i / tests_per_suite);
+            suite = new CPPUNIT_NS::TestSuite(name);
+            root->addTest(suite);
+        }
+        ::sprintf(name, "test%u", i % tests_per_suite);
+        suite->addTest(new EmptyTest(name));
+    }
+    return root;
+}
+
+static void
+measure(CPPUNIT_NS::Test* tests, bool async_dispatch) {
+    CUTEST_NS::Runner* runner = CUTEST_NS::Runner::instance();
+    EventCounter counter;
+    runner->addListener(&counter);
+    runner->setAsyncProgressDispatch(async_dispatch);
+
+    unsigned long long start = CUTEST_NS::tickCount64();
+    runner->start(tests);
+    runner->waitUntilAllTestEnd();
+    unsigned long long ms = CUTEST_NS::tickCount64() - start;
+
+    runner->removeListener(&counter);
+
+    ::fprintf(stderr, "%-6s dispatch: %llu events in %llu ms, %.0f events/sec\n",
+              async_dispatch ? "async" : "sync",
+              counter.count,
+              ms,
+              ms ? counter.count * 1000.0 / ms : 0.0);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int test_count = 100000;
+    if (argc > 1) {
+        test_count = (unsigned int)::strtoul(argv[1], NULL, 10);
+    }
+
+    CPPUNIT_NS::Test* tests = makeTests(test_count);
+    measure(tests, false);
+    measure(tests, true);
+    delete tests;
+
+    return 0;
+}
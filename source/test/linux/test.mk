@@ -0,0 +1,85 @@
+# Test libraries for Linux, the counterpart of ../jni/test.mk
+#
+# Variables expected from the including Makefile:
+#   OUT_DIR    : directory receiving lib*.so and the object files
+#   CUTEST_LIB : path of libcutest.so (see third_party/cutest/linux/cutest.mk)
+#   GMOCKPLUS_LIB : path of libgmockplus.so (see third_party/GMockPlus/linux/gmockplus.mk)
+
+TEST_PATH := $(abspath $(dir $(lastword $(MAKEFILE_LIST)))..)
+TEST_THIRD_PARTY_PATH := $(abspath $(TEST_PATH)/../third_party)
+TEST_OBJ_DIR := $(OUT_DIR)/obj/test
+
+TEST_CPPFLAGS := \
+    -I$(TEST_THIRD_PARTY_PATH)/cppunit/include \
+    -I$(TEST_THIRD_PARTY_PATH)/cutest/include \
+    -I$(TEST_THIRD_PARTY_PATH)/googlemock/include \
+    -I$(TEST_THIRD_PARTY_PATH)/googletest/include
+
+TEST_CXXFLAGS := -std=c++11 -fPIC -frtti -fexceptions -O2 -pthread -Wno-deprecated-declarations
+
+TEST_LDFLAGS := -L$(OUT_DIR) -Wl,-rpath,'$$ORIGIN'
+TEST_LDLIBS := -lcutest -pthread
+
+# 每个测试库的源文件，与jni/*.mk保持一致
+ExplicitEndTest_SRC_FILES := \
+    $(TEST_PATH)/ExplicitEndTest/CppUnitExplicitEndTest.cpp \
+    $(TEST_PATH)/ExplicitEndTest/GTestBenchmarkTest.cpp \
+    $(TEST_PATH)/ExplicitEndTest/GTestExplicitEndTest.cpp \
+    $(TEST_PATH)/ExplicitEndTest/GTestWaitAsynEndTest.cpp \
+    $(TEST_PATH)/ExplicitEndTest/SimpleTimer.cpp
+
+money_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/cppunit/examples/money/MoneyTest.cpp
+
+sample1_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample1.cc \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample1_unittest.cc
+
+sample2_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample2.cc \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample2_unittest.cc
+
+sample3_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample3_unittest.cc
+
+sample4_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample4.cc \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample4_unittest.cc
+
+sample5_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample1.cc \
+    $(TEST_THIRD_PARTY_PATH)/googletest/samples/sample5_unittest.cc
+
+simple_SRC_FILES := \
+    $(TEST_THIRD_PARTY_PATH)/cppunit/examples/simple/ExampleTestCase.cpp
+
+# GMockPlus直接改写被测函数的指令，只支持x86-64；
+# 用-O0编译，否则被测函数在调用处被内联或者常量折叠之后就hook不到了
+GMockPlusDemo_SRC_FILES := \
+    $(TEST_PATH)/GMockPlusDemo/GMockPlusDemo.cpp
+
+GMockPlusDemo_CPPFLAGS := -I$(TEST_THIRD_PARTY_PATH)/GMockPlus/src
+GMockPlusDemo_CXXFLAGS := -O0
+GMockPlusDemo_LDLIBS := -lgmockplus
+GMockPlusDemo_DEPS := $(GMOCKPLUS_LIB)
+
+TEST_MODULES := ExplicitEndTest money sample1 sample2 sample3 sample4 sample5 simple
+ifneq ($(filter x86_64%,$(shell $(CXX) -dumpmachine)),)
+TEST_MODULES += GMockPlusDemo
+endif
+TEST_LIBS := $(foreach module,$(TEST_MODULES),$(OUT_DIR)/lib$(module).so)
+
+define TEST_MODULE_RULES
+$(1)_OBJ_FILES := $$(patsubst /%,$$(TEST_OBJ_DIR)/$(1)/%.o,$$($(1)_SRC_FILES))
+
+$$(TEST_OBJ_DIR)/$(1)/%.o: /%
+	@mkdir -p $$(dir $$@)
+	$$(CXX) $$(TEST_CXXFLAGS) $$($(1)_CXXFLAGS) $$(TEST_CPPFLAGS) $$($(1)_CPPFLAGS) -MMD -MP -c $$< -o $$@
+
+$$(OUT_DIR)/lib$(1).so: $$($(1)_OBJ_FILES) $$(CUTEST_LIB) $$($(1)_DEPS)
+	$$(CXX) -shared -o $$@ $$($(1)_OBJ_FILES) $$(TEST_LDFLAGS) $$($(1)_LDLIBS) $$(TEST_LDLIBS)
+
+-include $$($(1)_OBJ_FILES:.o=.d)
+endef
+
+$(foreach module,$(TEST_MODULES),$(eval $(call TEST_MODULE_RULES,$(module))))
@@ -0,0 +1,41 @@
+# libgmockplus.so for Linux (x86-64 only), the counterpart of ../vs2015/GMockPlus.vcxproj
+#
+# Variables expected from the including Makefile:
+#   OUT_DIR    : directory receiving libgmockplus.so and the object files
+#   CUTEST_LIB : path of libcutest.so, which provides gtest (see third_party/cutest/linux/cutest.mk)
+
+GMOCKPLUS_PATH := $(abspath $(dir $(lastword $(MAKEFILE_LIST)))..)
+GMOCKPLUS_THIRD_PARTY_PATH := $(abspath $(GMOCKPLUS_PATH)/..)
+
+GMOCKPLUS_LIB := $(OUT_DIR)/libgmockplus.so
+GMOCKPLUS_OBJ_DIR := $(OUT_DIR)/obj/GMockPlus
+
+GMOCKPLUS_CPPFLAGS := \
+    -I$(GMOCKPLUS_PATH)/src \
+    -I$(GMOCKPLUS_THIRD_PARTY_PATH)/cppunit/include \
+    -I$(GMOCKPLUS_THIRD_PARTY_PATH)/cutest/include \
+    -I$(GMOCKPLUS_THIRD_PARTY_PATH)/googletest/include
+
+GMOCKPLUS_CXXFLAGS := -std=c++11 -fPIC -frtti -fexceptions -O2 -pthread
+
+GMOCKPLUS_LDFLAGS := -L$(OUT_DIR) -Wl,-rpath,'$$ORIGIN'
+GMOCKPLUS_LDLIBS := -lcutest -pthread -ldl
+
+GMOCKPLUS_SRC_FILES := \
+    $(GMOCKPLUS_PATH)/src/GMockPlus.cpp \
+    $(GMOCKPLUS_PATH)/src/MockMgr.cpp \
+    $(GMOCKPLUS_PATH)/src/linux/CodePatch.cpp \
+    $(GMOCKPLUS_PATH)/src/linux/HookMgr.cpp \
+    $(GMOCKPLUS_PATH)/src/linux/ImportHook.cpp
+
+GMOCKPLUS_OBJ_FILES := $(patsubst $(GMOCKPLUS_PATH)/%,$(GMOCKPLUS_OBJ_DIR)/%.o,$(GMOCKPLUS_SRC_FILES))
+
+$(GMOCKPLUS_OBJ_DIR)/%.o: $(GMOCKPLUS_PATH)/%
+	@mkdir -p $(dir $@)
+	$(CXX) $(GMOCKPLUS_CXXFLAGS) $(GMOCKPLUS_CPPFLAGS) -MMD -MP -c $< -o $@
+
+$(GMOCKPLUS_LIB): $(GMOCKPLUS_OBJ_FILES) $(CUTEST_LIB)
+	@mkdir -p $(dir $@)
+	$(CXX) -shared -o $@ $(GMOCKPLUS_OBJ_FILES) $(GMOCKPLUS_LDFLAGS) $(GMOCKPLUS_LDLIBS)
+
+-include $(GMOCKPLUS_OBJ_FILES:.o=.d)
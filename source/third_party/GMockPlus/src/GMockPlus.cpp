@@ -6,6 +6,7 @@ namespace testing {
 
 typedef unsigned int uint;
 
+#ifdef _WIN32
 DWORD AnalysisCallAddr(void* call_next_addr, DWORD* regs) {
   /*
     pushad 后栈的内容:
@@ -177,6 +178,7 @@ DWORD AnalysisCallAddr(void* call_next_addr, DWORD* regs) {
 
   return callAddr;
 }
+#endif
 
 GMockPlus* QueryMockInfo(void* srcAddr) {
   GMockPlus* mockInfo = MockMgr::GetInstance()->QueryMockInfo(srcAddr);
@@ -204,6 +206,7 @@ void* internal::QueryNewSrcAddrImpl_(void* srcAddr) {
   return result;
 }
 
+#ifdef _WIN32
 void __declspec(naked) MockFunctionJmpTo() {  // 被hook的函数直接jmp到此，此函数需要负责栈平衡，转调新的实现
   __asm {
     // 1.保存寄存器
@@ -381,6 +384,7 @@ void __declspec(naked) MockFunctionJmpTo() {  // 被hook的函数直接jmp到此
     ret
   }
 }
+#endif
 
 GMockPlus::GMockPlus(
   void* srcAddr,
@@ -401,7 +405,9 @@ GMockPlus::GMockPlus(
   , m_registed(false)
   , m_passParams(passParams) {
   ASSERT(srcAddr && objPtr && dstMethodAddr);
+#ifdef _WIN32
   m_dstAddr = MockFunctionJmpTo;
+#endif  // 其他平台在Hook时为每个GMockPlus对象单独生成中转代码，见linux/CodePatch.h
   PreHook();
   if (hookImmediately) {
     Hook();
@@ -1,16 +1,25 @@
 ﻿#pragma once
+#ifdef _WIN32
 #include <windows.h>
 #include <crtdbg.h>
+#else
+#include <assert.h>
+#include <string.h>
+#endif
 #include <set>
+#ifndef _WIN32
+#include <string>
+#include <vector>
+#endif
 
 #include "gtest/gtest.h"
 
 // WARNING:被Mock函数的起始位置不能下断点，否则会导致Hook失败！
 #define GMOCKPLUS_CDECL(srcAddr, gmockObj, gmockMethodAddr, paramCount) \
-  testing::GMockPlus GMOCKPLUS_CONCAT_TOKEN_(gmockplusObj_, __LINE__)(srcAddr, &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::CDECL_CALL, paramCount)
+  testing::GMockPlus GMOCKPLUS_CONCAT_TOKEN_(gmockplusObj_, __LINE__)(testing::internal::GetMethodAddr(srcAddr), &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::CDECL_CALL, paramCount)
 
 #define GMOCKPLUS_STDCALL(srcAddr, gmockObj, gmockMethodAddr, paramCount)   \
-  testing::GMockPlus GMOCKPLUS_CONCAT_TOKEN_(gmockplusObj_, __LINE__)(srcAddr, &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::STD_CALL, paramCount)
+  testing::GMockPlus GMOCKPLUS_CONCAT_TOKEN_(gmockplusObj_, __LINE__)(testing::internal::GetMethodAddr(srcAddr), &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::STD_CALL, paramCount)
 
 #define GMOCKPLUS_THISCALL(srcMethodAddr, gmockObj, gmockMethodAddr, paramCount)    \
   testing::GMockPlus GMOCKPLUS_CONCAT_TOKEN_(gmockplusObj_, __LINE__)(testing::internal::GetMethodAddr(srcMethodAddr), &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::THIS_CALL, paramCount)
@@ -18,6 +27,15 @@
 #define GMOCKPLUS_STATICMETHODCALL(srcMethodAddr, gmockObj, gmockMethodAddr, paramCount)    \
   testing::GMockPlus GMOCKPLUS_CONCAT_TOKEN_(gmockplusObj_, __LINE__)(testing::internal::GetMethodAddr(srcMethodAddr), &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::STATIC_METHOD_CALL, paramCount)
 
+#ifndef _WIN32
+// 通过改写moduleName的导入表来mock其中对symbolName的调用，见GMockPlusImport
+#define GMOCKPLUS_IMPORT_CDECL(moduleName, symbolName, gmockObj, gmockMethodAddr, paramCount) \
+  testing::GMockPlusImport GMOCKPLUS_CONCAT_TOKEN_(gmockplusImport_, __LINE__)(moduleName, symbolName, &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::CDECL_CALL, paramCount)
+
+#define GMOCKPLUS_IMPORT_THISCALL(moduleName, symbolName, gmockObj, gmockMethodAddr, paramCount) \
+  testing::GMockPlusImport GMOCKPLUS_CONCAT_TOKEN_(gmockplusImport_, __LINE__)(moduleName, symbolName, &gmockObj, testing::internal::GetMethodAddr(gmockMethodAddr), true, testing::THIS_CALL, paramCount)
+#endif
+
 namespace testing {
 
 #define GMOCKPLUS_CONCAT_TOKEN_(foo, bar)   GMOCKPLUS_CONCAT_TOKEN_IMPL_(foo, bar)
@@ -26,6 +44,7 @@ namespace testing {
 // WARNING:这里不支持带可变参数的函数。
 // 另外，可变参数的成员函数的栈平衡工作不再由成员函数本身来做了（这很合理，因为调用者才会明确的知道有多少个参数）
 // 另外，调用可变参数的成员函数时，也没有再用ecx寄存器来传递this指针了。
+#ifdef _WIN32
 enum CallType {
   INVALID_CALL = -1,
   STD_CALL = 0,
@@ -34,6 +53,19 @@ enum CallType {
   STATIC_METHOD_CALL = CDECL_CALL,
   STATIC_STDCALL_METHOD_CALL = STD_CALL
 };
+#else
+// x86-64上参数都通过寄存器传递，由调用者平衡栈，没有__stdcall；
+// 区别只在于mock对象的this是插在参数最前面（普通函数、静态成员函数），还是替换掉原对象的this（成员函数），
+// 前者要求整型和指针参数不超过5个，浮点参数不受影响，也不支持通过隐藏指针返回的结构体
+enum CallType {
+  INVALID_CALL = -1,
+  STD_CALL = 0,
+  CDECL_CALL = 1,
+  THIS_CALL = 2,
+  STATIC_METHOD_CALL = CDECL_CALL,
+  STATIC_STDCALL_METHOD_CALL = STD_CALL
+};
+#endif
 
 class HookMgr;
 class MockMgr;
@@ -87,7 +119,59 @@ class GTEST_API_ GMockPlus {
   bool m_passParams;
 };
 
-#ifdef _DEBUG
+#ifndef _WIN32
+namespace internal {
+class CodePatch;
+}
+
+/*
+  通过改写模块的导入表（GOT中的表项）来mock动态链接的函数，被mock的函数本身的代码不做任何修改：
+  - hook和unhook都只是对表项的一次原子写入，不需要挂起其他线程，并行执行用例时也可以放心使用；
+  - 只影响moduleName（不带路径的模块名，如：libxxx.so，NULL表示所有已加载的模块）对symbolName的导入，
+    被mock的函数所在模块内部的调用不受影响；moduleName中取到的&func也会变成替换后的函数，
+    所以原来的实现要通过GetNewSrcAddr()取得，而不是QueryNewSrcAddr()；
+  - 其余参数的含义和GMockPlus一样。
+*/
+class GTEST_API_ GMockPlusImport {
+ public:
+  GMockPlusImport(const char* moduleName, const char* symbolName, void* objPtr, void* dstMethodAddr, bool hookImmediately = true, CallType callType = CDECL_CALL, size_t paramCnt = 0, bool passParams = true);
+  GMockPlusImport(const char* moduleName, const char* symbolName, void* dstAddr, bool hookImmediately = true);   // dstAddr 的原型需要和被mock的函数一致
+
+  ~GMockPlusImport();
+
+  bool Hook();    // 没有找到任何导入symbolName的地方时返回false
+  bool Unhook();
+  bool IsHooked() {
+    return !m_slots.empty();
+  }
+  void* GetNewSrcAddr() {
+    return m_newSrcAddr;
+  }
+
+ private:
+  struct Slot {
+    void** addr;
+    void* saved;
+    bool relro;   // 位于加载之后只读的区域（-z relro），写完之后需要恢复成只读
+  };
+
+  std::string m_moduleName;
+  std::string m_symbolName;
+  void* m_dstAddr;
+  void* m_objPtr;
+  void* m_dstMethodAddr;
+  CallType m_callType;
+  size_t m_paramCnt;
+  bool m_passParams;
+  void* m_newSrcAddr;
+  internal::CodePatch* m_relay;
+  std::vector<Slot> m_slots;
+};
+#endif
+
+#ifndef _WIN32
+#define ASSERT(expression)  assert(expression)
+#elif defined(_DEBUG)
 #define ASSERT(expression)  \
   if (! (expression)) \
   {   \
@@ -112,6 +196,7 @@ inline void* GetMethodAddr(T func) {
 void HookAll();
 void UnhookAll();
 
+#ifdef _WIN32
 // 鉴于 dbghelp 的限制，Symbol相关的函数“不”是线程安全的
 GTEST_API_ bool SetSymSearchPath(const wchar_t* utf16Path);
 
@@ -144,5 +229,16 @@ FuncT QueryNewSrcAddr(FuncT srcAddr) {
 
   return result;
 }
+#else
+template<class FuncT>
+FuncT QueryNewSrcAddr(FuncT srcAddr) {
+  FuncT result = srcAddr;
+  void* newSrcAddr = internal::QueryNewSrcAddrImpl_(internal::GetMethodAddr(srcAddr));
+  // 成员函数指针的第一个字就是函数地址，后面的this调整量保持不变
+  memcpy(&result, &newSrcAddr, sizeof(newSrcAddr));
+
+  return result;
+}
+#endif
 
 } // namespace testing {
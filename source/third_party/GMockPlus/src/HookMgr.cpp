@@ -91,10 +91,12 @@ bool HookMgr::HookAll() {
       if (DetourAttach(&((*it)->m_newSrcAddr), (*it)->m_dstAddr) != NO_ERROR) {
         attachFailed = true;
         OutputDebugStringW(L"DetourAttach Failed! 可能是因为在函数入口处设置了断点，请把这个断点移除再重试！");
+      } else if (!MockMgr::GetInstance()->AddMockFuncInfo(*it)) {
+        // 放在commit之前Add，如果commit之后才Add的话可能会导致其他线程调用到MockFunction函数时找不到对应的srcFunc
+        attachFailed = true;
+        OutputDebugStringW(L"AddMockFuncInfo Failed! 同一个函数已经被mock了，不能重复mock！");
       } else {
         (*it)->m_hooked = true;
-        // 放在commit之前Add，如果commit之后才Add的话可能会导致其他线程调用到MockFunction函数时找不到对应的srcFunc
-        MockMgr::GetInstance()->AddMockFuncInfo(*it);
       }
     }
 
@@ -1,10 +1,20 @@
 ﻿#pragma once
 #include "GMockPlus.h"
 #include <vector>
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <map>
+#endif
 
 namespace testing {
 
+#ifndef _WIN32
+namespace internal {
+class CodePatch;
+}
+#endif
+
 class HookMgr {
  public:
   static HookMgr* GetInstance();
@@ -19,14 +29,22 @@ class HookMgr {
  private:
   HookMgr() {}
 
+#ifdef _WIN32
   bool UpdateAllThread();
   void CloseAllHandle();
+#endif
 
  private:
   typedef std::vector<GMockPlus*> MockInfoVec;
   MockInfoVec m_hookInfos;
   MockInfoVec m_unhookInfos;
+#ifdef _WIN32
   std::vector<HANDLE> m_threads;
+#else
+  // 每个已经hook的函数对应的补丁，Unhook时用来恢复原来的指令，见linux/HookMgr.cpp
+  typedef std::map<GMockPlus*, internal::CodePatch*> PatchMap;
+  PatchMap m_patches;
+#endif
 };
 
 } // namespace testing {
@@ -3,6 +3,16 @@
 
 namespace testing {
 
+static void* const TOMBSTONE = (void*)1;
+
+static size_t HashAddr(void* addr) {
+  size_t h = (size_t)addr;
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return h;
+}
+
 MockMgr* MockMgr::GetInstance() {
   static MockMgr* mgr = NULL;
   if (mgr == NULL) {
@@ -12,18 +22,48 @@ MockMgr* MockMgr::GetInstance() {
   return mgr;
 }
 
-GMockPlus* MockMgr::QueryMockInfo(void* srcAddr) {
-  ASSERT(srcAddr);
-  GMockPlus* result = NULL;
+MockMgr::Slot* MockMgr::FindSlot(void* srcAddr) {
+  if (m_slots.empty()) {
+    return NULL;
+  }
 
-  MockInfoSet::iterator it = m_mockInfoSet.begin();
-  for (; it != m_mockInfoSet.end(); ++it) {
-    if ((*it)->m_srcAddr == srcAddr) {
-      result = *it;
-      break;
+  size_t mask = m_slots.size() - 1;
+  for (size_t i = HashAddr(srcAddr) & mask; ; i = (i + 1) & mask) {
+    Slot& slot = m_slots[i];
+    if (slot.srcAddr == srcAddr) {
+      return &slot;
+    }
+    if (slot.srcAddr == NULL) {
+      return NULL;
+    }
+  }
+}
+
+void MockMgr::Rehash(size_t capacity) {
+  std::vector<Slot> slots(capacity);
+  slots.swap(m_slots);
+
+  size_t mask = capacity - 1;
+  std::vector<Slot>::iterator it = slots.begin();
+  for (; it != slots.end(); ++it) {
+    if (it->srcAddr == NULL || it->srcAddr == TOMBSTONE) {
+      continue;
+    }
+    size_t i = HashAddr(it->srcAddr) & mask;
+    while (m_slots[i].srcAddr != NULL) {
+      i = (i + 1) & mask;
     }
+    m_slots[i] = *it;
   }
+  m_used = m_count;
+}
+
+GMockPlus* MockMgr::QueryMockInfo(void* srcAddr) {
+  ASSERT(srcAddr);
+  Slot* slot = FindSlot(srcAddr);
+  GMockPlus* result = slot ? slot->info : NULL;
 
+#ifdef _WIN32
   if (!result) {  // Debug版本通过PDB获取到的函数地址与直接写函数指针得到的地址不一样
     void* jmpSrcAddr = NULL;
     byte binArr[5] = {0};
@@ -32,27 +72,52 @@ GMockPlus* MockMgr::QueryMockInfo(void* srcAddr) {
       jmpSrcAddr = (byte*)srcAddr + *(unsigned int*)(&binArr[1]) + 5;
     }
     if (jmpSrcAddr) {
-      it = m_mockInfoSet.begin();
-      for (; it != m_mockInfoSet.end(); ++it) {
-        if ((*it)->m_srcAddr == jmpSrcAddr) {
-          result = *it;
-          break;
-        }
-      }
+      slot = FindSlot(jmpSrcAddr);
+      result = slot ? slot->info : NULL;
     }
   }
+#endif
 
   return result;
 }
 
-void MockMgr::AddMockFuncInfo(GMockPlus* info) {
-  ASSERT(m_mockInfoSet.find(info) == m_mockInfoSet.end());
-  m_mockInfoSet.insert(info);
+bool MockMgr::AddMockFuncInfo(GMockPlus* info) {
+  if (FindSlot(info->m_srcAddr) != NULL) {
+    return false;
+  }
+
+  if ((m_used + 1) * 2 > m_slots.size()) {
+    size_t capacity = m_slots.empty() ? 16 : m_slots.size();
+    while ((m_count + 1) * 2 > capacity) {
+      capacity *= 2;
+    }
+    Rehash(capacity);
+  }
+
+  size_t mask = m_slots.size() - 1;
+  size_t i = HashAddr(info->m_srcAddr) & mask;
+  while (m_slots[i].srcAddr != NULL && m_slots[i].srcAddr != TOMBSTONE) {
+    i = (i + 1) & mask;
+  }
+  if (m_slots[i].srcAddr == NULL) {
+    ++m_used;
+  }
+  m_slots[i].srcAddr = info->m_srcAddr;
+  m_slots[i].info = info;
+  ++m_count;
+  return true;
 }
 
-void MockMgr::DelMockFuncInfo(GMockPlus* info) {
-  ASSERT(m_mockInfoSet.find(info) != m_mockInfoSet.end());
-  m_mockInfoSet.erase(info);
+bool MockMgr::DelMockFuncInfo(GMockPlus* info) {
+  Slot* slot = FindSlot(info->m_srcAddr);
+  if (slot == NULL || slot->info != info) {
+    return false;
+  }
+
+  slot->srcAddr = TOMBSTONE;
+  slot->info = NULL;
+  --m_count;
+  return true;
 }
 
 } // namespace testing {
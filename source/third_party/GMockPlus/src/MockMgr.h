@@ -1,6 +1,6 @@
 ﻿#pragma once
 #include "GMockPlus.h"
-#include <set>
+#include <vector>
 
 namespace testing {
 
@@ -9,16 +9,29 @@ class MockMgr {
   static MockMgr* GetInstance();
   ~MockMgr() {}
 
-  void AddMockFuncInfo(GMockPlus* info);
-  void DelMockFuncInfo(GMockPlus* info);
+  // 同一个m_srcAddr只能有一个info，已经有了时不添加，返回false
+  bool AddMockFuncInfo(GMockPlus* info);
+  // 只有m_srcAddr对应的正是info时才删除，否则返回false
+  bool DelMockFuncInfo(GMockPlus* info);
   GMockPlus* QueryMockInfo(void* srcAddr);
 
  private:
-  MockMgr() {}
+  MockMgr() : m_count(0), m_used(0) {}
+
+  // 被mock的函数每次被调用都要查一次（见MockFunctionJmpTo），所以用m_srcAddr作键的开放寻址哈希表，
+  // 线性探测，容量是2的幂，删除时留下墓碑，查询是O(1)的
+  struct Slot {
+    void* srcAddr;    // NULL表示空位，TOMBSTONE表示已删除
+    GMockPlus* info;
+  };
+
+  Slot* FindSlot(void* srcAddr);
+  void Rehash(size_t capacity);
 
-  typedef std::set<GMockPlus*> MockInfoSet;
  private:
-  MockInfoSet m_mockInfoSet;
+  std::vector<Slot> m_slots;
+  size_t m_count;   // 有效的元素个数
+  size_t m_used;    // 有效的元素和墓碑的个数，超过容量的一半时扩容或者重建
 };
 
 } // namespace testing {
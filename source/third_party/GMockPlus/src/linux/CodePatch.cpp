@@ -0,0 +1,703 @@
+﻿#include "CodePatch.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace testing {
+namespace internal {
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////
+// 每个CodePatch独占一页可执行内存，前一半放relay，后一半放trampoline，尽量映射在被hook的函数附近，
+// 这样入口处只需要写一条短跳转，搬到trampoline中的相对寻址也够得着原来的目标；
+// 新映射的页只有读写权限，生成完代码之后改成只读可执行，之后不会再写（见CodePatch::Seal()）
+
+const size_t kSlotSize = 128;
+
+size_t PageSize() {
+  static size_t pageSize = (size_t)::sysconf(_SC_PAGESIZE);
+  return pageSize;
+}
+
+bool IsNear(const void* a, const void* b, size_t range) {
+  uintptr_t x = (uintptr_t)a;
+  uintptr_t y = (uintptr_t)b;
+  return (x > y ? x - y : y - x) < range;
+}
+
+uint8_t* MapPage(void* hint) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_FIXED_NOREPLACE
+  if (hint) {
+    flags |= MAP_FIXED_NOREPLACE;  // 旧内核不认识这个标志，会当作普通的提示地址，下面会检查实际的地址
+  }
+#endif
+  void* page = ::mmap(hint, PageSize(), PROT_READ | PROT_WRITE, flags, -1, 0);
+  return page == MAP_FAILED ? NULL : (uint8_t*)page;
+}
+
+// 在near附近range以内映射一页，near为NULL时不限制位置
+uint8_t* MapPageNear(const void* near, size_t range) {
+  if (!near) {
+    return MapPage(NULL);
+  }
+
+  const size_t step = 1024 * 1024;
+  uintptr_t center = (uintptr_t)near & ~(uintptr_t)(PageSize() - 1);
+  for (size_t distance = step; distance + PageSize() < range; distance += step) {
+    uintptr_t hints[2] = {center - distance, center + distance};
+    for (int i = 0; i < 2; ++i) {
+      if ((i == 0 && center < distance) || (i == 1 && hints[1] < center)) {
+        continue;
+      }
+      uint8_t* page = MapPage((void*)hints[i]);
+      if (!page) {
+        continue;
+      }
+      if (IsNear(page, near, range - PageSize())) {
+        return page;
+      }
+      ::munmap(page, PageSize());
+    }
+  }
+
+  return NULL;
+}
+
+// 从/proc/self/maps中查出page所在映射的权限，查不到时返回-1
+int QueryProtection(const uint8_t* page) {
+  FILE* maps = fopen("/proc/self/maps", "r");
+  if (!maps) {
+    return -1;
+  }
+
+  int prot = -1;
+  char line[PATH_MAX + 128];
+  while (prot < 0 && fgets(line, sizeof(line), maps)) {
+    unsigned long begin = 0;
+    unsigned long end = 0;
+    char perms[5] = {0};
+    if (sscanf(line, "%lx-%lx %4s", &begin, &end, perms) != 3 || (uintptr_t)page < begin || (uintptr_t)page >= end) {
+      continue;
+    }
+    prot = PROT_NONE;
+    if (perms[0] == 'r') {
+      prot |= PROT_READ;
+    }
+    if (perms[1] == 'w') {
+      prot |= PROT_WRITE;
+    }
+    if (perms[2] == 'x') {
+      prot |= PROT_EXEC;
+    }
+  }
+
+  fclose(maps);
+  return prot;
+}
+
+// 修改代码段：逐页在原来的权限上临时加上写权限（同一页上的其他代码可能正在执行，不能去掉执行权限），
+// 写完之后恢复成原来的权限，并刷新指令缓存
+bool WriteCode(uint8_t* dst, const uint8_t* src, size_t size) {
+  uint8_t* begin = (uint8_t*)((uintptr_t)dst & ~(uintptr_t)(PageSize() - 1));
+  size_t pageCount = (dst + size - begin + PageSize() - 1) / PageSize();
+  int prots[2];   // 最多写16字节，最多跨两页
+  size_t unlocked = 0;
+  bool ok = pageCount <= 2;
+  while (ok && unlocked < pageCount) {
+    uint8_t* page = begin + unlocked * PageSize();
+    prots[unlocked] = QueryProtection(page);
+    ok = prots[unlocked] >= 0 && ::mprotect(page, PageSize(), prots[unlocked] | PROT_WRITE) == 0;
+    if (ok) {
+      ++unlocked;
+    }
+  }
+
+  if (ok) {
+    memcpy(dst, src, size);
+    __builtin___clear_cache((char*)dst, (char*)dst + size);
+  }
+  for (size_t i = 0; i < unlocked; ++i) {
+    ::mprotect(begin + i * PageSize(), PageSize(), prots[i]);
+  }
+  return ok;
+}
+
+void Put32(uint8_t* p, uint32_t value) {
+  memcpy(p, &value, sizeof(value));
+}
+
+void Put64(uint8_t* p, uint64_t value) {
+  memcpy(p, &value, sizeof(value));
+}
+
+uint32_t Get32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+#if defined(__x86_64__)
+
+//////////////////////////////////////////////////////////////////////////
+// x86-64：入口写jmp rel32（5字节），relay太远时写jmp [rip+0]加8字节的绝对地址（14字节）
+
+const size_t kNearRange = 0x7FF00000;  // rel32能够到的范围，留一点余量
+const size_t kMaxShiftParams = 5;      // rdi、rsi、rdx、rcx、r8依次后移一位，r9中的第6个参数会被挤掉
+
+bool FitsRel32(const uint8_t* next, const uint8_t* target) {
+  int64_t offset = (int64_t)(target - next);
+  return offset >= INT32_MIN && offset <= INT32_MAX;
+}
+
+size_t JumpSize(const uint8_t* from, const uint8_t* to) {
+  return FitsRel32(from + 5, to) ? 5 : 14;
+}
+
+// 把从pc跳到to的指令写到at，at和pc不同时用来先在别处生成、再整体写入pc
+size_t EmitJump(uint8_t* at, const uint8_t* to, const uint8_t* pc) {
+  if (FitsRel32(pc + 5, to)) {
+    at[0] = 0xE9;   // jmp rel32
+    Put32(at + 1, (uint32_t)(to - (pc + 5)));
+    return 5;
+  }
+  at[0] = 0xFF;     // jmp qword ptr [rip+0]
+  at[1] = 0x25;
+  Put32(at + 2, 0);
+  Put64(at + 6, (uint64_t)to);
+  return 14;
+}
+
+size_t EmitJump(uint8_t* at, const uint8_t* to) {
+  return EmitJump(at, to, at);
+}
+
+struct Insn {
+  enum Kind {
+    NORMAL,
+    JMP,            // jmp rel8/rel32
+    CALL,           // call rel32
+    JCC,            // jcc rel8/rel32
+    RET,            // ret、ud2等，执行不会落到下一条指令
+    INDIRECT_JMP    // jmp r/m64
+  };
+
+  Kind kind;
+  size_t length;
+  int ripDisp;      // RIP相对寻址的disp32在指令中的偏移，没有时为-1
+  size_t relSize;   // 相对跳转的偏移量的字节数，偏移量总在指令的末尾
+  int cond;         // JCC的条件码
+  bool isPadding;   // nop或int3，函数末尾的填充
+};
+
+void SkipModRM(const uint8_t*& p, const uint8_t* start, Insn& insn) {
+  uint8_t modrm = *p++;
+  uint8_t mod = modrm >> 6;
+  uint8_t rm = modrm & 7;
+  if (mod == 3) {
+    return;
+  }
+  if (rm == 4) {
+    uint8_t sib = *p++;
+    if (mod == 0 && (sib & 7) == 5) {
+      p += 4;
+    }
+  } else if (mod == 0 && rm == 5) {
+    insn.ripDisp = (int)(p - start);
+    p += 4;
+  }
+  if (mod == 1) {
+    p += 1;
+  } else if (mod == 2) {
+    p += 4;
+  }
+}
+
+// 解析一条指令的长度和类型，只需要覆盖函数入口处常见的指令，不认识的返回false
+bool Decode(const uint8_t* code, Insn& insn) {
+  insn.kind = Insn::NORMAL;
+  insn.ripDisp = -1;
+  insn.relSize = 0;
+  insn.cond = 0;
+  insn.isPadding = false;
+
+  const uint8_t* p = code;
+  bool opsize16 = false;
+  bool addr32 = false;
+  for (;; ++p) {
+    if (p - code >= 14) {
+      return false;
+    }
+    if (*p == 0x66) {
+      opsize16 = true;
+    } else if (*p == 0x67) {
+      addr32 = true;
+    } else if (*p != 0xF0 && *p != 0xF2 && *p != 0xF3 && *p != 0x2E && *p != 0x36
+               && *p != 0x3E && *p != 0x26 && *p != 0x64 && *p != 0x65) {
+      break;
+    }
+  }
+
+  bool rex = false;
+  bool rexW = false;
+  if ((*p & 0xF0) == 0x40) {
+    rex = true;
+    rexW = (*p & 0x08) != 0;
+    ++p;
+  }
+
+  size_t immz = opsize16 ? 2 : 4;
+  size_t imm = 0;
+  uint8_t op = *p++;
+  if (op == 0x0F) {
+    uint8_t op2 = *p++;
+    if (op2 == 0x38) {
+      ++p;
+      SkipModRM(p, code, insn);
+    } else if (op2 == 0x3A) {
+      ++p;
+      SkipModRM(p, code, insn);
+      imm = 1;
+    } else if (op2 >= 0x80 && op2 <= 0x8F) {
+      insn.kind = Insn::JCC;
+      insn.cond = op2 & 0x0F;
+      insn.relSize = imm = 4;
+    } else if (op2 == 0x05 || op2 == 0x31 || op2 == 0x77 || op2 == 0xA0 || op2 == 0xA1
+               || op2 == 0xA2 || op2 == 0xA8 || op2 == 0xA9 || (op2 >= 0xC8 && op2 <= 0xCF)) {
+      // syscall、rdtsc、emms、push/pop fs/gs、cpuid、bswap
+    } else if (op2 == 0x0B) {
+      insn.kind = Insn::RET;  // ud2
+    } else if ((op2 >= 0x70 && op2 <= 0x73) || op2 == 0xA4 || op2 == 0xAC || op2 == 0xBA
+               || op2 == 0xC2 || (op2 >= 0xC4 && op2 <= 0xC6)) {
+      SkipModRM(p, code, insn);
+      imm = 1;
+    } else if (op2 == 0x01 || op2 == 0x0D || (op2 >= 0x10 && op2 <= 0x1F) || (op2 >= 0x28 && op2 <= 0x2F)
+               || (op2 >= 0x40 && op2 <= 0x6F) || (op2 >= 0x74 && op2 <= 0x76) || (op2 >= 0x7C && op2 <= 0x7F)
+               || (op2 >= 0x90 && op2 <= 0x9F) || op2 == 0xA3 || op2 == 0xA5 || op2 == 0xAB
+               || (op2 >= 0xAD && op2 <= 0xB1) || op2 == 0xB3 || (op2 >= 0xB6 && op2 <= 0xBF && op2 != 0xB9 && op2 != 0xBA)
+               || op2 == 0xC0 || op2 == 0xC1 || op2 == 0xC3 || op2 == 0xC7 || op2 >= 0xD0) {
+      insn.isPadding = (op2 == 0x1F);   // nopl
+      SkipModRM(p, code, insn);
+    } else {
+      return false;
+    }
+  } else if (op == 0xC4 || op == 0xC5) {
+    // VEX前缀：C5后面1个字节，C4后面2个字节，其中C4的低5位是opcode表
+    uint8_t map = 1;
+    if (op == 0xC4) {
+      map = *p & 0x1F;
+      p += 2;
+    } else {
+      p += 1;
+    }
+    uint8_t vexOp = *p++;
+    if (!(map == 1 && vexOp == 0x77)) {   // vzeroupper/vzeroall没有ModRM
+      SkipModRM(p, code, insn);
+    }
+    imm = (map == 3) ? 1 : 0;
+  } else if (op == 0x62) {
+    // EVEX前缀（64位模式下0x62不再是bound）：后面3个字节，第1个字节的低3位是opcode表
+    uint8_t map = *p & 0x07;
+    p += 3;
+    ++p;
+    SkipModRM(p, code, insn);   // disp8会按操作数大小缩放，但指令长度不变
+    imm = (map == 3) ? 1 : 0;
+  } else if (op < 0x40) {
+    uint8_t col = op & 0x0F;
+    if (col == 6 || col == 7 || col == 0x0E || col == 0x0F) {
+      return false;   // 64位模式下无效的push/pop段寄存器、daa等，段前缀已经在上面处理了
+    }
+    switch (col & 7) {
+    case 4:
+      imm = 1;
+      break;
+    case 5:
+      imm = immz;
+      break;
+    default:
+      SkipModRM(p, code, insn);
+      break;
+    }
+  } else if (op >= 0x50 && op <= 0x5F) {
+    // push/pop r64
+  } else if (op >= 0x70 && op <= 0x7F) {
+    insn.kind = Insn::JCC;
+    insn.cond = op & 0x0F;
+    insn.relSize = imm = 1;
+  } else if (op >= 0x84 && op <= 0x8F) {
+    SkipModRM(p, code, insn);
+  } else if (op >= 0x90 && op <= 0x9F && op != 0x9A) {
+    insn.isPadding = (op == 0x90 && !rex);
+  } else if (op >= 0xA0 && op <= 0xA3) {
+    imm = addr32 ? 4 : 8;   // mov al/eax, moffs
+  } else if ((op >= 0xA4 && op <= 0xA7) || (op >= 0xAA && op <= 0xAF)) {
+    // 串操作
+  } else if (op >= 0xB0 && op <= 0xB7) {
+    imm = 1;
+  } else if (op >= 0xB8 && op <= 0xBF) {
+    imm = rexW ? 8 : immz;
+  } else if ((op >= 0xD0 && op <= 0xD3) || (op >= 0xD8 && op <= 0xDF)) {
+    SkipModRM(p, code, insn);
+  } else {
+    switch (op) {
+    case 0x63:
+    case 0xFE:
+      SkipModRM(p, code, insn);
+      break;
+    case 0x69:
+    case 0x81:
+    case 0xC7:
+      SkipModRM(p, code, insn);
+      imm = immz;
+      break;
+    case 0x6B:
+    case 0x80:
+    case 0x83:
+    case 0xC0:
+    case 0xC1:
+    case 0xC6:
+      SkipModRM(p, code, insn);
+      imm = 1;
+      break;
+    case 0x68:
+    case 0xA9:
+      imm = immz;
+      break;
+    case 0x6A:
+    case 0xA8:
+    case 0xCD:
+      imm = 1;
+      break;
+    case 0xC2:
+      insn.kind = Insn::RET;
+      imm = 2;
+      break;
+    case 0xC3:
+      insn.kind = Insn::RET;
+      break;
+    case 0xC8:
+      imm = 3;  // enter imm16, imm8
+      break;
+    case 0xC9:  // leave
+    case 0xF4:
+    case 0xF5:
+    case 0xF8:
+    case 0xF9:
+    case 0xFA:
+    case 0xFB:
+    case 0xFC:
+    case 0xFD:
+      break;
+    case 0xCC:
+      insn.kind = Insn::RET;  // int3
+      insn.isPadding = true;
+      break;
+    case 0xE8:
+      insn.kind = Insn::CALL;
+      insn.relSize = imm = 4;
+      break;
+    case 0xE9:
+      insn.kind = Insn::JMP;
+      insn.relSize = imm = 4;
+      break;
+    case 0xEB:
+      insn.kind = Insn::JMP;
+      insn.relSize = imm = 1;
+      break;
+    case 0xF6:
+    case 0xF7: {
+      uint8_t reg = (*p >> 3) & 7;
+      SkipModRM(p, code, insn);
+      if (reg < 2) {  // test r/m, imm
+        imm = (op == 0xF6) ? 1 : immz;
+      }
+      break;
+    }
+    case 0xFF: {
+      uint8_t reg = (*p >> 3) & 7;
+      SkipModRM(p, code, insn);
+      if (reg == 4 || reg == 5) {
+        insn.kind = Insn::INDIRECT_JMP;
+      }
+      break;
+    }
+    default:
+      return false;   // loop/jrcxz等不好搬移的指令，以及64位模式下无效的指令
+    }
+  }
+
+  p += imm;
+  insn.length = p - code;
+  return true;
+}
+
+int64_t RelOffset(const uint8_t* at, const Insn& insn) {
+  const uint8_t* rel = at + insn.length - insn.relSize;
+  return insn.relSize == 1 ? (int64_t)(int8_t)rel[0] : (int64_t)(int32_t)Get32(rel);
+}
+
+// 把src入口处至少patchSize字节的指令搬到out中，最后跳回src中剩下的指令，返回写入的字节数，失败时返回0
+size_t Relocate(uint8_t* src, size_t patchSize, uint8_t* out, size_t outSize, std::string& error) {
+  size_t copied = 0;
+  size_t written = 0;
+  bool ended = false;
+  while (copied < patchSize) {
+    uint8_t* from = src + copied;
+    Insn insn;
+    if (!Decode(from, insn)) {
+      error = "unsupported instruction at the entry of the function";
+      return 0;
+    }
+    copied += insn.length;
+
+    if (ended) {
+      if (!insn.isPadding) {
+        error = "the function is too short to be hooked";
+        return 0;
+      }
+      continue;
+    }
+    if (written + 32 > outSize) {
+      error = "too many instructions to relocate";
+      return 0;
+    }
+
+    uint8_t* to = out + written;
+    if (insn.kind == Insn::JMP || insn.kind == Insn::CALL || insn.kind == Insn::JCC) {
+      uint8_t* target = from + insn.length + RelOffset(from, insn);
+      if (target >= src && target < src + patchSize) {
+        error = "branch into the bytes to be patched";
+        return 0;
+      }
+
+      if (insn.kind == Insn::JMP) {
+        written += EmitJump(to, target);
+        ended = true;
+      } else if (insn.kind == Insn::CALL) {
+        if (FitsRel32(to + 5, target)) {
+          to[0] = 0xE8;
+          Put32(to + 1, (uint32_t)(target - (to + 5)));
+          written += 5;
+        } else {
+          // call [rip+2]; jmp +8; dq target
+          const uint8_t code[] = {0xFF, 0x15, 0x02, 0x00, 0x00, 0x00, 0xEB, 0x08};
+          memcpy(to, code, sizeof(code));
+          Put64(to + sizeof(code), (uint64_t)target);
+          written += sizeof(code) + 8;
+        }
+      } else {
+        if (FitsRel32(to + 6, target)) {
+          to[0] = 0x0F;
+          to[1] = (uint8_t)(0x80 | insn.cond);
+          Put32(to + 2, (uint32_t)(target - (to + 6)));
+          written += 6;
+        } else {
+          // 条件取反，跳过后面的绝对跳转
+          to[0] = (uint8_t)(0x70 | (insn.cond ^ 1));
+          to[1] = 14;
+          written += 2 + EmitJump(to + 2, target);
+        }
+      }
+      continue;
+    }
+
+    memcpy(to, from, insn.length);
+    if (insn.ripDisp >= 0) {
+      int32_t disp = (int32_t)Get32(from + insn.ripDisp);
+      uint8_t* target = from + insn.length + disp;
+      if (!FitsRel32(to + insn.length, target)) {
+        error = "rip-relative operand out of range after relocation";
+        return 0;
+      }
+      Put32(to + insn.ripDisp, (uint32_t)(target - (to + insn.length)));
+    }
+    written += insn.length;
+    ended = (insn.kind == Insn::RET || insn.kind == Insn::INDIRECT_JMP);
+  }
+
+  if (!ended) {
+    written += EmitJump(out + written, src + copied);
+  }
+  return written;
+}
+
+// 跳过PLT：jmp [rip+disp]后面跟着push（延迟绑定）、nop（.plt.got）或者前面有endbr64（.plt.sec）
+uint8_t* SkipJumpStubs(uint8_t* code, std::string& error) {
+  for (int hops = 0; hops < 4; ++hops) {
+    uint8_t* p = code;
+    bool plt = false;
+    if (p[0] == 0xF3 && p[1] == 0x0F && p[2] == 0x1E && p[3] == 0xFA) {
+      p += 4;
+      plt = true;
+    }
+    if (p[0] == 0xF2) {
+      ++p;
+    }
+    if (!(p[0] == 0xFF && p[1] == 0x25)) {
+      return code;
+    }
+    uint8_t* next = p + 6;
+    if (!plt && !(next[0] == 0x68 || (next[0] == 0x66 && next[1] == 0x90) || next[0] == 0x0F || next[0] == 0x90)) {
+      return code;  // 普通的间接跳转，比如通过函数指针的尾调用
+    }
+
+    uint8_t* target = *(uint8_t**)(next + (int32_t)Get32(p + 2));
+    uint8_t* q = target;
+    if (q[0] == 0xF3 && q[1] == 0x0F && q[2] == 0x1E && q[3] == 0xFA) {
+      q += 4;
+    }
+    if (q[0] == 0x68) {
+      error = "the function has not been bound by the dynamic linker yet, call it once before hooking or link with -z now";
+      return NULL;
+    }
+    code = target;
+  }
+  return code;
+}
+
+size_t EmitMethodRelay(uint8_t* out, void* objPtr, void* methodAddr, bool replaceThis) {
+  size_t size = 0;
+  if (!replaceThis) {
+    // 参数依次后移一位，给this腾出rdi
+    const uint8_t shift[] = {
+      0x4D, 0x89, 0xC1,   // mov r9, r8
+      0x49, 0x89, 0xC8,   // mov r8, rcx
+      0x48, 0x89, 0xD1,   // mov rcx, rdx
+      0x48, 0x89, 0xF2,   // mov rdx, rsi
+      0x48, 0x89, 0xFE    // mov rsi, rdi
+    };
+    memcpy(out, shift, sizeof(shift));
+    size += sizeof(shift);
+  }
+  out[size++] = 0x48;     // mov rdi, objPtr
+  out[size++] = 0xBF;
+  Put64(out + size, (uint64_t)objPtr);
+  size += 8;
+  out[size++] = 0x49;     // mov r11, methodAddr
+  out[size++] = 0xBB;
+  Put64(out + size, (uint64_t)methodAddr);
+  size += 8;
+  out[size++] = 0x41;     // jmp r11
+  out[size++] = 0xFF;
+  out[size++] = 0xE3;
+  return size;
+}
+
+#else
+#error "GMockPlus only supports x86-64 on Linux"
+#endif
+
+} // namespace {
+
+CodePatch::CodePatch()
+  : m_target(NULL)
+  , m_page(NULL)
+  , m_trampoline(NULL)
+  , m_relay(NULL)
+  , m_patchSize(0)
+  , m_sealed(false)
+  , m_committed(false) {
+}
+
+CodePatch::~CodePatch() {
+  if (m_page) {
+    ::munmap(m_page, PageSize());
+  }
+}
+
+CodePatch* CodePatch::Create(void* srcAddr, std::string& error) {
+  uint8_t* target = SkipJumpStubs((uint8_t*)srcAddr, error);
+  if (!target) {
+    return NULL;
+  }
+
+  CodePatch* patch = new CodePatch;
+  patch->m_target = target;
+  // trampoline中修正过的相对寻址要够得着原来的目标，所以必须在附近
+  patch->m_page = MapPageNear(target, kNearRange);
+  if (!patch->m_page) {
+    error = "failed to allocate executable memory near the function";
+    delete patch;
+    return NULL;
+  }
+  patch->m_relay = patch->m_page;
+  patch->m_trampoline = patch->m_page + kSlotSize;
+
+  patch->m_patchSize = JumpSize(target, patch->m_relay);
+  if (0 == Relocate(target, patch->m_patchSize, patch->m_trampoline, kSlotSize, error)) {
+    delete patch;
+    return NULL;
+  }
+  memcpy(patch->m_original, target, patch->m_patchSize);
+  return patch;
+}
+
+CodePatch* CodePatch::CreateRelay(std::string& error) {
+  CodePatch* patch = new CodePatch;
+  patch->m_page = MapPage(NULL);
+  if (!patch->m_page) {
+    error = "failed to allocate executable memory";
+    delete patch;
+    return NULL;
+  }
+  patch->m_relay = patch->m_page;
+  return patch;
+}
+
+bool CodePatch::JumpTo(void* dstAddr, std::string& error) {
+  if (m_sealed) {
+    error = "the relay has already been generated";
+    return false;
+  }
+  EmitJump(m_relay, (uint8_t*)dstAddr);
+  return Seal(error);
+}
+
+bool CodePatch::CallMethod(void* objPtr, void* methodAddr, bool replaceThis, size_t paramCnt, std::string& error) {
+  if (m_sealed) {
+    error = "the relay has already been generated";
+    return false;
+  }
+  if (!replaceThis && paramCnt > kMaxShiftParams) {
+    error = "too many parameters to pass in registers after inserting the mock object";
+    return false;
+  }
+  EmitMethodRelay(m_relay, objPtr, methodAddr, replaceThis);
+  return Seal(error);
+}
+
+bool CodePatch::Seal(std::string& error) {
+  if (::mprotect(m_page, PageSize(), PROT_READ | PROT_EXEC) != 0) {
+    error = "failed to make the relay executable";
+    return false;
+  }
+  __builtin___clear_cache((char*)m_page, (char*)m_page + PageSize());
+  m_sealed = true;
+  return true;
+}
+
+bool CodePatch::Commit() {
+  if (m_committed || m_target == NULL || !m_sealed) {
+    return m_committed;
+  }
+
+  uint8_t code[sizeof(m_original)];
+  EmitJump(code, m_relay, m_target);
+  m_committed = WriteCode(m_target, code, m_patchSize);
+  return m_committed;
+}
+
+bool CodePatch::Revert() {
+  if (!m_committed) {
+    return true;
+  }
+
+  m_committed = !WriteCode(m_target, m_original, m_patchSize);
+  return !m_committed;
+}
+
+} // namespace internal {
+} // namespace testing {
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace testing {
+namespace internal {
+
+/*
+  Linux下hook函数用的代码补丁，只支持x86-64：
+  - 在被hook的函数入口写一条跳转指令，跳到在它附近分配的中转代码（relay）；
+  - 被覆盖的指令按指令长度整条搬到trampoline中，其中的相对寻址都会修正，执行完再跳回原函数的后续指令，
+    所以trampoline就是原来的实现（GMockPlus::GetNewSrcAddr()）；
+  - relay要么直接跳到替换函数，要么把参数整理成mock对象成员函数的调用方式之后再跳过去，
+    每个被hook的函数都有自己的relay，调用时不需要再查找GMockPlus对象。
+  和Windows上一样，修改代码时不会挂起其他线程，需要由调用者保证这期间没有其他线程执行被修改的函数。
+*/
+class CodePatch {
+ public:
+  // 解析srcAddr入口处的指令并生成trampoline，不能hook时返回NULL，原因写到error中
+  static CodePatch* Create(void* srcAddr, std::string& error);
+  // 只生成relay，不修改任何函数，由调用者把GetRelay()填到需要的地方，见linux/ImportHook.cpp
+  static CodePatch* CreateRelay(std::string& error);
+  ~CodePatch();
+
+  // 在Commit()之前二选一，只能调用一次：被hook的函数直接跳到dstAddr；
+  // 或者以objPtr为this调用成员函数methodAddr，replaceThis为true时替换掉原来的this，否则插在原参数的前面；
+  // 生成relay之后，relay和trampoline所在的页就改成只读可执行了
+  bool JumpTo(void* dstAddr, std::string& error);
+  bool CallMethod(void* objPtr, void* methodAddr, bool replaceThis, size_t paramCnt, std::string& error);
+
+  // 在函数入口写入跳转指令，或者恢复原来的指令
+  bool Commit();
+  bool Revert();
+
+  void* GetTrampoline() const {
+    return m_trampoline;
+  }
+  void* GetRelay() const {
+    return m_relay;
+  }
+
+ private:
+  CodePatch();
+
+  // 去掉m_page的写权限，改成只读可执行
+  bool Seal(std::string& error);
+
+  uint8_t* m_target;      // 实际写入跳转指令的地址，已经跳过了PLT
+  uint8_t* m_page;        // 这个补丁独占的一页，存放relay和trampoline
+  uint8_t* m_trampoline;
+  uint8_t* m_relay;
+  size_t m_patchSize;
+  uint8_t m_original[16];
+  bool m_sealed;          // 为true表示relay已经生成，m_page已经是只读可执行的了
+  bool m_committed;
+};
+
+} // namespace internal {
+} // namespace testing {
@@ -0,0 +1,128 @@
+﻿#include "../HookMgr.h"
+#include <stdio.h>
+#include "../MockMgr.h"
+#include "CodePatch.h"
+
+namespace testing {
+
+HookMgr* HookMgr::GetInstance() {
+  static HookMgr* mgr = NULL;
+  if (mgr == NULL) {
+    mgr = new HookMgr;
+  }
+
+  return mgr;
+}
+
+void HookMgr::AddFuncHook(GMockPlus* info) {
+  ASSERT(info != NULL);
+  m_hookInfos.push_back(info);
+}
+
+void HookMgr::AddFuncUnhook(GMockPlus* info) {
+  ASSERT(info != NULL);
+  m_unhookInfos.push_back(info);
+}
+
+bool HookMgr::HookAll() {
+  bool result = false;
+  if (m_hookInfos.empty()) {
+    return result;
+  }
+
+  // 先为所有函数生成补丁，有一个失败就都不hook，和Windows上的事务一致
+  std::vector<internal::CodePatch*> patches;
+  std::string error;
+  MockInfoVec::iterator it = m_hookInfos.begin();
+  for (; it != m_hookInfos.end(); ++it) {
+    GMockPlus* info = *it;
+    ASSERT(!info->m_hooked);
+    internal::CodePatch* patch = internal::CodePatch::Create(info->m_srcAddr, error);
+    if (patch) {
+      bool ok = false;
+      if (info->m_objPtr == NULL) {
+        ok = patch->JumpTo(info->m_dstAddr, error);
+      } else {
+        bool replaceThis = (info->m_callType == THIS_CALL || !info->m_passParams);
+        ok = patch->CallMethod(info->m_objPtr, info->m_dstMethodAddr, replaceThis, info->m_paramCnt, error);
+      }
+      if (!ok) {
+        delete patch;
+        patch = NULL;
+      }
+    }
+    if (patch == NULL) {
+      fprintf(stderr, "GMockPlus: failed to hook %p: %s\n", info->m_srcAddr, error.c_str());
+      break;
+    }
+    patches.push_back(patch);
+  }
+
+  if (patches.size() == m_hookInfos.size()) {
+    result = true;
+    for (size_t i = 0; i < patches.size(); ++i) {
+      GMockPlus* info = m_hookInfos[i];
+      // 放在commit之前Add，如果commit之后才Add的话可能会导致其他线程调用QueryNewSrcAddr时找不到对应的srcFunc
+      if (!MockMgr::GetInstance()->AddMockFuncInfo(info)) {
+        fprintf(stderr, "GMockPlus: %p is already hooked\n", info->m_srcAddr);
+        result = false;
+        break;
+      }
+      info->m_newSrcAddr = patches[i]->GetTrampoline();
+      info->m_hooked = true;
+      if (!patches[i]->Commit()) {
+        fprintf(stderr, "GMockPlus: failed to write the code of %p\n", info->m_srcAddr);
+        result = false;
+        break;
+      }
+    }
+
+    if (!result) {
+      // 撤销已经写入的补丁
+      for (size_t i = 0; i < patches.size() && m_hookInfos[i]->m_hooked; ++i) {
+        patches[i]->Revert();
+        m_hookInfos[i]->m_hooked = false;
+        m_hookInfos[i]->m_newSrcAddr = NULL;
+        MockMgr::GetInstance()->DelMockFuncInfo(m_hookInfos[i]);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < patches.size(); ++i) {
+    if (result) {
+      m_patches[m_hookInfos[i]] = patches[i];
+    } else {
+      delete patches[i];
+    }
+  }
+
+  m_hookInfos.clear();
+  return result;
+}
+
+bool HookMgr::UnhookAll() {
+  if (m_unhookInfos.empty()) {
+    return true;
+  }
+
+  bool result = true;
+  MockInfoVec::iterator it = m_unhookInfos.begin();
+  for (; it != m_unhookInfos.end(); ++it) {
+    ASSERT((*it)->m_hooked);
+    PatchMap::iterator patch = m_patches.find(*it);
+    if (patch == m_patches.end() || !patch->second->Revert()) {
+      result = false;
+      continue;
+    }
+    (*it)->m_hooked = false;
+
+    MockMgr::GetInstance()->DelMockFuncInfo(*it);
+    delete patch->second;
+    m_patches.erase(patch);
+  }
+
+  m_unhookInfos.clear();
+  return result;
+}
+
+} // namespace testing {
@@ -0,0 +1,294 @@
+﻿#include "../GMockPlus.h"
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include "CodePatch.h"
+
+namespace testing {
+
+namespace {
+
+// 通过PLT的调用用的是JUMP_SLOT；取函数地址、-fno-plt的调用以及链接器合并过的.plt.got用的是GLOB_DAT
+const unsigned kJumpSlot = R_X86_64_JUMP_SLOT;
+const unsigned kGlobDat = R_X86_64_GLOB_DAT;
+
+// 同一个表项可能被多个工作线程先后hook，读出原值和写入新值之间不能被打断
+pthread_mutex_t g_slotsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+class SlotsLock {
+ public:
+  SlotsLock() {
+    pthread_mutex_lock(&g_slotsMutex);
+  }
+  ~SlotsLock() {
+    pthread_mutex_unlock(&g_slotsMutex);
+  }
+};
+
+struct ImportQuery {
+  const char* moduleName;   // NULL表示所有模块
+  const char* symbolName;
+  const char* selfName;     // GMockPlus自己所在的模块，不改写它的导入
+  std::vector<void**> slots;
+  std::vector<bool> relro;
+  void* resolved;           // 已经绑定的表项中的地址，即原来的实现
+};
+
+bool InSegment(const dl_phdr_info* info, const ElfW(Phdr)& phdr, const void* addr) {
+  uintptr_t begin = info->dlpi_addr + phdr.p_vaddr;
+  return (uintptr_t)addr >= begin && (uintptr_t)addr < begin + phdr.p_memsz;
+}
+
+// glibc加载时会把.dynamic中的地址加上基址，bionic等则不会
+template <typename T>
+T* DynPtr(const dl_phdr_info* info, ElfW(Addr) ptr) {
+  return (T*)(ptr < info->dlpi_addr ? info->dlpi_addr + ptr : ptr);
+}
+
+void CollectImportSlot(const dl_phdr_info* info, const ElfW(Rela)& rela, const ElfW(Sym)* symtab, const char* strtab,
+                       const ElfW(Phdr)* relro, ImportQuery* query) {
+  unsigned type = ELF64_R_TYPE(rela.r_info);
+  const ElfW(Sym)& sym = symtab[ELF64_R_SYM(rela.r_info)];
+  if ((type != kJumpSlot && !(type == kGlobDat && ELF64_ST_TYPE(sym.st_info) == STT_FUNC))
+      || strcmp(strtab + sym.st_name, query->symbolName) != 0) {
+    return;
+  }
+
+  void** slot = (void**)(info->dlpi_addr + rela.r_offset);
+  if (std::find(query->slots.begin(), query->slots.end(), slot) != query->slots.end()) {
+    return;   // 有的链接器让DT_RELA的范围也包含DT_JMPREL
+  }
+  query->slots.push_back(slot);
+  query->relro.push_back(relro && InSegment(info, *relro, slot));
+
+  // 延迟绑定的表项指向本模块的PLT，还不是被mock的函数
+  bool bound = true;
+  for (int j = 0; j < info->dlpi_phnum && bound; ++j) {
+    bound = !(info->dlpi_phdr[j].p_type == PT_LOAD && InSegment(info, info->dlpi_phdr[j], *slot));
+  }
+  if (bound && !query->resolved) {
+    query->resolved = *slot;
+  }
+}
+
+int CollectImportSlots(dl_phdr_info* info, size_t, void* data) {
+  ImportQuery* query = (ImportQuery*)data;
+  const char* name = info->dlpi_name ? info->dlpi_name : "";
+  if (query->selfName && strcmp(name, query->selfName) == 0) {
+    return 0;
+  }
+  if (query->moduleName) {
+    const char* baseName = strrchr(name, '/');
+    if (strcmp(baseName ? baseName + 1 : name, query->moduleName) != 0) {
+      return 0;
+    }
+  }
+
+  const ElfW(Dyn)* dynamic = NULL;
+  const ElfW(Phdr)* relro = NULL;
+  for (int i = 0; i < info->dlpi_phnum; ++i) {
+    if (info->dlpi_phdr[i].p_type == PT_DYNAMIC) {
+      dynamic = (const ElfW(Dyn)*)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+    } else if (info->dlpi_phdr[i].p_type == PT_GNU_RELRO) {
+      relro = &info->dlpi_phdr[i];
+    }
+  }
+  if (!dynamic) {
+    return 0;
+  }
+
+  const ElfW(Rela)* jmprel = NULL;
+  size_t jmprelSize = 0;
+  const ElfW(Rela)* rela = NULL;
+  size_t relaSize = 0;
+  const ElfW(Sym)* symtab = NULL;
+  const char* strtab = NULL;
+  for (const ElfW(Dyn)* dyn = dynamic; dyn->d_tag != DT_NULL; ++dyn) {
+    switch (dyn->d_tag) {
+    case DT_JMPREL:
+      jmprel = DynPtr<const ElfW(Rela)>(info, dyn->d_un.d_ptr);
+      break;
+    case DT_PLTRELSZ:
+      jmprelSize = dyn->d_un.d_val;
+      break;
+    case DT_RELA:
+      rela = DynPtr<const ElfW(Rela)>(info, dyn->d_un.d_ptr);
+      break;
+    case DT_RELASZ:
+      relaSize = dyn->d_un.d_val;
+      break;
+    case DT_PLTREL:
+      if (dyn->d_un.d_val != DT_RELA) {
+        return 0;   // x86-64只用RELA
+      }
+      break;
+    case DT_SYMTAB:
+      symtab = DynPtr<const ElfW(Sym)>(info, dyn->d_un.d_ptr);
+      break;
+    case DT_STRTAB:
+      strtab = DynPtr<const char>(info, dyn->d_un.d_ptr);
+      break;
+    default:
+      break;
+    }
+  }
+  if (!symtab || !strtab) {
+    return 0;
+  }
+
+  const ElfW(Rela)* tables[2] = {jmprel, rela};
+  const size_t tableSizes[2] = {jmprel ? jmprelSize : 0, rela ? relaSize : 0};
+  for (int table = 0; table < 2; ++table) {
+    for (size_t i = 0; i < tableSizes[table] / sizeof(ElfW(Rela)); ++i) {
+      CollectImportSlot(info, tables[table][i], symtab, strtab, relro, query);
+    }
+  }
+
+  return 0;
+}
+
+// 把value原子地写到slot，不管其他线程是否正在通过这个表项调用
+bool StoreSlot(void** slot, void* value, bool relro) {
+  size_t pageSize = (size_t)::sysconf(_SC_PAGESIZE);
+  void* page = (void*)((uintptr_t)slot & ~(uintptr_t)(pageSize - 1));
+  if (::mprotect(page, pageSize, PROT_READ | PROT_WRITE) != 0) {
+    return false;
+  }
+
+  __atomic_store_n(slot, value, __ATOMIC_RELEASE);
+  if (relro) {
+    ::mprotect(page, pageSize, PROT_READ);
+  }
+  return true;
+}
+
+} // namespace {
+
+GMockPlusImport::GMockPlusImport(
+  const char* moduleName,
+  const char* symbolName,
+  void* objPtr,
+  void* dstMethodAddr,
+  bool hookImmediately/* = true*/,
+  CallType callType /*= CDECL_CALL*/,
+  size_t paramCnt /*= 0*/,
+  bool passParams /*= true*/
+) : m_moduleName(moduleName ? moduleName : "")
+  , m_symbolName(symbolName)
+  , m_dstAddr(NULL)
+  , m_objPtr(objPtr)
+  , m_dstMethodAddr(dstMethodAddr)
+  , m_callType(callType)
+  , m_paramCnt(paramCnt)
+  , m_passParams(passParams)
+  , m_newSrcAddr(NULL)
+  , m_relay(NULL) {
+  ASSERT(symbolName && objPtr && dstMethodAddr);
+  if (hookImmediately) {
+    Hook();
+  }
+}
+
+GMockPlusImport::GMockPlusImport(const char* moduleName, const char* symbolName, void* dstAddr, bool hookImmediately/* = true*/)
+  : m_moduleName(moduleName ? moduleName : "")
+  , m_symbolName(symbolName)
+  , m_dstAddr(dstAddr)
+  , m_objPtr(NULL)
+  , m_dstMethodAddr(NULL)
+  , m_callType(INVALID_CALL)
+  , m_paramCnt(0)
+  , m_passParams(false)
+  , m_newSrcAddr(NULL)
+  , m_relay(NULL) {
+  ASSERT(symbolName && dstAddr);
+  if (hookImmediately) {
+    Hook();
+  }
+}
+
+GMockPlusImport::~GMockPlusImport() {
+  Unhook();
+}
+
+bool GMockPlusImport::Hook() {
+  if (IsHooked()) {
+    return true;
+  }
+
+  std::string error;
+  void* replacement = m_dstAddr;
+  if (m_objPtr) {
+    m_relay = internal::CodePatch::CreateRelay(error);
+    bool replaceThis = (m_callType == THIS_CALL || !m_passParams);
+    if (!m_relay || !m_relay->CallMethod(m_objPtr, m_dstMethodAddr, replaceThis, m_paramCnt, error)) {
+      fprintf(stderr, "GMockPlus: failed to hook %s: %s\n", m_symbolName.c_str(), error.c_str());
+      delete m_relay;
+      m_relay = NULL;
+      return false;
+    }
+    replacement = m_relay->GetRelay();
+  }
+
+  Dl_info self;
+  ImportQuery query;
+  query.moduleName = m_moduleName.empty() ? NULL : m_moduleName.c_str();
+  query.symbolName = m_symbolName.c_str();
+  query.selfName = ::dladdr((void*)&CollectImportSlots, &self) ? self.dli_fname : NULL;
+  query.resolved = NULL;
+
+  SlotsLock lock;
+  ::dl_iterate_phdr(CollectImportSlots, &query);
+  for (size_t i = 0; i < query.slots.size(); ++i) {
+    Slot slot = {query.slots[i], *query.slots[i], query.relro[i]};
+    if (!StoreSlot(slot.addr, replacement, slot.relro)) {
+      fprintf(stderr, "GMockPlus: failed to write the import slot of %s at %p\n", m_symbolName.c_str(), (void*)slot.addr);
+      continue;
+    }
+    m_slots.push_back(slot);
+  }
+
+  m_newSrcAddr = query.resolved ? query.resolved : ::dlsym(RTLD_DEFAULT, m_symbolName.c_str());
+  if (m_slots.empty()) {
+    fprintf(stderr, "GMockPlus: no import of %s found in %s\n", m_symbolName.c_str(),
+            m_moduleName.empty() ? "any module" : m_moduleName.c_str());
+    delete m_relay;
+    m_relay = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool GMockPlusImport::Unhook() {
+  if (!IsHooked()) {
+    return true;
+  }
+
+  void* replacement = m_relay ? m_relay->GetRelay() : m_dstAddr;
+  bool overwritten = false;
+  SlotsLock lock;
+  for (size_t i = 0; i < m_slots.size(); ++i) {
+    // 在这之后又有其他GMockPlusImport hook了同一个表项时，由它在unhook时恢复成我们写入的值，这里不能改回去
+    if (*m_slots[i].addr != replacement) {
+      overwritten = true;
+      continue;
+    }
+    StoreSlot(m_slots[i].addr, m_slots[i].saved, m_slots[i].relro);
+  }
+  m_slots.clear();
+
+  if (overwritten) {
+    fprintf(stderr, "GMockPlus: %s was hooked again before being unhooked, the relay is kept alive\n", m_symbolName.c_str());
+  } else {
+    delete m_relay;
+  }
+  m_relay = NULL;
+  return !overwritten;
+}
+
+} // namespace testing {
@@ -5,6 +5,7 @@
 
 #include "cutest/Event.h"
 #include "cutest/Helper.h"
+#include "cutest/MainThreadTest.h"
 #include "cutest/Runnable.h"
 #include "cutest/Runner.h"
 
@@ -18,6 +19,7 @@ CPPUNIT_NS_BEGIN
 template <class Fixture, unsigned int timeout_ms = 0>
 class ExplicitEndTestCaller
   : public CUTEST_NS::Runnable
+  , public CUTEST_NS::MainThreadTest
   , public CPPUNIT_NS::TestCase
 {
   typedef void ( Fixture::*TestMethod )();
@@ -14,6 +14,8 @@
 CPPUNIT_NS_BEGIN
 
 
+struct TestMetadata;
+
 #if CPPUNIT_NEED_DLL_DECL
 //  template class CPPUNIT_API std::vector<Test *>;
 #endif
@@ -51,6 +53,42 @@ public:
     */
   void addTest( Test *test );
 
+  /*! Adds a test already accepted by isSelected( const TestMetadata & ).
+   * \param test Test to add. Must not be \c NULL.
+   */
+  void addSelectedTest( Test *test );
+
+  /*! Tests if the test described by \a metadata passes the filter and is
+   * accepted by the selection hook (see setSelectionHook()), without making
+   * the test.
+   *
+   * Each test must be checked only once while the test tree is built,
+   * since the shards are assigned in order (see Runner::setSharding()).
+   * \param metadata Static description of the test.
+   * \return \c true if the test should be made and added.
+   */
+  static bool isSelected( const TestMetadata &metadata );
+
+  /*! Same as isSelected( const TestMetadata & ) for a test already made.
+   * \param name Full name of the test.
+   */
+  static bool isSelected( const std::string &name );
+
+  /*! Decides if a test that passed the filter belongs to this process, such
+   * as the shard selection of the runner (see Runner::setSharding()).
+   * \param suiteName Name of the test case, or \c NULL if only the full name
+   *                  of the test is known.
+   * \param testName Name of the test, or its full name if \a suiteName is \c NULL.
+   */
+  typedef bool (*SelectionHook)( const char *suiteName, const char *testName );
+
+  /*! Sets the hook called by isSelected() for the tests passing the filter.
+   *
+   * Must be set before the test tree is made. \c NULL (the default) selects
+   * every test passing the filter.
+   */
+  static void setSelectionHook( SelectionHook hook );
+
   /*! Returns the list of the tests (DEPRECATED).
    * \deprecated Use getChildTestCount() & getChildTestAt() of the 
    *             TestComposite interface instead.
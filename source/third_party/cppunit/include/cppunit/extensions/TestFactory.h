@@ -8,6 +8,21 @@ CPPUNIT_NS_BEGIN
 
 class Test;
 
+/*! \brief Static description of the single test made by a TestFactory.
+ *
+ * It is known without calling TestFactory::makeTest(), so tests can be
+ * filtered before any Test object is constructed.
+ */
+struct TestMetadata
+{
+  const char *suiteName;   ///< Name of the test case, such as "MoneyTest".
+  const char *testName;    ///< Name of the test in its test case.
+  const char *fileName;    ///< Source file the test is defined in.
+  int lineNumber;          ///< Line of the definition in \a fileName.
+  unsigned int timeoutMs;  ///< Timeout of an explicit end test, 0 if none.
+  bool mainThread;         ///< Must run on the main thread, see CUTEST_NS::MainThreadTest.
+};
+
 /*! \brief Abstract Test factory.
  */
 class CPPUNIT_API TestFactory 
@@ -19,6 +34,13 @@ public:
    * \return A new Test.
    */
   virtual Test* makeTest() = 0;
+
+  /*! Returns the description of the test made by makeTest().
+   * \return Static metadata of the test, or \c NULL if the factory makes
+   *         a suite (such as TestFactoryRegistry) or the test is only
+   *         known once it is made.
+   */
+  virtual const TestMetadata *metadata() const { return 0; }
 };
 
 
@@ -14,6 +14,7 @@
 #include <cppunit/portability/CppUnitVector.h>
 #endif
 #include <cppunit/extensions/TestFactory.h>
+#include <cppunit/SynchronizedObject.h>
 #include <string>
 
 CPPUNIT_NS_BEGIN
@@ -117,6 +118,8 @@ public:
 
   /** Adds the specified TestFactory to the registry.
    *
+   * Registering a factory already registered does nothing. Takes constant
+   * time, so registering the tests of a large suite is linear.
    * \param factory Factory to register. 
    */
   void registerFactory( TestFactory *factory );
@@ -156,6 +159,37 @@ public:
    */
   static bool isValid();
 
+  /*! Returns the factories registered so far, in registration order.
+   *
+   * \param factories Receives a copy of the registered factories, so that it
+   *                  can be walked while other threads keep registering.
+   */
+  void getFactories( CppUnitVector<TestFactory *> &factories ) const;
+
+  /*! Sets the lock guarding all the registries and the list of registries.
+   *
+   * Test libraries register their tests from static constructors. By default
+   * registration is not synchronized; install a real lock before registering
+   * or looking registries up from several threads. The lock is not owned by the
+   * registry, and \c NULL restores the default.
+   */
+  static void setSynchronizationObject( SynchronizedObject::SynchronizationObject *syncObject );
+
+  /*! \brief Locks the lock set by setSynchronizationObject() in the current scope.
+   *
+   * Also used by the other registrations made from static constructors, such
+   * as TestSuite::RegisterSetUpTestCase().
+   */
+  class CPPUNIT_API RegistrationZone
+  {
+  public:
+    RegistrationZone();
+    ~RegistrationZone();
+
+  private:
+    SynchronizedObject::SynchronizationObject *m_syncObject;
+  };
+
   /** Adds the specified TestFactory with a specific name (DEPRECATED).
    * \param name Name associated to the factory.
    * \param factory Factory to register. 
@@ -172,7 +206,16 @@ private:
 #if 0
   typedef CppUnitSet<TestFactory *, std::less<TestFactory*> > Factories;
 #else // _CUTEST_IMPL
+  // Factories in registration order. An unregistered factory leaves a NULL
+  // slot behind, which is squeezed out once half of the slots are NULL.
   typedef CppUnitVector<TestFactory *> Factories;
+  // Index of each registered factory in m_factories. Defined in the .cpp, so
+  // that the hashed container it uses does not leak into this header.
+  class FactoryIndexes;
+
+  FactoryIndexes *m_indexes;
+
+  void compactFactories();
 #endif
   Factories m_factories;
 
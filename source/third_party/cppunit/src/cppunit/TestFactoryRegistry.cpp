@@ -1,18 +1,57 @@
 #include <cppunit/config/SourcePrefix.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
-#include <cppunit/portability/CppUnitMap.h>
 #include <cppunit/TestSuite.h>
 #include <assert.h>
+#if defined(_MSC_VER) && _MSC_VER < 1600
+#include <cppunit/portability/CppUnitMap.h>
+#else
+#include <unordered_map>
+#endif
 
 
 CPPUNIT_NS_BEGIN
 
+#if defined(_MSC_VER) && _MSC_VER < 1600
+// No <unordered_map> before VS2010: ordered maps keep registration O(log n).
+typedef CppUnitMap<TestFactory *, size_t, std::less<TestFactory *> > FactoryIndexMap;
+typedef CppUnitMap<std::string, TestFactoryRegistry *, std::less<std::string> > RegistryMap;
+#else
+typedef std::unordered_map<TestFactory *, size_t> FactoryIndexMap;
+typedef std::unordered_map<std::string, TestFactoryRegistry *> RegistryMap;
+#endif
+
+
+/*! \brief (INTERNAL) Index of each factory registered in a TestFactoryRegistry.
+ */
+class TestFactoryRegistry::FactoryIndexes : public FactoryIndexMap
+{
+};
+
+/*! \brief (INTERNAL) Lock used until TestFactoryRegistry::setSynchronizationObject() is called.
+ */
+static SynchronizedObject::SynchronizationObject *noRegistrationLock()
+{
+  static SynchronizedObject::SynchronizationObject noLock;
+  return &noLock;
+}
+
+
+/*! \brief (INTERNAL) Lock set by TestFactoryRegistry::setSynchronizationObject().
+ */
+static SynchronizedObject::SynchronizationObject *&registrationLock()
+{
+  static SynchronizedObject::SynchronizationObject *lock = noRegistrationLock();
+  return lock;
+}
+
+
 /*! \brief (INTERNAL) List of all TestFactoryRegistry.
  */
 class TestFactoryRegistryList
 {
 private:
-  typedef CppUnitMap<std::string, TestFactoryRegistry *, std::less<std::string> > Registries;
+  // Hashed: every GTEST test looks up both its suite registry and the root one.
+  typedef RegistryMap Registries;
   Registries m_registries;
 
   enum State {
@@ -71,6 +110,7 @@ public:
     if ( !isValid() )         // release mode
       return NULL;            // => force CRASH
 
+    TestFactoryRegistry::RegistrationZone zone;
     return getInstance()->getInternalRegistry( name );
   }
 
@@ -83,6 +123,7 @@ public:
 
 
 TestFactoryRegistry::TestFactoryRegistry( std::string name ) :
+    m_indexes( new FactoryIndexes() ),
     m_name( name )
 {
 }
@@ -90,6 +131,7 @@ TestFactoryRegistry::TestFactoryRegistry( std::string name ) :
 
 TestFactoryRegistry::~TestFactoryRegistry()
 {
+  delete m_indexes;
 }
 
 
@@ -111,14 +153,12 @@ TestFactoryRegistry::registerFactory( const std::string &,
 void 
 TestFactoryRegistry::registerFactory( TestFactory *factory )
 {
+  RegistrationZone zone;
 #if 0
   m_factories.insert( factory );
 #else
-  Factories::iterator it = std::find( m_factories.begin(), m_factories.end(), factory );
-  if ( it == m_factories.end() )
-  {
+  if ( m_indexes->insert( FactoryIndexes::value_type( factory, m_factories.size() ) ).second )
     m_factories.push_back( factory );
-  }  
 #endif
 }
 
@@ -126,15 +166,38 @@ TestFactoryRegistry::registerFactory( TestFactory *factory )
 void 
 TestFactoryRegistry::unregisterFactory( TestFactory *factory )
 {
+  RegistrationZone zone;
 #if 0
   m_factories.erase( factory );
 #else
-  Factories::iterator it = std::find( m_factories.begin(), m_factories.end(), factory );
-  if ( it != m_factories.end() )
+  FactoryIndexes::iterator it = m_indexes->find( factory );
+  if ( it == m_indexes->end() )
+    return;
+
+  // Every test unregisters itself on static destruction: erasing from the
+  // vector there would make unloading a test library quadratic.
+  m_factories[ it->second ] = NULL;
+  m_indexes->erase( it );
+  if ( m_indexes->size() * 2 < m_factories.size() )
+    compactFactories();
+#endif
+}
+
+
+void 
+TestFactoryRegistry::compactFactories()
+{
+  size_t count = 0;
+  for ( size_t index = 0; index < m_factories.size(); ++index )
   {
-    m_factories.erase( it );
+    TestFactory *factory = m_factories[ index ];
+    if ( factory == NULL )
+      continue;
+
+    (*m_indexes)[ factory ] = count;
+    m_factories[ count++ ] = factory;
   }
-#endif
+  m_factories.resize( count );
 }
 
 
@@ -157,12 +220,22 @@ TestFactoryRegistry::makeTest()
 void 
 TestFactoryRegistry::addTestToSuite( TestSuite *suite )
 {
-  for ( Factories::iterator it = m_factories.begin(); 
-        it != m_factories.end(); 
+  // Makes the tests without holding the lock: a nested registry locks it again.
+  Factories factories;
+  getFactories( factories );
+  for ( Factories::iterator it = factories.begin(); 
+        it != factories.end(); 
         ++it )
   {
     TestFactory *factory = *it;
-    suite->addTest( factory->makeTest() );
+
+    // Skips the tests filtered out before making them, so that neither the
+    // test nor its name is built.
+    const TestMetadata *metadata = factory->metadata();
+    if ( metadata == NULL )
+      suite->addTest( factory->makeTest() );
+    else if ( TestSuite::isSelected( *metadata ) )
+      suite->addSelectedTest( factory->makeTest() );
   }
 }
 
@@ -174,4 +247,40 @@ TestFactoryRegistry::isValid()
 }
 
 
+void 
+TestFactoryRegistry::getFactories( CppUnitVector<TestFactory *> &factories ) const
+{
+  RegistrationZone zone;
+  factories.clear();
+  factories.reserve( m_indexes->size() );
+  for ( Factories::const_iterator it = m_factories.begin(); 
+        it != m_factories.end(); 
+        ++it )
+  {
+    if ( *it != NULL )
+      factories.push_back( *it );
+  }
+}
+
+
+void 
+TestFactoryRegistry::setSynchronizationObject( SynchronizedObject::SynchronizationObject *syncObject )
+{
+  registrationLock() = syncObject ? syncObject : noRegistrationLock();
+}
+
+
+TestFactoryRegistry::RegistrationZone::RegistrationZone()
+    : m_syncObject( registrationLock() )
+{
+  m_syncObject->lock();
+}
+
+
+TestFactoryRegistry::RegistrationZone::~RegistrationZone()
+{
+  m_syncObject->unlock();
+}
+
+
 CPPUNIT_NS_END
@@ -1,20 +1,58 @@
 #include <cppunit/config/SourcePrefix.h>
 #include <cppunit/TestSuite.h>
 #include <cppunit/TestResult.h>
+#include <cppunit/extensions/TestFactory.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
 
 #ifdef _CUTEST_IMPL
 #include "src/gtest-internal-inl.h"
-#include "src/RunnerBase.h"
+#include "cutest/Helper.h"
 #endif
 
 CPPUNIT_NS_BEGIN
 
 
+/*! \brief (INTERNAL) Hook set by TestSuite::setSelectionHook().
+ */
+static TestSuite::SelectionHook &selectionHook()
+{
+  static TestSuite::SelectionHook hook = NULL;
+  return hook;
+}
+
+
+/*! \brief (INTERNAL) Tests if the test named \a name passes --gtest_filter.
+ */
+static bool matchesFilter( const std::string &name )
+{
+#ifdef _CUTEST_IMPL
+  return testing::internal::UnitTestOptions::FilterMatchesTest( name );
+#else
+  return true;
+#endif
+}
+
+
+/*! \brief (INTERNAL) Same as matchesFilter( const std::string & ), without
+ * building the full name.
+ */
+static bool matchesFilter( const char *suiteName, const char *testName )
+{
+#ifdef _CUTEST_IMPL
+  return testing::internal::UnitTestOptions::FilterMatchesTest( suiteName, testName );
+#else
+  return true;
+#endif
+}
+
+
 /// Default constructor
 TestSuite::TestSuite( std::string name )
     : TestComposite( name )
 {
+#ifdef _CUTEST_IMPL
   CUTEST_NS::initGoogleMock();
+#endif
 }
 
 
@@ -43,7 +81,12 @@ TestSuite::addTest( Test *test )
 {
   if ( 0 == test->getChildTestCount() )
   {
-    if ( testing::internal::UnitTestOptions::FilterMatchesTest( test->getName() ) )
+    // An empty suite is filtered by its name like a test, but takes no
+    // share (see Runner::setSharding()).
+    bool selected = ( NULL == dynamic_cast<TestComposite *>( test ) )
+                    ? isSelected( test->getName() )
+                    : matchesFilter( test->getName() );
+    if ( selected )
     {
       m_tests.push_back( test );
     }
@@ -59,6 +102,42 @@ TestSuite::addTest( Test *test )
 }
 
 
+void 
+TestSuite::addSelectedTest( Test *test )
+{
+  m_tests.push_back( test );
+}
+
+
+bool 
+TestSuite::isSelected( const TestMetadata &metadata )
+{
+  if ( !matchesFilter( metadata.suiteName, metadata.testName ) )
+    return false;
+
+  SelectionHook hook = selectionHook();
+  return hook == NULL  ||  hook( metadata.suiteName, metadata.testName );
+}
+
+
+bool 
+TestSuite::isSelected( const std::string &name )
+{
+  if ( !matchesFilter( name ) )
+    return false;
+
+  SelectionHook hook = selectionHook();
+  return hook == NULL  ||  hook( NULL, name.c_str() );
+}
+
+
+void 
+TestSuite::setSelectionHook( SelectionHook hook )
+{
+  selectionHook() = hook;
+}
+
+
 const CppUnitVector<Test *> &
 TestSuite::getTests() const
 {
@@ -88,31 +167,51 @@ public:
     return &list;
   }
 
+  // Registered from the same static constructors as the test factories, so
+  // guarded by the same lock (see TestFactoryRegistry::setSynchronizationObject()).
   void RegisterSetUpMethod( const std::string &name, TestSuite::SetUpTestCaseMethod set_up_tc )
   {
+    TestFactoryRegistry::RegistrationZone zone;
     TestCaseMethodList::instance()->setUpMethods[name] = set_up_tc;
   }
 
   void RunSetUpTestCase( const std::string &name )
   {
-    SetUpMethods::iterator it = this->setUpMethods.find( name );
-    if (it != this->setUpMethods.end())
+    TestSuite::SetUpTestCaseMethod set_up_tc = NULL;
+    {
+      TestFactoryRegistry::RegistrationZone zone;
+      SetUpMethods::iterator it = this->setUpMethods.find( name );
+      if (it != this->setUpMethods.end())
+      {
+        set_up_tc = it->second;
+      }
+    }
+    if (set_up_tc)
     {
-      (*(it->second))();
+      (*set_up_tc)();
     }
   }
 
   void RegisterTearDownMethod( const std::string &name, TestSuite::TearDownTestCaseMethod tear_down_tc )
   {
+    TestFactoryRegistry::RegistrationZone zone;
     TestCaseMethodList::instance()->tearDownMethods[name] = tear_down_tc;
   }
 
   void RunTearDownTestCase( const std::string &name )
   {
-    TearDownMethods::iterator it = this->tearDownMethods.find( name );
-    if (it != this->tearDownMethods.end())
+    TestSuite::TearDownTestCaseMethod tear_down_tc = NULL;
+    {
+      TestFactoryRegistry::RegistrationZone zone;
+      TearDownMethods::iterator it = this->tearDownMethods.find( name );
+      if (it != this->tearDownMethods.end())
+      {
+        tear_down_tc = it->second;
+      }
+    }
+    if (tear_down_tc)
     {
-      (*(it->second))();
+      (*tear_down_tc)();
     }
   }
 
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include "cutest/Define.h"
+#include "cutest/Runnable.h"
+
+#include <cppunit/portability/CppUnitVector.h>
+#include <string>
+
+CUTEST_NS_BEGIN
+
+// 基准测试的测量参数，时间的单位都是ns
+struct BenchmarkOptions {
+    BenchmarkOptions()
+        : warmup_ns(10000000)
+        , min_sample_ns(1000000)
+        , samples(30)
+        , max_iterations(1000000000) {}
+
+    unsigned long long warmup_ns;      // 正式测量之前至少预热这么长时间，校准迭代次数的时间也计算在内
+    unsigned long long min_sample_ns;  // 每个样本至少持续这么长时间，据此校准每个样本的迭代次数
+    unsigned int samples;              // 样本数
+    unsigned long long max_iterations; // 每个样本的迭代次数上限
+};
+
+/*
+    基准测试的测量结果，除iterations、samples、outliers之外都是单次迭代的耗时，单位：ns
+    - samples_ns保存每个样本的单次迭代耗时（包括离群值），可以用来和其他结果做统计检验；
+    - 离群值按Tukey规则（超出四分位距1.5倍）剔除，其余的统计值都不包含离群值；
+    - ci_low_ns、ci_high_ns为均值的95%置信区间。
+*/
+struct BenchmarkResult {
+    BenchmarkResult()
+        : iterations(0)
+        , outliers(0)
+        , mean_ns(0)
+        , median_ns(0)
+        , p99_ns(0)
+        , stddev_ns(0)
+        , min_ns(0)
+        , max_ns(0)
+        , ci_low_ns(0)
+        , ci_high_ns(0) {}
+
+    unsigned long long iterations; // 每个样本的迭代次数
+    unsigned int outliers;
+    double mean_ns;
+    double median_ns;
+    double p99_ns;
+    double stddev_ns;
+    double min_ns;
+    double max_ns;
+    double ci_low_ns;
+    double ci_high_ns;
+    CppUnitVector<double> samples_ns;
+};
+
+/*
+    反复执行body->run()来测量它的耗时：先校准迭代次数并预热，再采集options.samples个样本，最后计算统计值。
+    每执行完一个样本检查一次*stop（可以为NULL），为true时提前结束并返回false，result中只有已经采集的样本。
+*/
+GTEST_API_ bool measureBenchmark(
+    Runnable* body,
+    const BenchmarkOptions& options,
+    const volatile bool* stop,
+    BenchmarkResult& result);
+
+// 根据result.samples_ns重新计算result的统计值
+GTEST_API_ void computeBenchmarkStatistics(BenchmarkResult& result);
+
+/*
+    和性能基线比较时发现的退化，见Runner::setPerformanceBaseline()，耗时的单位都是ns
+    - 基准测试比较的是单次迭代耗时的中位数，p_value为Mann-Whitney U检验的单侧p值，样本太少没有检验时为-1；
+    - 普通用例比较的是整个用例的耗时，只有一个样本，p_value为-1。
+*/
+struct Regression {
+    Regression()
+        : is_benchmark(false)
+        , baseline_ns(0)
+        , current_ns(0)
+        , p_value(-1) {}
+
+    std::string name; // 用例名
+    bool is_benchmark;
+    double baseline_ns;
+    double current_ns;
+    double p_value;
+};
+
+/*
+    基准测试用例要实现这个接口，如testing::BenchmarkCaller；
+    测量结束之后由用例保存结果，Runner在用例结束时通过ProgressListener::onBenchmarkEnd()通知出去。
+*/
+class BenchmarkTest {
+public:
+    BenchmarkTest()
+        : has_benchmark_result(false) {}
+
+    virtual ~BenchmarkTest() {}
+
+    // 还没有测量结果（比如测量之前就失败了）时返回NULL
+    const BenchmarkResult* benchmarkResult() const {
+        return this->has_benchmark_result ? &this->benchmark_result : NULL;
+    }
+
+    void setBenchmarkResult(const BenchmarkResult& result) {
+        this->benchmark_result = result;
+        this->has_benchmark_result = true;
+    }
+
+    void clearBenchmarkResult() {
+        this->benchmark_result = BenchmarkResult();
+        this->has_benchmark_result = false;
+    }
+
+protected:
+    BenchmarkResult benchmark_result;
+    bool has_benchmark_result;
+};
+
+CUTEST_NS_END
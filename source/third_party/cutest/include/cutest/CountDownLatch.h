@@ -15,7 +15,9 @@ public:
     /*
         调用此方法时：
         - 如果m_count为0，则直接返回；
-        - 如果m_count比0大，会一直等待，直到m_count变成0
+        - 如果m_count比0大，会一直等待，直到m_count变成0；
+        - Android上主线程只能阻塞等待，不能执行其他主线程上的任务，如果delayRunOnMainThread()的任务到期2秒之后
+          m_count还没有变成0，就给当前用例报告错误并返回，避免latch由这个任务countDown()时死锁
     */
     void await();
 
@@ -25,6 +27,7 @@ public:
         - 如果m_count为0，则直接返回true；
         - 如果m_count比0大，会等待一段时间，等待时间内如果m_count变成0，返回true；
         - 如果超出等待时间，m_count还没有变成0，返回false；
+        - Android上主线程可能死锁时同await()，报告错误并返回false。
     */
     bool await(unsigned int timeout_ms);
 
@@ -19,6 +19,15 @@ GTEST_API_ bool isOnMainThread();
 // 返回当前系统的时间，单位为ms
 GTEST_API_ unsigned long long tickCount64();
 
+// 返回单调递增的时刻，单位为ns，不受系统时间调整的影响，只用于计算时间间隔
+GTEST_API_ unsigned long long tickCountNs();
+
+// 把以ns为单位的耗时格式化成以ms为单位的字符串，精确到us，比如"0.125"、"12"
+GTEST_API_ std::string formatElapsedMs(unsigned long long elapsed_ns);
+
+// 把以ns为单位的时间格式化成带单位的字符串，按大小选择ns、us、ms、s，比如"12.3 ns"、"1.25 ms"
+GTEST_API_ std::string formatDuration(double ns);
+
 GTEST_API_ std::string makeFilePathShorter(std::string path);
 
 GTEST_API_ void initGoogleMock();
@@ -4,6 +4,7 @@
 
 #include <jni.h>
 #include <map>
+#include <pthread.h>
 #include <string>
 
 CUTEST_NS_BEGIN
@@ -17,10 +18,22 @@ public:
     void deleteAllGlobalClassRef();
     jclass findGlobalClass(const char* class_name);
 
+    /*
+        查找已注册的class_name中的方法，找不到时返回NULL，is_static为true时查找静态方法；
+        每个类的方法ID只通过JNI查找一次，之后从缓存中返回，可以在任意线程调用。
+    */
+    jmethodID findMethodID(const char* class_name, const char* method_name, const char* signature, bool is_static);
+
 private:
     JClassManager();
+    ~JClassManager();
     typedef std::map<std::string, jclass> JClassMap;
     JClassMap jclass_map;
+
+    typedef std::map<std::string, jmethodID> JMethodMap; // key为方法名和签名
+    typedef std::map<std::string, JMethodMap> JClassMethodMap; // key为类名
+    JClassMethodMap jmethod_map;
+    pthread_mutex_t jmethod_mutex; // 保护jmethod_map
 };
 
 CUTEST_NS_END
@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include "cutest/Define.h"
+
+CUTEST_NS_BEGIN
+
+/*
+    必须在主线程执行的用例要实现这个接口，如ExplicitEndTestCaller；
+    并行执行时，包含这类用例的Suite不会被分配到工作线程，而是放在串行通道上依次执行。
+*/
+class MainThreadTest {
+public:
+    virtual ~MainThreadTest() {}
+};
+
+CUTEST_NS_END
@@ -1,8 +1,10 @@
 ﻿#pragma once
 
+#include "cutest/Benchmark.h"
 #include "cutest/Define.h"
 
 // cppunit
+#include <cppunit/SourceLine.h>
 #include <cppunit/Test.h>
 #include <cppunit/TestFailure.h>
 
@@ -13,6 +15,18 @@
 
 CUTEST_NS_BEGIN
 
+// 超出保留上限而没有逐个通知的失败（见Runner::setFailureRetention()），同一个用例中出错位置和类型都相同的合并为一条
+struct OmittedFailure {
+    OmittedFailure()
+        : is_error(false)
+        , count(0) {}
+
+    CPPUNIT_NS::SourceLine source_line;
+    bool is_error;
+    unsigned int count;  // 合并的失败数
+    std::string message; // 其中第一个失败的描述
+};
+
 class ProgressListener {
 public:
     virtual ~ProgressListener() {}
@@ -25,11 +39,38 @@ public:
 
     virtual void onTestStart(CPPUNIT_NS::Test* test) {}
     virtual void onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) {}
+    // 这个用例中省略的失败，在这个用例的onBenchmarkEnd()、onTestEnd()之前通知，没有省略时不通知
+    virtual void onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<OmittedFailure>& omitted) {}
+    // 基准测试用例（见BENCHMARK_F）测量完成，在这个用例的onTestEnd()之前通知
+    virtual void onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) {}
     virtual void onTestEnd(
         CPPUNIT_NS::Test* test,
         unsigned int error_count,
         unsigned int failure_count,
         unsigned int elapsed_ms) {}
+
+    /*
+        耗时以ns为单位的版本，Runner实际调用的是这几个方法，
+        默认实现把耗时换算成ms之后再调用上面对应的方法，需要更高精度的ProgressListener重载这几个方法即可
+    */
+    virtual void onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
+        onRunnerEnd(test, (unsigned int)(elapsed_ns / 1000000));
+    }
+
+    virtual void onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns) {
+        onSuiteEnd(suite, (unsigned int)(elapsed_ns / 1000000));
+    }
+
+    virtual void onTestEndNs(
+        CPPUNIT_NS::Test* test,
+        unsigned int error_count,
+        unsigned int failure_count,
+        unsigned long long elapsed_ns) {
+        onTestEnd(test, error_count, failure_count, (unsigned int)(elapsed_ns / 1000000));
+    }
+
+    // 和性能基线比较发现了退化（见Runner::setPerformanceBaseline()），在onRunnerEnd()之前通知，按退化比例从大到小排列
+    virtual void onRegressionReport(const CppUnitVector<Regression>& regressions) {}
 };
 
 CUTEST_NS_END
@@ -41,6 +41,113 @@ public: // Help接口族
     virtual void setTreatTimeoutAsError(bool value) = 0;
     virtual bool treatTimeoutAsError() = 0;
 
+    /*
+        设置并行执行用例的工作线程数，需要在start()之前调用
+        - count为0或1时（默认值），所有用例在同一个工作线程上串行执行；
+        - count大于1时，根Suite下互相独立的TestSuite会被分配到count个工作线程上并行执行，
+          每个Suite的事件仍然以Suite为单位完整地通知给ProgressListener，但Suite之间的顺序可能和原来不同；
+        - 包含必须在主线程执行的用例（见MainThreadTest）的Suite，或者alwaysCallTestOnMainThread()为true时，
+          这些Suite会被放在一个串行通道上依次执行。
+    */
+    virtual void setParallelWorkerCount(unsigned int count) = 0;
+    virtual unsigned int parallelWorkerCount() = 0;
+
+    /*
+        设置用例耗时的历史记录文件，需要在start()之前调用，path为NULL或空字符串表示不使用（默认）
+        - 每次执行结束时，把各用例的耗时写回这个文件，分片执行时除外（见setSharding()）；
+        - 并行执行时，根据历史耗时优先调度耗时长的Suite，使总耗时尽量接近耗时最长的那条路径。
+    */
+    virtual void setDurationHistoryFile(const char* path) = 0;
+
+    /*
+        设置是否在子进程中执行用例（进程隔离），需要在start()之前调用，默认为false
+        - 为true时，用例在fork出来的子进程中执行，结果通过管道回传，
+          某个用例崩溃时只有这个用例失败，Runner会重新fork子进程，从下一个用例继续执行；
+        - 必须在主线程执行的用例（见MainThreadTest）仍然在当前进程中执行；
+        - 开启后setParallelWorkerCount()不再生效：同一时刻只有一个子进程，各个分片依次执行，
+          总耗时和只有一个工作线程时相当，再加上每次fork的开销；
+        - 子进程在开始执行分片时才fork，不会预先启动；
+        - 目前只有Linux平台支持，其他平台忽略这个设置。
+    */
+    virtual void setProcessIsolation(bool value) = 0;
+    virtual bool processIsolation() = 0;
+
+    /*
+        设置是否异步地向ProgressListener分发事件，需要在start()之前调用，默认为false
+        - 为false时，工作线程上的每个事件都要等主线程处理完才继续执行；
+        - 为true时，工作线程只把事件放进队列就继续执行，由主线程批量处理，
+          只有Suite结束和整个执行结束时才等待主线程处理完之前的所有事件；
+        - 两种方式下ProgressListener收到的事件及其顺序、耗时都相同，只是通知的时机可能稍晚。
+    */
+    virtual void setAsyncProgressDispatch(bool value) = 0;
+    virtual bool asyncProgressDispatch() = 0;
+
+    /*
+        设置性能基线，需要在start()之前调用，默认不使用
+        @param baseline_path 之前某次执行的结果，为NULL、空字符串或者文件不存在时不做比较
+        @param output_path 执行结束时把本次的结果写到这个文件，可以作为以后的基线，为NULL或空字符串时不写，
+               本次没有执行的用例保留baseline_path中的结果
+        @param threshold_percent 耗时比基线多出这个百分比以上才可能被认为是退化
+        - 基准测试（见BENCHMARK_F）比较单次迭代耗时的样本：中位数超出阈值，
+          并且Mann-Whitney U检验表明确实变慢了（单侧p < 0.01），才认为是退化；
+        - 普通用例只有一个样本，耗时超出阈值并且至少慢了1ms，才认为是退化；
+        - 退化的用例在tearDown()之后通过addFailure()标记为失败，
+          所有退化在执行结束时通过ProgressListener::onRegressionReport()按退化比例从大到小报告。
+    */
+    virtual void setPerformanceBaseline(const char* baseline_path, const char* output_path, unsigned int threshold_percent) = 0;
+
+    /*
+        以JSON Lines格式输出执行过程中的事件，供外部工具实时查看进度，需要在start()之前调用，默认不输出
+        @param target 输出到哪里，为NULL或空字符串时不输出：
+               - 文件或者命名管道的路径，文件已经存在时会被覆盖；
+               - "unix:<path>"，连接到<path>上的Unix domain socket，目前只有Linux平台支持。
+        - 每个事件一行JSON，"event"字段为事件类型：runner_start、suite_start、test_start、failure、
+          failures_omitted、benchmark、test_end、suite_end、regression、runner_end，其余字段见EventStream；
+        - 事件在主线程上写出，配合setAsyncProgressDispatch(true)使用时，读端较慢也不会阻塞执行用例的线程；
+        - 读端关闭之后不再输出，不影响用例的执行。
+    */
+    virtual void setEventStream(const char* target) = 0;
+
+    /*
+        设置分片执行：把同一份用例分成total_shards片，由多个进程（可以在不同的机器上）各执行一片，
+        需要在构造用例树（TestFactoryRegistry::makeTest()）之前调用
+        @param total_shards 分片总数，为0或1时不分片（默认）
+        @param shard_index 本进程执行的分片，从0开始，必须小于total_shards
+        @param balance_by_duration
+               - 为false时，通过--gtest_filter的用例按注册顺序轮流分给各个分片；
+               - 为true时，按setDurationHistoryFile()的历史耗时分配，使各分片的总耗时尽量接近，
+                 需要在这之前设置历史记录文件，没有设置时等同于false。
+        - 所有分片的用例列表和历史记录相同时，每个用例恰好在一个分片中执行；
+        - 分片时不把本次的耗时写回历史记录文件，以免改变其他分片读到的历史记录，
+          需要更新历史记录时单独执行一次不分片的完整测试；
+        - start()之后重新开始分配，再次构造用例树时得到同样的结果；
+        - 分片时给TestSuite安装选择钩子（见TestSuite::setSelectionHook()），通过--gtest_filter的用例由它分配。
+    */
+    virtual void setSharding(unsigned int total_shards, unsigned int shard_index, bool balance_by_duration) = 0;
+
+    /*
+        设置每个用例最多保留多少个失败，需要在start()之前调用，默认为0，表示全部保留
+        - 每个用例的前max_per_test个失败照常保存，并通过ProgressListener::onFailureAdd()逐个通知；
+        - 之后的失败不再保存，只按出错位置和类型合并计数，用例结束时通过ProgressListener::onFailuresOmitted()通知；
+        - onTestEnd()中的错误数、失败数以及errorCount()、failureCount()都包括省略的失败，failureAt()只能取到保存下来的。
+        用例产生大量失败（比如在循环中使用EXPECT_）时，可以用它限制内存占用和输出量。
+    */
+    virtual void setFailureRetention(unsigned int max_per_test) = 0;
+    virtual unsigned int failureRetention() = 0;
+
+    /*
+        列出TestFactoryRegistry::getRegistry()下的用例，供外部的调度、测试影响分析等工具使用，相当于JSON格式的--gtest_list_tests
+        @param output 输出到这个文件，为NULL或空字符串时输出到stdout
+        @return 是否成功写出
+        - 不构造用例（也就不会构造fixture），也不执行，只读取TEST、TEST_F等宏生成的TestMetadata；
+        - 输出一个JSON对象，"tests"中每个用例一行，包括名字（name、suite、test）、定义的位置（file、line）、
+          超时时间timeout_ms（只有ExplicitEndTest有，其余为0），以及thread：必须在主线程执行时为"main"，否则为"any"；
+        - 和gtest一样只经过--gtest_filter的筛选，不考虑分片（见setSharding()），外部工具可以自己分配；
+        - 没有TestMetadata的用例（比如CPPUNIT_TEST_SUITE注册的）要构造之后才知道名字，不列出，
+          "unlisted"为这样的TestFactory的个数。
+    */
+    virtual bool listTests(const char* output) = 0;
+
 public: // Runner接口族
     virtual void addListener(ProgressListener* listener) = 0;
     virtual void removeListener(ProgressListener* listener) = 0;
@@ -55,7 +162,13 @@ public: // Runner接口族
     virtual unsigned int errorCount() const = 0;
     virtual unsigned int failureCount() const = 0;
     virtual unsigned int totalFailureCount() const = 0; // 等于ErrorCount + FailureCount
-    virtual const CPPUNIT_NS::TestFailure* failureAt(unsigned int index) const = 0;
+    virtual const CPPUNIT_NS::TestFailure* failureAt(unsigned int index) const = 0; // index即onFailureAdd()中的index
+
+    /*
+        返回test下的用例数，结果和test->countTestCases()相同；
+        start()时已经把用例树整理成扁平的索引并算好了每个节点的用例数，ProgressListener中应该用它代替countTestCases()
+    */
+    virtual unsigned int countTestCases(CPPUNIT_NS::Test* test) const = 0;
 
 public: // ExplicitEndTest相关接口族
     virtual void registerExplicitEndTest(ExplicitEndTest* test, unsigned int timeout_ms) = 0;
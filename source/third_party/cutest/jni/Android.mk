@@ -15,6 +15,7 @@ LOCAL_LDLIBS := -llog
 #cppunit begin
 CPPUNIT_INC_DIR := \
     $(LOCAL_PATH)/../../cppunit/include \
+    $(LOCAL_PATH)/../../cppunit/src \
     $(LOCAL_PATH)/../../cppunit/src/cppunit
 #cppunit end
 
@@ -47,11 +48,23 @@ LOCAL_SRC_FILES := \
     ./../../googletest/src/gtest-all.cc \
 	./../../googlemock/src/gmock-all.cc \
 	./../src/AutoEndTest.cpp \
+	./../src/Benchmark.cpp \
+	./../src/CountDownLatch.cpp \
+	./../src/DurationHistory.cpp \
+	./../src/EventStream.cpp \
 	./../src/ExplicitEndTest.cpp \
+	./../src/FailureLog.cpp \
 	./../src/Helper.cpp \
+	./../src/ParallelExecutor.cpp \
 	./../src/ProgressListenerManager.cpp \
+	./../src/RegressionGate.cpp \
 	./../src/Result.cpp \
 	./../src/RunnerBase.cpp \
+	./../src/TestIndex.cpp \
+	./../src/TestList.cpp \
+	./../src/TestShard.cpp \
+	./../src/TimerWheel.cpp \
+	./../src/android/CountDownLatchImpl.cpp \
 	./../src/android/DecoratorImpl.cpp \
     ./../src/android/EventImpl.cpp \
 	./../src/android/JClassManager.cpp \
@@ -59,6 +72,7 @@ LOCAL_SRC_FILES := \
 	./../src/android/JniProgressListener.cpp \
 	./../src/android/Logger.cpp \
 	./../src/android/RunnerImpl.cpp \
-	./../src/android/SynchronizationObjectImpl.cpp
+	./../src/android/SynchronizationObjectImpl.cpp \
+	./../src/android/ThreadImpl.cpp
 
 include $(BUILD_SHARED_LIBRARY)
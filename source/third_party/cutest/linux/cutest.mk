@@ -0,0 +1,68 @@
+# libcutest.so for Linux, the counterpart of ../jni/Android.mk
+#
+# Variables expected from the including Makefile:
+#   OUT_DIR : directory receiving libcutest.so and the object files
+
+CUTEST_PATH := $(abspath $(dir $(lastword $(MAKEFILE_LIST)))..)
+THIRD_PARTY_PATH := $(abspath $(CUTEST_PATH)/..)
+
+CUTEST_LIB := $(OUT_DIR)/libcutest.so
+CUTEST_OBJ_DIR := $(OUT_DIR)/obj/cutest
+
+CUTEST_CPPFLAGS := \
+    -D_CUTEST_IMPL \
+    -I$(THIRD_PARTY_PATH)/cppunit/include \
+    -I$(THIRD_PARTY_PATH)/cppunit/src \
+    -I$(THIRD_PARTY_PATH)/cppunit/src/cppunit \
+    -I$(CUTEST_PATH)/include \
+    -I$(CUTEST_PATH) \
+    -I$(THIRD_PARTY_PATH)/googlemock/include \
+    -I$(THIRD_PARTY_PATH)/googlemock \
+    -I$(THIRD_PARTY_PATH)/googletest/include \
+    -I$(THIRD_PARTY_PATH)/googletest
+
+CUTEST_CXXFLAGS := -std=c++11 -fPIC -frtti -fexceptions -O2 -pthread -Wno-deprecated-declarations
+
+CUTEST_LDLIBS := -pthread -ldl
+
+CUTEST_SRC_FILES := \
+    $(THIRD_PARTY_PATH)/cppunit/src/cppunit/cppunit-all.cpp \
+    $(THIRD_PARTY_PATH)/googletest/src/gtest-all.cc \
+    $(THIRD_PARTY_PATH)/googlemock/src/gmock-all.cc \
+    $(CUTEST_PATH)/src/AutoEndTest.cpp \
+    $(CUTEST_PATH)/src/Benchmark.cpp \
+    $(CUTEST_PATH)/src/CountDownLatch.cpp \
+    $(CUTEST_PATH)/src/DurationHistory.cpp \
+    $(CUTEST_PATH)/src/EventStream.cpp \
+    $(CUTEST_PATH)/src/ExplicitEndTest.cpp \
+    $(CUTEST_PATH)/src/FailureLog.cpp \
+    $(CUTEST_PATH)/src/Helper.cpp \
+    $(CUTEST_PATH)/src/ParallelExecutor.cpp \
+    $(CUTEST_PATH)/src/ProgressListenerManager.cpp \
+    $(CUTEST_PATH)/src/RegressionGate.cpp \
+    $(CUTEST_PATH)/src/Result.cpp \
+    $(CUTEST_PATH)/src/RunnerBase.cpp \
+    $(CUTEST_PATH)/src/TestIndex.cpp \
+    $(CUTEST_PATH)/src/TestList.cpp \
+    $(CUTEST_PATH)/src/TestShard.cpp \
+    $(CUTEST_PATH)/src/TimerWheel.cpp \
+    $(CUTEST_PATH)/src/linux/CountDownLatchImpl.cpp \
+    $(CUTEST_PATH)/src/linux/DecoratorImpl.cpp \
+    $(CUTEST_PATH)/src/linux/EventImpl.cpp \
+    $(CUTEST_PATH)/src/linux/IsolatedExecutorImpl.cpp \
+    $(CUTEST_PATH)/src/linux/Logger.cpp \
+    $(CUTEST_PATH)/src/linux/RunnerImpl.cpp \
+    $(CUTEST_PATH)/src/linux/SynchronizationObjectImpl.cpp \
+    $(CUTEST_PATH)/src/linux/ThreadImpl.cpp
+
+CUTEST_OBJ_FILES := $(patsubst $(THIRD_PARTY_PATH)/%,$(CUTEST_OBJ_DIR)/%.o,$(CUTEST_SRC_FILES))
+
+$(CUTEST_OBJ_DIR)/%.o: $(THIRD_PARTY_PATH)/%
+	@mkdir -p $(dir $@)
+	$(CXX) $(CUTEST_CXXFLAGS) $(CUTEST_CPPFLAGS) -MMD -MP -c $< -o $@
+
+$(CUTEST_LIB): $(CUTEST_OBJ_FILES)
+	@mkdir -p $(dir $@)
+	$(CXX) -shared -o $@ $^ $(CUTEST_LDLIBS)
+
+-include $(CUTEST_OBJ_FILES:.o=.d)
@@ -15,12 +15,12 @@ TestTimeoutCounter::TestTimeoutCounter(ExplicitEndTest* test)
     , start_ms(0) {}
 
 void
-TestTimeoutCounter::start(unsigned int timeout_ms_in, Callback* callback_in) {
+TestTimeoutCounter::start(unsigned int timeout_ms_in, Callback* callback_in, TimerWheel* timer_wheel) {
     if (timeout_ms_in) {
         this->callback = callback_in;
         this->timeout_ms = timeout_ms_in;
         this->start_ms = CUTEST_NS::tickCount64();
-        Runner::instance()->delayRunOnMainThread(timeout_ms_in, this, false);
+        timer_wheel->schedule(this, this->start_ms + timeout_ms_in);
     } else {
         // 超时时间为0表示无限等待，这种Test不需要启动Timer
         delete this;
@@ -29,20 +29,14 @@ TestTimeoutCounter::start(unsigned int timeout_ms_in, Callback* callback_in) {
 
 void
 TestTimeoutCounter::run() {
-    // 计算ExplicitEndTest当前的执行时长
-    unsigned int elapsed_ms = (unsigned int)(CUTEST_NS::tickCount64() - this->start_ms);
-    if (elapsed_ms < this->timeout_ms) {
-        /*
-            超时补偿逻辑：
-            Timer存在误差，比如Runner::instance()->delayRunOnMainThread(1000, ...)指定的是1000ms，
-            但有可能在980ms左右就调用TestTimeoutCounter::run()了，为了避免因误差导致ExplicitEndTest被提前结束，
-            此处增加一个100ms的补偿逻辑。
-        */
-        Runner::instance()->delayRunOnMainThread(100, this, false);
-    } else {
-        this->callback->onTimeout(this->test, this);
-        delete this;
-    }
+    // 时间轮和start_ms用的是同一个时钟，到期之前不会执行，不需要再补偿系统定时器的误差
+    this->callback->onTimeout(this->test, this);
+    delete this;
+}
+
+void
+TestTimeoutCounter::discard() {
+    delete this;
 }
 
 void
@@ -59,23 +53,33 @@ TestTimeoutCounter::addFailure() {
 }
 
 AutoEndTest::AutoEndTest()
-    : test(NULL)
+    : timer_wheel(NULL)
+    , test(NULL)
     , counter(NULL) {}
 
+void
+AutoEndTest::setTimerWheel(TimerWheel* timer_wheel_in) {
+    this->timer_wheel = timer_wheel_in;
+}
+
 void
 AutoEndTest::check(ExplicitEndTest* test, unsigned int timeout_ms) {
+    cancel();
+
     if (test && timeout_ms) {
         this->test = test;
         this->counter = new TestTimeoutCounter(test);
-        this->counter->start(timeout_ms, this);
-    } else {
-        this->test = NULL;
-        this->counter = NULL;
+        this->counter->start(timeout_ms, this, this->timer_wheel);
     }
 }
 
 void
 AutoEndTest::cancel() {
+    // 已经到期的counter正在或者即将执行，由它自己销毁，onTimeout()中发现不是当前的counter就什么也不做
+    if (this->counter && this->timer_wheel->cancel(this->counter)) {
+        delete this->counter;
+    }
+
     this->test = NULL;
     this->counter = NULL;
 }
@@ -83,8 +87,10 @@ AutoEndTest::cancel() {
 void
 AutoEndTest::onTimeout(ExplicitEndTest* test, TestTimeoutCounter* counter) {
     if (this->test == test && this->counter == counter) {
+        // counter执行完就会销毁自己，不能再由cancel()销毁
+        this->counter = NULL;
         counter->addFailure();
-        this->test->endTest();
+        test->endTest();
     }
 }
 
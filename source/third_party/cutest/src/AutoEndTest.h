@@ -3,12 +3,14 @@
 #include <cppunit/Portability.h>
 #include "cutest/Runnable.h"
 
+#include "TimerWheel.h"
+
 CUTEST_NS_BEGIN
 
 class ExplicitEndTest;
 
-// 根据每个ExplicitEndTest的超时时长启动Timer，到点之后调用Callback::onTimeout()
-class TestTimeoutCounter : public Runnable {
+// 根据每个ExplicitEndTest的超时时长在时间轮上启动Timer，到点之后调用Callback::onTimeout()
+class TestTimeoutCounter : public TimerWheel::Timer {
 public:
     class Callback {
     public:
@@ -17,7 +19,7 @@ public:
 
 public:
     TestTimeoutCounter(ExplicitEndTest* test);
-    void start(unsigned int timeout_ms, Callback* callback);
+    void start(unsigned int timeout_ms, Callback* callback, TimerWheel* timer_wheel);
     void addFailure();
 
 protected:
@@ -29,6 +31,9 @@ protected:
 public:
     // Runnable::run()的实现
     virtual void run();
+
+    // TimerWheel::Timer::discard()的实现，超时之前Runner就销毁了
+    virtual void discard();
 };
 
 /*
@@ -41,10 +46,14 @@ public:
 class AutoEndTest : public TestTimeoutCounter::Callback {
 public:
     AutoEndTest();
+    void setTimerWheel(TimerWheel* timer_wheel);
     void check(ExplicitEndTest* test, unsigned int timeout_ms);
+
+    // 用例在超时之前结束了，把还没到期的TestTimeoutCounter从时间轮中取下并销毁
     void cancel();
 
 protected:
+    TimerWheel* timer_wheel;
     ExplicitEndTest* test;
     TestTimeoutCounter* counter;
 
@@ -0,0 +1,158 @@
+﻿#include "cutest/Benchmark.h"
+#include "cutest/Helper.h"
+
+#include <algorithm>
+#include <math.h>
+
+CUTEST_NS_BEGIN
+
+namespace {
+
+// 执行iterations次body->run()，返回耗时，单位：ns
+unsigned long long
+runBatch(Runnable* body, unsigned long long iterations) {
+    unsigned long long start = CUTEST_NS::tickCountNs();
+    for (unsigned long long i = 0; i < iterations; ++i) {
+        body->run();
+    }
+    return CUTEST_NS::tickCountNs() - start;
+}
+
+// 已排序的values中第ratio（0~1）分位的值，相邻两个值之间线性插值
+double
+percentile(const CppUnitVector<double>& values, double ratio) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    double position = ratio * (values.size() - 1);
+    size_t lower = (size_t)position;
+    if (lower + 1 >= values.size()) {
+        return values.back();
+    }
+    double fraction = position - lower;
+    return values[lower] + (values[lower + 1] - values[lower]) * fraction;
+}
+
+// 自由度为degrees的t分布的97.5%分位数，用来计算95%置信区间，自由度大于30时按正态分布处理
+double
+studentT975(size_t degrees) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+
+    if (0 == degrees) {
+        return 0;
+    }
+    if (degrees <= sizeof(table) / sizeof(table[0])) {
+        return table[degrees - 1];
+    }
+    return 1.960;
+}
+
+} // namespace
+
+bool
+measureBenchmark(
+    Runnable* body,
+    const BenchmarkOptions& options,
+    const volatile bool* stop,
+    BenchmarkResult& result) {
+    result = BenchmarkResult();
+    unsigned long long start = CUTEST_NS::tickCountNs();
+
+    // 校准：让每个样本至少持续min_sample_ns，每次最多放大10倍，避免一次执行太久
+    unsigned long long iterations = 1;
+    for (;;) {
+        unsigned long long elapsed = runBatch(body, iterations);
+        if (stop && *stop) {
+            return false;
+        }
+        if (elapsed >= options.min_sample_ns || iterations >= options.max_iterations) {
+            break;
+        }
+
+        unsigned long long next = iterations * 10;
+        if (elapsed > 0) {
+            next = (unsigned long long)(iterations * (double)options.min_sample_ns / elapsed * 1.2) + 1;
+            next = std::min(next, iterations * 10);
+        }
+        iterations = std::min(std::max(next, iterations + 1), options.max_iterations);
+    }
+
+    // 预热：让缓存、分支预测、CPU频率等进入稳定状态
+    while (CUTEST_NS::tickCountNs() - start < options.warmup_ns) {
+        runBatch(body, iterations);
+        if (stop && *stop) {
+            return false;
+        }
+    }
+
+    result.iterations = iterations;
+    for (unsigned int i = 0; i < options.samples; ++i) {
+        unsigned long long elapsed = runBatch(body, iterations);
+        result.samples_ns.push_back((double)elapsed / iterations);
+        if (stop && *stop) {
+            computeBenchmarkStatistics(result);
+            return false;
+        }
+    }
+
+    computeBenchmarkStatistics(result);
+    return true;
+}
+
+void
+computeBenchmarkStatistics(BenchmarkResult& result) {
+    CppUnitVector<double> sorted(result.samples_ns);
+    std::sort(sorted.begin(), sorted.end());
+
+    // 按Tukey规则剔除离群值
+    double q1 = percentile(sorted, 0.25);
+    double q3 = percentile(sorted, 0.75);
+    double low = q1 - 1.5 * (q3 - q1);
+    double high = q3 + 1.5 * (q3 - q1);
+
+    CppUnitVector<double> kept;
+    CppUnitVector<double>::iterator it = sorted.begin();
+    while (it != sorted.end()) {
+        if (*it >= low && *it <= high) {
+            kept.push_back(*it);
+        }
+        ++it;
+    }
+    result.outliers = (unsigned int)(sorted.size() - kept.size());
+
+    if (kept.empty()) {
+        return;
+    }
+
+    double sum = 0;
+    it = kept.begin();
+    while (it != kept.end()) {
+        sum += *it;
+        ++it;
+    }
+    result.mean_ns = sum / kept.size();
+
+    double squares = 0;
+    it = kept.begin();
+    while (it != kept.end()) {
+        squares += (*it - result.mean_ns) * (*it - result.mean_ns);
+        ++it;
+    }
+    result.stddev_ns = kept.size() > 1 ? sqrt(squares / (kept.size() - 1)) : 0;
+
+    result.median_ns = percentile(kept, 0.5);
+    result.p99_ns = percentile(kept, 0.99);
+    result.min_ns = kept.front();
+    result.max_ns = kept.back();
+
+    double margin = studentT975(kept.size() - 1) * result.stddev_ns / sqrt((double)kept.size());
+    result.ci_low_ns = result.mean_ns - margin;
+    result.ci_high_ns = result.mean_ns + margin;
+}
+
+CUTEST_NS_END
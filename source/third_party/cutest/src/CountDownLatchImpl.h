@@ -37,7 +37,13 @@ protected:
     void awaitOnMainThread();
     bool awaitOnMainThread(unsigned int timeout_ms);
 
-    Event* event; // 如果是在工作线程调用await()，需要通过事件来实现等待
+    /*
+        如果是在工作线程调用await()，需要通过事件来实现等待。
+        等待的线程看到count为0之后可能立即返回并delete latch，这时countDown()可能还没有post()，
+        所以Linux和Android上countDown()在减1之前先持有event的一份引用（见EventImpl::retain()），
+        之后只通过这份引用访问event，await()看到0就可以直接返回，不需要加锁
+    */
+    Event* event;
     void awaitOnWorkerThread();
     bool awaitOnWorkerThread(unsigned int timeout_ms);
 };
@@ -2,11 +2,13 @@
 
 // cppunit
 #include <cppunit/Exception.h>
+#include <cppunit/Protector.h>
 #include <cppunit/TestListener.h>
-#include <cppunit/TestResultCollector.h>
 
 #include "cutest/Define.h"
 
+#include "FailureLog.h"
+
 CUTEST_NS_BEGIN
 
 class Decorator {
@@ -24,11 +26,14 @@ public:
 
     virtual void addListener(CPPUNIT_NS::TestListener* listener) = 0;
 
+    // protector由TestResult负责销毁
+    virtual void pushProtector(CPPUNIT_NS::Protector* protector) = 0;
+
     virtual void start() = 0;
     virtual void stop() = 0;
 
     virtual void addFailure(bool is_error, CPPUNIT_NS::Exception* exception) = 0;
-    virtual const CPPUNIT_NS::TestResultCollector* testResultCollector() = 0;
+    virtual FailureLog* failureLog() = 0;
 };
 
 CUTEST_NS_END
@@ -0,0 +1,128 @@
+﻿#include "DurationHistory.h"
+
+#include <fstream>
+
+CUTEST_NS_BEGIN
+
+DurationHistory::DurationHistory()
+    : average_ms(1)
+    , index(NULL)
+    , read_only(false) {}
+
+void
+DurationHistory::setFile(const char* path_in) {
+    this->path = path_in ? path_in : "";
+    load();
+}
+
+bool
+DurationHistory::isEnabled() const {
+    return !this->path.empty();
+}
+
+void
+DurationHistory::setReadOnly(bool value) {
+    this->read_only = value;
+}
+
+void
+DurationHistory::setTestIndex(const TestIndex* index_in) {
+    this->index = index_in;
+}
+
+void
+DurationHistory::load() {
+    this->durations.clear();
+    this->average_ms = 1;
+
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::ifstream file(this->path.c_str());
+    unsigned long long total_ms = 0;
+    unsigned int elapsed_ms = 0;
+    std::string name;
+    while (file >> elapsed_ms && std::getline(file, name)) {
+        // 跳过耗时和用例名之间的空格
+        std::string::size_type pos = name.find_first_not_of(' ');
+        if (std::string::npos == pos) {
+            continue;
+        }
+
+        this->durations[name.substr(pos)] = elapsed_ms;
+        total_ms += elapsed_ms;
+    }
+
+    if (!this->durations.empty()) {
+        this->average_ms = (unsigned int)(total_ms / this->durations.size());
+        if (0 == this->average_ms) {
+            this->average_ms = 1;
+        }
+    }
+}
+
+void
+DurationHistory::save() {
+    if (!isEnabled() || this->read_only) {
+        return;
+    }
+
+    std::ofstream file(this->path.c_str(), std::ios::out | std::ios::trunc);
+    Durations::iterator it = this->durations.begin();
+    while (it != this->durations.end()) {
+        file << it->second << ' ' << it->first << '\n';
+        ++it;
+    }
+}
+
+unsigned int
+DurationHistory::estimateLeaf(const std::string& name) const {
+    Durations::const_iterator it = this->durations.find(name);
+    return (it != this->durations.end()) ? it->second : this->average_ms;
+}
+
+unsigned long long
+DurationHistory::estimate(CPPUNIT_NS::Test* test) const {
+    int id = this->index ? this->index->find(test) : TestIndex::NOT_FOUND;
+    if (TestIndex::NOT_FOUND != id) {
+        // test的所有子孙在索引中是连续的，依次累加其中的叶子节点即可
+        unsigned long long total_ms = 0;
+        for (int descendant = id; descendant < this->index->end(id); ++descendant) {
+            if (this->index->isLeaf(descendant)) {
+                total_ms += estimateLeaf(this->index->name(descendant));
+            }
+        }
+        return total_ms;
+    }
+
+    int count = test->getChildTestCount();
+    if (0 == count) {
+        return estimateLeaf(test->getName());
+    }
+
+    unsigned long long total_ms = 0;
+    for (int index = 0; index < count; ++index) {
+        total_ms += estimate(test->getChildTestAt(index));
+    }
+    return total_ms;
+}
+
+void
+DurationHistory::onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) {
+    save();
+}
+
+void
+DurationHistory::onTestEnd(
+    CPPUNIT_NS::Test* test,
+    unsigned int error_count,
+    unsigned int failure_count,
+    unsigned int elapsed_ms) {
+    if (isEnabled() && !this->read_only) {
+        // 没有执行到的用例保留原来的记录
+        this->durations[test->getName()] = elapsed_ms;
+    }
+}
+
+CUTEST_NS_END
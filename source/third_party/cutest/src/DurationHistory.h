@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <map>
+#include <string>
+
+#include "cutest/ProgressListener.h"
+
+#include "TestIndex.h"
+
+CUTEST_NS_BEGIN
+
+/*
+    用例耗时的历史记录，见Runner::setDurationHistoryFile()：
+    - 作为ProgressListener记录每个用例本次的耗时，onRunnerEnd()时写回文件；
+    - 并行执行时，ParallelExecutor根据它估算每个Suite的耗时，耗时长的优先调度；
+    - 分片执行时只读（见setReadOnly()）。
+    文件为文本格式，每行一个用例："耗时(ms) 用例名"。
+*/
+class DurationHistory : public ProgressListener {
+public:
+    DurationHistory();
+
+    // 设置历史记录文件，并立即加载其中的记录；path为空表示不使用历史记录
+    void setFile(const char* path);
+    bool isEnabled() const;
+
+    /*
+        为true时只使用加载的记录，不记录本次的耗时，也不写回文件：
+        分片执行时各分片要根据同一份历史记录计算出同样的分配结果，
+        如果某个分片先结束并改写了文件，后启动或者共用这个文件的分片就会分得不同的用例。
+    */
+    void setReadOnly(bool value);
+
+    // estimate()优先在index中查找用例，不必递归遍历用例树
+    void setTestIndex(const TestIndex* index);
+
+    /*
+        估算test的耗时，单位ms：
+        - test为叶子节点时，返回历史记录中的耗时，没有记录的按所有记录的平均值估算；
+        - test为Suite时，返回所有叶子节点的估算值之和。
+        只能在用例开始执行之前调用，执行过程中记录会在主线程上被修改。
+    */
+    unsigned long long estimate(CPPUNIT_NS::Test* test) const;
+
+    // 估算名为name的叶子节点的耗时，单位ms，没有记录的按所有记录的平均值估算
+    unsigned int estimateLeaf(const std::string& name) const;
+
+    //////////////////////////////////////////////////////////////////////////
+    // 重载ProgressListener的成员方法
+    virtual void onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) override;
+    virtual void onTestEnd(
+        CPPUNIT_NS::Test* test,
+        unsigned int error_count,
+        unsigned int failure_count,
+        unsigned int elapsed_ms) override;
+    //////////////////////////////////////////////////////////////////////////
+
+protected:
+    std::string path;
+
+    typedef std::map<std::string, unsigned int> Durations; // key为用例名，value为耗时(ms)
+    Durations durations;
+    unsigned int average_ms; // 加载时计算的平均耗时，用于估算没有历史记录的用例
+    const TestIndex* index;
+    bool read_only;
+
+    void load();
+    void save();
+};
+
+CUTEST_NS_END
@@ -0,0 +1,311 @@
+﻿#include "EventStream.h"
+
+#include <cppunit/Exception.h>
+
+#include "cutest/Helper.h"
+#include "cutest/Runner.h"
+
+#include <math.h>
+
+CUTEST_NS_BEGIN
+
+namespace {
+
+// 写入文件的缓冲区大小
+const size_t BUFFER_SIZE = 64 * 1024;
+
+// 两次刷新之间的最长间隔，单位：ns，实时查看进度时最多延迟这么久
+const unsigned long long FLUSH_INTERVAL_NS = 100000000;
+
+} // namespace
+
+void
+appendJsonString(std::string& out, const char* value) {
+    static const char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (const char* it = value; *it; ++it) {
+        unsigned char ch = (unsigned char)*it;
+        switch (ch) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (ch < 0x20) {
+                out += "\\u00";
+                out += HEX[ch >> 4];
+                out += HEX[ch & 0xF];
+            } else {
+                out += (char)ch;
+            }
+            break;
+        }
+    }
+    out += '"';
+}
+
+void
+EventStream::FlushTask::run() {
+    this->stream->is_flush_scheduled = false;
+    if (this->stream->has_unflushed) {
+        this->stream->flush();
+    }
+}
+
+EventStream::EventStream()
+    : file(NULL)
+    , last_flush_ns(0)
+    , has_unflushed(false)
+    , is_flush_scheduled(false)
+    , flush_task(this) {
+    this->line.reserve(1024);
+}
+
+EventStream::~EventStream() {
+    close();
+}
+
+void
+EventStream::setFile(FILE* file_in) {
+    close();
+
+    this->file = file_in;
+    if (this->file) {
+        ::setvbuf(this->file, NULL, _IOFBF, BUFFER_SIZE);
+    }
+}
+
+bool
+EventStream::isEnabled() const {
+    return NULL != this->file;
+}
+
+void
+EventStream::close() {
+    if (this->file) {
+        ::fclose(this->file);
+        this->file = NULL;
+    }
+    this->has_unflushed = false;
+}
+
+void
+EventStream::begin(const char* event) {
+    this->line.clear();
+    this->line += '{';
+    appendString("event", event);
+}
+
+void
+EventStream::appendKey(const char* key) {
+    if (this->line.size() > 1) {
+        this->line += ',';
+    }
+    this->line += '"';
+    this->line += key;
+    this->line += "\":";
+}
+
+void
+EventStream::appendString(const char* key, const char* value) {
+    appendKey(key);
+    appendJsonString(this->line, value);
+}
+
+void
+EventStream::appendUInt(const char* key, unsigned long long value) {
+    appendKey(key);
+
+    char buffer[32];
+    ::sprintf(buffer, "%llu", value);
+    this->line += buffer;
+}
+
+void
+EventStream::appendDouble(const char* key, double value) {
+    appendKey(key);
+
+    // JSON中没有NaN和无穷大
+    if (value != value || fabs(value) > 1e300) {
+        this->line += "null";
+        return;
+    }
+
+    char buffer[32];
+    ::sprintf(buffer, "%.10g", value);
+    this->line += buffer;
+}
+
+void
+EventStream::appendBool(const char* key, bool value) {
+    appendKey(key);
+    this->line += value ? "true" : "false";
+}
+
+void
+EventStream::end(bool flush) {
+    this->line += "}\n";
+    if (!this->file) {
+        return;
+    }
+
+    if (::fwrite(this->line.c_str(), 1, this->line.size(), this->file) != this->line.size()) {
+        ::fprintf(stderr, "Failed to write the event stream, stop writing.\n");
+        close();
+        return;
+    }
+
+    this->has_unflushed = true;
+    if (flush || CUTEST_NS::tickCountNs() - this->last_flush_ns >= FLUSH_INTERVAL_NS) {
+        this->flush();
+    } else if (!this->is_flush_scheduled) {
+        // 之后可能很久都没有事件（比如一个用例要执行几分钟），到时间由主线程来刷新
+        this->is_flush_scheduled = true;
+        Runner::instance()->delayRunOnMainThread((unsigned int)(FLUSH_INTERVAL_NS / 1000000), &this->flush_task, false);
+    }
+}
+
+void
+EventStream::flush() {
+    if (!this->file) {
+        return;
+    }
+
+    this->has_unflushed = false;
+    this->last_flush_ns = CUTEST_NS::tickCountNs();
+    if (0 != ::fflush(this->file)) {
+        ::fprintf(stderr, "Failed to write the event stream, stop writing.\n");
+        close();
+    }
+}
+
+void
+EventStream::onRunnerStart(CPPUNIT_NS::Test* test) {
+    begin("runner_start");
+    appendString("name", test->getName().c_str());
+    appendUInt("tests", Runner::instance()->countTestCases(test));
+    end(true);
+}
+
+void
+EventStream::onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
+    begin("runner_end");
+    appendString("name", test->getName().c_str());
+    appendUInt("elapsed_ns", elapsed_ns);
+    end(true);
+}
+
+void
+EventStream::onSuiteStart(CPPUNIT_NS::Test* suite) {
+    begin("suite_start");
+    appendString("suite", suite->getName().c_str());
+    appendUInt("tests", Runner::instance()->countTestCases(suite));
+    end(false);
+}
+
+void
+EventStream::onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns) {
+    begin("suite_end");
+    appendString("suite", suite->getName().c_str());
+    appendUInt("elapsed_ns", elapsed_ns);
+    end(true);
+}
+
+void
+EventStream::onTestStart(CPPUNIT_NS::Test* test) {
+    begin("test_start");
+    appendString("test", test->getName().c_str());
+    end(false);
+}
+
+void
+EventStream::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) {
+    begin("failure");
+    appendString("test", failure.failedTestName().c_str());
+    appendUInt("index", index);
+    appendBool("error", failure.isError());
+    if (failure.sourceLine().isValid()) {
+        appendString("file", failure.sourceLine().fileName().c_str());
+        appendUInt("line", failure.sourceLine().lineNumber());
+    }
+    appendString("message", failure.thrownException()->what());
+    end(false);
+}
+
+void
+EventStream::onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<OmittedFailure>& omitted) {
+    for (size_t i = 0; i < omitted.size(); ++i) {
+        const OmittedFailure& failure = omitted[i];
+        begin("failures_omitted");
+        appendString("test", test->getName().c_str());
+        appendBool("error", failure.is_error);
+        if (failure.source_line.isValid()) {
+            appendString("file", failure.source_line.fileName().c_str());
+            appendUInt("line", failure.source_line.lineNumber());
+        }
+        appendUInt("count", failure.count);
+        appendString("message", failure.message.c_str());
+        end(false);
+    }
+}
+
+void
+EventStream::onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) {
+    begin("benchmark");
+    appendString("test", test->getName().c_str());
+    appendUInt("iterations", result.iterations);
+    appendUInt("samples", result.samples_ns.size());
+    appendUInt("outliers", result.outliers);
+    appendDouble("mean_ns", result.mean_ns);
+    appendDouble("median_ns", result.median_ns);
+    appendDouble("p99_ns", result.p99_ns);
+    appendDouble("stddev_ns", result.stddev_ns);
+    appendDouble("min_ns", result.min_ns);
+    appendDouble("max_ns", result.max_ns);
+    appendDouble("ci_low_ns", result.ci_low_ns);
+    appendDouble("ci_high_ns", result.ci_high_ns);
+    end(false);
+}
+
+void
+EventStream::onTestEndNs(
+    CPPUNIT_NS::Test* test,
+    unsigned int error_count,
+    unsigned int failure_count,
+    unsigned long long elapsed_ns) {
+    begin("test_end");
+    appendString("test", test->getName().c_str());
+    appendUInt("errors", error_count);
+    appendUInt("failures", failure_count);
+    appendUInt("elapsed_ns", elapsed_ns);
+    end(false);
+}
+
+void
+EventStream::onRegressionReport(const CppUnitVector<Regression>& regressions) {
+    for (size_t index = 0; index < regressions.size(); ++index) {
+        const Regression& regression = regressions[index];
+        begin("regression");
+        appendString("test", regression.name.c_str());
+        appendBool("benchmark", regression.is_benchmark);
+        appendDouble("baseline_ns", regression.baseline_ns);
+        appendDouble("current_ns", regression.current_ns);
+        if (regression.p_value >= 0) {
+            appendDouble("p_value", regression.p_value);
+        }
+        end(false);
+    }
+}
+
+CUTEST_NS_END
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <stdio.h>
+#include <string>
+
+#include "cutest/ProgressListener.h"
+#include "cutest/Runnable.h"
+
+CUTEST_NS_BEGIN
+
+// 把value作为JSON字符串（包括两边的引号）追加到out，TestList也用它输出
+void appendJsonString(std::string& out, const char* value);
+
+/*
+    以JSON Lines格式输出执行过程中的事件，见Runner::setEventStream()，每个事件一行，比如：
+    {"event":"test_end","test":"MoneyTest.testAdd","errors":0,"failures":0,"elapsed_ns":12345}
+    - 在主线程上序列化到复用的line中，除了cppunit返回的用例名之外不再分配内存；
+    - 写入经过固定大小的缓冲区，每个Suite结束时、以及距离上次刷新超过FLUSH_INTERVAL_NS时交给系统，
+      缓冲区中还有数据时会通过Runner::delayRunOnMainThread()定时刷新，用例执行很久时test_start也不会一直留在缓冲区中；
+    - 写入失败（比如读端已经关闭）之后不再输出，不影响用例的执行。
+*/
+class EventStream : public ProgressListener {
+public:
+    EventStream();
+    virtual ~EventStream();
+
+    // 接管file，之前的文件会被关闭；file为NULL表示不再输出
+    void setFile(FILE* file);
+    bool isEnabled() const;
+
+    //////////////////////////////////////////////////////////////////////////
+    // 重载ProgressListener的成员方法
+    virtual void onRunnerStart(CPPUNIT_NS::Test* test) override;
+    virtual void onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) override;
+    virtual void onSuiteStart(CPPUNIT_NS::Test* suite) override;
+    virtual void onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns) override;
+    virtual void onTestStart(CPPUNIT_NS::Test* test) override;
+    virtual void onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) override;
+    virtual void onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<OmittedFailure>& omitted) override;
+    virtual void onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) override;
+    virtual void onTestEndNs(
+        CPPUNIT_NS::Test* test,
+        unsigned int error_count,
+        unsigned int failure_count,
+        unsigned long long elapsed_ns) override;
+    virtual void onRegressionReport(const CppUnitVector<Regression>& regressions) override;
+    //////////////////////////////////////////////////////////////////////////
+
+protected:
+    // 定时刷新缓冲区，由主线程调用，和写入事件在同一个线程上
+    class FlushTask : public Runnable {
+    public:
+        explicit FlushTask(EventStream* stream_in)
+            : stream(stream_in) {}
+
+        virtual void run() override;
+
+    protected:
+        EventStream* stream;
+    };
+
+    FILE* file;
+    std::string line; // 正在序列化的事件
+    unsigned long long last_flush_ns;
+    bool has_unflushed; // 缓冲区中有还没交给系统的事件
+    bool is_flush_scheduled; // flush_task已经投递，还没有执行
+    FlushTask flush_task;
+
+    // 开始一个事件，写入"event"字段
+    void begin(const char* event);
+
+    void appendKey(const char* key);
+    void appendString(const char* key, const char* value);
+    void appendUInt(const char* key, unsigned long long value);
+    void appendDouble(const char* key, double value);
+    void appendBool(const char* key, bool value);
+
+    // 结束当前事件并写出，flush为true或者距离上次刷新足够久时把缓冲区交给系统
+    void end(bool flush);
+
+    // 把缓冲区交给系统，失败时关闭文件
+    void flush();
+
+    void close();
+};
+
+CUTEST_NS_END
@@ -0,0 +1,137 @@
+﻿#include "FailureLog.h"
+
+#include <new>
+
+CUTEST_NS_BEGIN
+
+FailureLog::FailureLog(SynchronizationObject* lock)
+    : CPPUNIT_NS::SynchronizedObject(lock)
+    , count(0)
+    , error_count(0)
+    , failure_count(0)
+    , retention(0) {}
+
+FailureLog::~FailureLog() {
+    for (unsigned int i = 0; i < this->count; ++i) {
+        Record* record = (Record*)this->blocks[i / BLOCK_SIZE] + i % BLOCK_SIZE;
+        record->~Record();
+    }
+
+    CppUnitVector<char*>::iterator it = this->blocks.begin();
+    while (it != this->blocks.end()) {
+        delete[] *it;
+        ++it;
+    }
+}
+
+void
+FailureLog::setRetention(unsigned int max_per_test) {
+    ExclusiveZone zone(m_syncObject);
+    this->retention = max_per_test;
+}
+
+const CPPUNIT_NS::TestFailure*
+FailureLog::add(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception, bool is_error) {
+    ExclusiveZone zone(m_syncObject);
+
+    if (is_error) {
+        ++this->error_count;
+    } else {
+        ++this->failure_count;
+    }
+
+    if (this->retention) {
+        TestState& state = this->test_states[test];
+        if (state.retained >= this->retention) {
+            omit(state, exception, is_error);
+            delete exception;
+            return NULL;
+        }
+        ++state.retained;
+    }
+
+    if (this->count == this->blocks.size() * BLOCK_SIZE) {
+        // new char[]的结果按最严格的基本类型对齐，Record的大小又是它对齐要求的整数倍，所以块内每条记录都是对齐的
+        this->blocks.push_back(new char[sizeof(Record) * BLOCK_SIZE]);
+    }
+
+    void* slot = (Record*)this->blocks[this->count / BLOCK_SIZE] + this->count % BLOCK_SIZE;
+    Record* record = new (slot) Record(test, exception, is_error);
+    ++this->count;
+    return record;
+}
+
+void
+FailureLog::omit(TestState& state, const CPPUNIT_NS::Exception* exception, bool is_error) {
+    // 只和已省略的位置比较，不复制SourceLine
+    const CPPUNIT_NS::SourceLine& source_line = exception->sourceLine();
+
+    if (state.last_hit < state.omitted.size()) {
+        OmittedFailure& last = state.omitted[state.last_hit];
+        if (last.is_error == is_error && last.source_line == source_line) {
+            ++last.count;
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < state.omitted.size(); ++i) {
+        OmittedFailure& omitted = state.omitted[i];
+        if (omitted.is_error == is_error && omitted.source_line == source_line) {
+            ++omitted.count;
+            state.last_hit = i;
+            return;
+        }
+    }
+
+    OmittedFailure omitted;
+    omitted.source_line = source_line;
+    omitted.is_error = is_error;
+    omitted.count = 1;
+    omitted.message = exception->what();
+    state.omitted.push_back(omitted);
+    state.last_hit = state.omitted.size() - 1;
+}
+
+unsigned int
+FailureLog::errorCount() const {
+    ExclusiveZone zone(m_syncObject);
+    return this->error_count;
+}
+
+unsigned int
+FailureLog::failureCount() const {
+    ExclusiveZone zone(m_syncObject);
+    return this->failure_count;
+}
+
+unsigned int
+FailureLog::totalCount() const {
+    ExclusiveZone zone(m_syncObject);
+    return this->error_count + this->failure_count;
+}
+
+const CPPUNIT_NS::TestFailure*
+FailureLog::at(unsigned int index) const {
+    ExclusiveZone zone(m_syncObject);
+    if (index >= this->count) {
+        return NULL;
+    }
+    return (const Record*)this->blocks[index / BLOCK_SIZE] + index % BLOCK_SIZE;
+}
+
+CppUnitVector<OmittedFailure>
+FailureLog::omittedFailures(CPPUNIT_NS::Test* test) const {
+    ExclusiveZone zone(m_syncObject);
+    TestStates::const_iterator it = this->test_states.find(test);
+    if (it == this->test_states.end()) {
+        return CppUnitVector<OmittedFailure>();
+    }
+    return it->second.omitted;
+}
+
+bool
+FailureLog::isLogged(const CPPUNIT_NS::TestFailure* failure) {
+    return NULL != dynamic_cast<const Record*>(failure);
+}
+
+CUTEST_NS_END
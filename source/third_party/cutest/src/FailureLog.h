@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <cppunit/Exception.h>
+#include <cppunit/SynchronizedObject.h>
+#include <cppunit/Test.h>
+#include <cppunit/TestFailure.h>
+#include <cppunit/portability/CppUnitVector.h>
+
+#include "cutest/Define.h"
+#include "cutest/ProgressListener.h"
+
+#include <map>
+
+CUTEST_NS_BEGIN
+
+/*
+    一次执行中的所有失败，代替TestResultCollector，见Runner::failureAt()：
+    - add()直接接管exception，不再像TestResultCollector那样clone()一份；
+    - 失败记录按块分配，每块BLOCK_SIZE条，块满了才分配下一块，记录不会移动，直到FailureLog销毁才释放，
+      所以异步分发等需要在调用者返回之后继续使用失败的地方，可以直接引用记录而不必复制；
+    - 记录按加入的顺序编号，at()按编号直接定位到块和块内的位置；
+    - 设置了保留上限时，每个用例只记录前retention个失败，之后的只按出错位置和类型合并计数，见Runner::setFailureRetention()。
+    线程安全。
+*/
+class FailureLog : protected CPPUNIT_NS::SynchronizedObject {
+public:
+    FailureLog(CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock);
+    virtual ~FailureLog();
+
+    // 每个用例最多记录多少个失败，0表示不限制（默认），需要在add()之前设置
+    void setRetention(unsigned int max_per_test);
+
+    /*
+        加入一个失败，exception的所有权交给FailureLog
+        - 记录下来时返回这条记录，它在FailureLog销毁之前一直有效；
+        - 超出保留上限时合并到这个用例省略的失败中，exception随即销毁，返回NULL。
+    */
+    const CPPUNIT_NS::TestFailure* add(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception, bool is_error);
+
+    // 包括省略的失败
+    unsigned int errorCount() const;
+    unsigned int failureCount() const;
+    unsigned int totalCount() const;
+
+    // 只有记录下来的失败才有编号，index超出范围时返回NULL
+    const CPPUNIT_NS::TestFailure* at(unsigned int index) const;
+
+    // test中省略的失败，按第一次出现的顺序排列
+    CppUnitVector<OmittedFailure> omittedFailures(CPPUNIT_NS::Test* test) const;
+
+    // failure是否为某个FailureLog中的记录
+    static bool isLogged(const CPPUNIT_NS::TestFailure* failure);
+
+protected:
+    enum { BLOCK_SIZE = 256 };
+
+    // 用类型来区分记录和其他TestFailure，见isLogged()
+    class Record : public CPPUNIT_NS::TestFailure {
+    public:
+        Record(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception, bool is_error)
+            : CPPUNIT_NS::TestFailure(test, exception, is_error) {}
+    };
+
+    CppUnitVector<char*> blocks; // 每块可以放BLOCK_SIZE个Record
+    unsigned int count;          // 记录数
+    unsigned int error_count;    // 包括省略的
+    unsigned int failure_count;  // 包括省略的
+
+    // 设置了保留上限时每个用例的状态
+    struct TestState {
+        TestState()
+            : retained(0)
+            , last_hit(0) {}
+
+        unsigned int retained;
+        CppUnitVector<OmittedFailure> omitted;
+        size_t last_hit; // 上次合并到的omitted中的位置，同一处连续失败时不用再查找
+    };
+    typedef std::map<CPPUNIT_NS::Test*, TestState> TestStates;
+    TestStates test_states;
+    unsigned int retention;
+
+    void omit(TestState& state, const CPPUNIT_NS::Exception* exception, bool is_error);
+
+private:
+    FailureLog(const FailureLog& other);
+    FailureLog& operator =(const FailureLog& other);
+};
+
+CUTEST_NS_END
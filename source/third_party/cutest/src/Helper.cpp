@@ -2,6 +2,7 @@
 #include "gtest/gtest-message.h"
 
 #include <stack>
+#include <stdio.h>
 
 const char*
 CUTEST_NS::version() {
@@ -34,6 +35,36 @@ CUTEST_NS::isOnMainThread() {
     return (CUTEST_NS::mainThreadId() == CUTEST_NS::currentThreadId());
 }
 
+std::string
+CUTEST_NS::formatElapsedMs(unsigned long long elapsed_ns) {
+    unsigned long long ms = elapsed_ns / 1000000;
+    unsigned int us = (unsigned int)(elapsed_ns / 1000 % 1000);
+
+    char buffer[32] = {0};
+    if (0 == us) {
+        ::sprintf(buffer, "%llu", ms);
+    } else {
+        ::sprintf(buffer, "%llu.%03u", ms, us);
+    }
+    return buffer;
+}
+
+std::string
+CUTEST_NS::formatDuration(double ns) {
+    static const char* units[] = { "ns", "us", "ms", "s" };
+
+    unsigned int unit = 0;
+    // 按3位有效数字舍入之后可能进位到1000，比如999.9 ns要显示成"1 us"
+    while (ns >= 999.5 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        ns /= 1000;
+        ++unit;
+    }
+
+    char buffer[32] = {0};
+    ::sprintf(buffer, "%.3g %s", ns, units[unit]);
+    return buffer;
+}
+
 std::string
 CUTEST_NS::makeFilePathShorter(std::string path) {
     std::string str = path;
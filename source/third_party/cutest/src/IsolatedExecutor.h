@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include <cppunit/Exception.h>
+#include <cppunit/extensions/TestDecorator.h>
+
+#include "cutest/Helper.h"
+
+CUTEST_NS_BEGIN
+
+/*
+    进程隔离执行器，Runner::setProcessIsolation(true)时由RunnerBase::createIsolatedExecutor()创建，
+    各平台的RunnerImpl负责提供具体实现，不支持的平台不创建，用例仍然在当前进程中执行。
+*/
+class IsolatedExecutor : public CPPUNIT_NS::TestDecorator {
+public:
+    explicit IsolatedExecutor(CPPUNIT_NS::Test* test)
+        : CPPUNIT_NS::TestDecorator(test) {}
+
+    // 故意跳过TestDecorator的析构函数，test由外部负责销毁
+    virtual ~IsolatedExecutor() {
+        CPPUNIT_NS::TestDecorator::m_test = NULL;
+    }
+
+    /*
+        Runner::addFailure()的分派：
+        - 如果当前在执行用例的子进程中，把失败记录到子进程正在执行的用例上，并返回true；
+        - 否则返回false，由调用者按原来的方式处理。
+    */
+    virtual bool addFailure(bool is_error, CPPUNIT_NS::Exception* exception) = 0;
+};
+
+CUTEST_NS_END
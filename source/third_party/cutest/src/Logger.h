@@ -14,18 +14,21 @@ public:
     //////////////////////////////////////////////////////////////////////////
     // 重载ProgressListener的成员方法
     virtual void onRunnerStart(CPPUNIT_NS::Test* test);
-    virtual void onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms);
+    virtual void onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns);
 
     virtual void onSuiteStart(CPPUNIT_NS::Test* suite);
-    virtual void onSuiteEnd(CPPUNIT_NS::Test* suite, unsigned int elapsed_ms);
+    virtual void onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns);
 
     virtual void onTestStart(CPPUNIT_NS::Test* test);
     virtual void onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure);
-    virtual void onTestEnd(
+    virtual void onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<OmittedFailure>& omitted);
+    virtual void onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result);
+    virtual void onRegressionReport(const CppUnitVector<Regression>& regressions);
+    virtual void onTestEndNs(
         CPPUNIT_NS::Test* test,
         unsigned int error_count,
         unsigned int failure_count,
-        unsigned int elapsed_ms);
+        unsigned long long elapsed_ns);
     //////////////////////////////////////////////////////////////////////////
 
 protected:
@@ -0,0 +1,391 @@
+﻿#include "ParallelExecutor.h"
+
+#include "cutest/MainThreadTest.h"
+#include "cutest/Runner.h"
+
+#include <algorithm>
+
+CUTEST_NS_BEGIN
+
+ParallelExecutor::WorkerResult::WorkerResult(CPPUNIT_NS::TestResult* controller_in)
+    : CPPUNIT_NS::TestResult(Thread::createLock())
+    , controller(controller_in) {}
+
+bool
+ParallelExecutor::WorkerResult::shouldStop() const {
+    return this->controller->shouldStop();
+}
+
+void
+ParallelExecutor::WorkerResult::addError(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e) {
+    ProgressListenerManager::Recorder::Failure failure(test, e, true);
+    CPPUNIT_NS::TestResult::addFailure(failure);
+}
+
+void
+ParallelExecutor::WorkerResult::addFailure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e) {
+    ProgressListenerManager::Recorder::Failure failure(test, e, false);
+    CPPUNIT_NS::TestResult::addFailure(failure);
+}
+
+ParallelExecutor::Worker::Worker(ParallelExecutor* executor_in, CPPUNIT_NS::TestResult* controller)
+    : executor(executor_in)
+    , thread(NULL)
+    , id(0)
+    , result(controller)
+    , runing_test(NULL)
+    , lock(Thread::createLock())
+    , queued_cost(0)
+    , assigned_cost(0) {
+    this->result.addListener(this);
+}
+
+ParallelExecutor::Worker::~Worker() {
+    join();
+    delete this->lock;
+}
+
+void
+ParallelExecutor::Worker::push(SuiteTask* task) {
+    this->lock->lock();
+    this->queue.push_back(task);
+    this->queued_cost += task->cost_ms;
+    this->lock->unlock();
+}
+
+ParallelExecutor::SuiteTask*
+ParallelExecutor::Worker::popFront() {
+    SuiteTask* task = NULL;
+
+    this->lock->lock();
+    if (!this->queue.empty()) {
+        task = this->queue.front();
+        this->queue.pop_front();
+        this->queued_cost -= task->cost_ms;
+    }
+    this->lock->unlock();
+
+    return task;
+}
+
+ParallelExecutor::SuiteTask*
+ParallelExecutor::Worker::popBack() {
+    SuiteTask* task = NULL;
+
+    this->lock->lock();
+    if (!this->queue.empty()) {
+        task = this->queue.back();
+        this->queue.pop_back();
+        this->queued_cost -= task->cost_ms;
+    }
+    this->lock->unlock();
+
+    return task;
+}
+
+unsigned long long
+ParallelExecutor::Worker::remainingCost() {
+    this->lock->lock();
+    // 估算耗时为0的任务也要能被窃取，所以把任务个数也算进去
+    unsigned long long cost = this->queued_cost + this->queue.size();
+    this->lock->unlock();
+
+    return cost;
+}
+
+void
+ParallelExecutor::Worker::start() {
+    this->thread = Thread::createInstance(this);
+}
+
+void
+ParallelExecutor::Worker::join() {
+    if (this->thread) {
+        this->thread->destroy();
+        this->thread = NULL;
+    }
+}
+
+void
+ParallelExecutor::Worker::run() {
+    this->executor->lock->lock();
+    this->id = CUTEST_NS::currentThreadId();
+    this->executor->lock->unlock();
+
+    SuiteTask* task = NULL;
+    while (NULL != (task = popFront()) || NULL != (task = this->executor->steal(this))) {
+        // 停止之后仍然要取完所有单位，保证每个单位的completed都会被post
+        if (!this->result.shouldStop()) {
+            this->result.addListener(&task->recorder);
+            task->suite->run(&this->result);
+            this->result.removeListener(&task->recorder);
+        }
+
+        this->executor->lock->lock();
+        task->is_completed = true;
+        this->executor->lock->unlock();
+        task->completed->post();
+    }
+}
+
+void
+ParallelExecutor::Worker::startTest(CPPUNIT_NS::Test* test) {
+    this->runing_test = test;
+}
+
+void
+ParallelExecutor::Worker::endTest(CPPUNIT_NS::Test* test) {
+    this->runing_test = NULL;
+}
+
+ParallelExecutor::ParallelExecutor(
+    CPPUNIT_NS::Test* test,
+    unsigned int worker_count_in,
+    ProgressListenerManager* listener_manager_in,
+    const DurationHistory* history_in,
+    const RegressionGate* regression_gate_in)
+    : CPPUNIT_NS::TestDecorator(test)
+    , worker_count(worker_count_in)
+    , listener_manager(listener_manager_in)
+    , history(history_in)
+    , regression_gate(regression_gate_in)
+    , lock(Thread::createLock()) {}
+
+ParallelExecutor::~ParallelExecutor() {
+    clear();
+    delete this->lock;
+    CPPUNIT_NS::TestDecorator::m_test = NULL;
+}
+
+void
+ParallelExecutor::clear() {
+    Workers::iterator worker = this->workers.begin();
+    while (worker != this->workers.end()) {
+        delete *worker;
+        ++worker;
+    }
+    this->workers.clear();
+
+    SuiteTasks::iterator task = this->tasks.begin();
+    while (task != this->tasks.end()) {
+        if ((*task)->completed) {
+            (*task)->completed->destroy();
+        }
+        delete *task;
+        ++task;
+    }
+    this->tasks.clear();
+}
+
+bool
+ParallelExecutor::isMainThreadBound(CPPUNIT_NS::Test* test) {
+    if (dynamic_cast<MainThreadTest*>(test)) {
+        return true;
+    }
+
+    int count = test->getChildTestCount();
+    for (int index = 0; index < count; ++index) {
+        if (isMainThreadBound(test->getChildTestAt(index))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+ParallelExecutor::isLongerThan(const ParallelExecutor::SuiteTask* left, const ParallelExecutor::SuiteTask* right) {
+    return left->cost_ms > right->cost_ms;
+}
+
+void
+ParallelExecutor::distribute(unsigned int parallel_count) {
+    SuiteTasks sorted;
+    sorted.reserve(parallel_count);
+
+    SuiteTasks::iterator it = this->tasks.begin();
+    while (it != this->tasks.end()) {
+        if (!(*it)->is_serial) {
+            sorted.push_back(*it);
+        }
+        ++it;
+    }
+
+    // 耗时相同的保持原来的顺序
+    std::stable_sort(sorted.begin(), sorted.end(), isLongerThan);
+
+    it = sorted.begin();
+    while (it != sorted.end()) {
+        Worker* target = this->workers[0];
+        Workers::iterator worker = this->workers.begin();
+        while (worker != this->workers.end()) {
+            if ((*worker)->assigned_cost < target->assigned_cost) {
+                target = *worker;
+            }
+            ++worker;
+        }
+
+        // 估算耗时为0时也要轮流分配
+        target->assigned_cost += (*it)->cost_ms + 1;
+        target->push(*it);
+        ++it;
+    }
+}
+
+ParallelExecutor::SuiteTask*
+ParallelExecutor::steal(Worker* thief) {
+    while (true) {
+        Worker* victim = NULL;
+        unsigned long long victim_cost = 0;
+
+        Workers::iterator it = this->workers.begin();
+        while (it != this->workers.end()) {
+            if (*it != thief) {
+                unsigned long long cost = (*it)->remainingCost();
+                if (cost > victim_cost) {
+                    victim = *it;
+                    victim_cost = cost;
+                }
+            }
+            ++it;
+        }
+
+        if (!victim) {
+            return NULL;
+        }
+
+        // 从尾部窃取耗时短的任务，victim自己继续执行头部耗时长的任务
+        SuiteTask* task = victim->popBack();
+        if (task) {
+            return task;
+        }
+        // 被victim自己或者其他Worker抢先取走了，重新选择
+    }
+}
+
+void
+ParallelExecutor::run(CPPUNIT_NS::TestResult* controller) {
+    clear();
+
+    bool always_on_main_thread = Runner::instance()->alwaysCallTestOnMainThread();
+    unsigned int parallel_count = 0;
+
+    int count = m_test->getChildTestCount();
+    for (int index = 0; index < count; ++index) {
+        SuiteTask* task = new SuiteTask;
+        task->suite = m_test->getChildTestAt(index);
+        task->is_serial = always_on_main_thread || isMainThreadBound(task->suite);
+        task->cost_ms = this->history ? this->history->estimate(task->suite) : 0;
+        task->completed = task->is_serial ? NULL : Event::createInstance();
+        task->is_completed = false;
+        task->is_merged = false;
+        this->tasks.push_back(task);
+
+        if (!task->is_serial) {
+            ++parallel_count;
+        }
+    }
+
+    // 先创建好所有Worker再启动，工作线程开始执行之后workers就不再变化，addFailure()可以放心遍历
+    unsigned int worker_count = this->worker_count < parallel_count ? this->worker_count : parallel_count;
+    for (unsigned int index = 0; index < worker_count; ++index) {
+        Worker* worker = new Worker(this, controller);
+        if (this->regression_gate && this->regression_gate->hasBaseline()) {
+            worker->result.pushProtector(this->regression_gate->createTimer());
+        }
+        this->workers.push_back(worker);
+    }
+    distribute(parallel_count);
+
+    Workers::iterator worker = this->workers.begin();
+    while (worker != this->workers.end()) {
+        (*worker)->start();
+        ++worker;
+    }
+
+    // 根Suite本身没有SetUpTestCase/TearDownTestCase，直接通知controller即可
+    controller->startSuite(m_test);
+
+    /*
+        串行通道上的单位一开始就在当前线程上执行，不必等待前面的并行单位，
+        每执行完一个，就把已经完成的并行单位回放出去；
+        所以各Suite的事件仍然是完整的，但Suite之间的顺序可能和原来不同。
+    */
+    SuiteTasks::iterator it = this->tasks.begin();
+    while (it != this->tasks.end()) {
+        SuiteTask* task = *it;
+        if (task->is_serial) {
+            mergeCompletedTasks(controller, false);
+            if (controller->shouldStop()) {
+                break;
+            }
+            task->suite->run(controller);
+        }
+        ++it;
+    }
+    mergeCompletedTasks(controller, true);
+
+    controller->endSuite(m_test);
+
+    worker = this->workers.begin();
+    while (worker != this->workers.end()) {
+        (*worker)->join();
+        ++worker;
+    }
+}
+
+void
+ParallelExecutor::mergeCompletedTasks(CPPUNIT_NS::TestResult* controller, bool wait) {
+    SuiteTasks::iterator it = this->tasks.begin();
+    while (it != this->tasks.end()) {
+        SuiteTask* task = *it;
+        ++it;
+
+        if (task->is_serial || task->is_merged) {
+            continue;
+        }
+
+        if (!wait) {
+            this->lock->lock();
+            bool is_completed = task->is_completed;
+            this->lock->unlock();
+
+            if (!is_completed) {
+                continue;
+            }
+        }
+
+        task->completed->wait();
+        this->listener_manager->merge(&task->recorder, controller);
+        task->is_merged = true;
+    }
+}
+
+bool
+ParallelExecutor::addFailure(bool is_error, CPPUNIT_NS::Exception* exception) {
+    thread_id id = CUTEST_NS::currentThreadId();
+    Worker* current = NULL;
+
+    this->lock->lock();
+    Workers::iterator it = this->workers.begin();
+    while (it != this->workers.end()) {
+        if ((*it)->id == id) {
+            current = *it;
+            break;
+        }
+        ++it;
+    }
+    this->lock->unlock();
+
+    if (!current) {
+        return false;
+    }
+
+    if (is_error) {
+        current->result.addError(current->runing_test, exception);
+    } else {
+        current->result.addFailure(current->runing_test, exception);
+    }
+    return true;
+}
+
+CUTEST_NS_END
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <cppunit/extensions/TestDecorator.h>
+#include <cppunit/TestListener.h>
+#include <cppunit/TestResult.h>
+
+#include "cutest/Event.h"
+#include "cutest/Helper.h"
+#include "cutest/Runnable.h"
+
+#include "DurationHistory.h"
+#include "ProgressListenerManager.h"
+#include "RegressionGate.h"
+#include "Thread.h"
+
+#include <deque>
+
+CUTEST_NS_BEGIN
+
+/*
+    RunnerBase内部使用的并行执行器，Runner::setParallelWorkerCount()大于1时生效：
+    - 根Suite下的每个子Test作为一个调度单位，互相独立的单位由工作线程池并行执行，
+      每个工作线程有自己的TestResult，事件先记录在单位自己的Recorder中；
+    - 调用run()的线程（即Decorator的工作线程）负责串行通道和回放：
+      必须在主线程执行的单位一开始就在当前线程上依次执行，
+      其余单位由工作线程执行完之后，再通过ProgressListenerManager::merge()回放给controller。
+
+    - 调度：根据DurationHistory估算每个单位的耗时，从长到短依次分配给当前总耗时最少的Worker，
+      每个Worker从自己队列的头部（耗时长的一端）取任务，自己的队列空了之后，
+      从剩余耗时最多的Worker队列的尾部（耗时短的一端）窃取任务。
+*/
+class ParallelExecutor : public CPPUNIT_NS::TestDecorator {
+public:
+    /*
+        history可以为NULL，此时所有单位的估算耗时都相同，按原来的顺序轮流分配；
+        regression_gate有基线时，每个Worker的TestResult上都要安装它的Timer
+    */
+    ParallelExecutor(
+        CPPUNIT_NS::Test* test,
+        unsigned int worker_count,
+        ProgressListenerManager* listener_manager,
+        const DurationHistory* history,
+        const RegressionGate* regression_gate);
+
+    // 故意跳过TestDecorator的析构函数，test由外部负责销毁
+    ~ParallelExecutor();
+
+    virtual void run(CPPUNIT_NS::TestResult* controller) override;
+
+    /*
+        Runner::addFailure()的分派：
+        - 如果当前线程是某个工作线程，把失败记录到该线程正在执行的用例上，并返回true；
+        - 否则返回false，由调用者按原来的方式处理。
+    */
+    bool addFailure(bool is_error, CPPUNIT_NS::Exception* exception);
+
+    // 判断test中是否有必须在主线程执行的用例
+    static bool isMainThreadBound(CPPUNIT_NS::Test* test);
+
+protected:
+    // 调度单位，对应根Suite下的一个子Test
+    struct SuiteTask {
+        CPPUNIT_NS::Test* suite;
+        bool is_serial;   // 为true表示放在串行通道上执行
+        unsigned long long cost_ms; // 估算的耗时
+        Event* completed; // 工作线程执行完（或者因为stop而跳过）之后post
+        bool is_completed; // 和completed同时设置，由lock保护，用于不等待地查询
+        bool is_merged;
+        ProgressListenerManager::Recorder recorder;
+    };
+    typedef CppUnitVector<SuiteTask*> SuiteTasks;
+    static bool isLongerThan(const SuiteTask* left, const SuiteTask* right);
+
+    // 工作线程用的TestResult，是否需要停止以controller为准
+    class WorkerResult : public CPPUNIT_NS::TestResult {
+    public:
+        WorkerResult(CPPUNIT_NS::TestResult* controller);
+
+        virtual bool shouldStop() const override;
+
+        // 通过ProgressListenerManager::Recorder::Failure通知TestListener，exception直接交给单位的Recorder
+        virtual void addError(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e) override;
+        virtual void addFailure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e) override;
+
+    protected:
+        CPPUNIT_NS::TestResult* controller;
+    };
+
+    class Worker
+        : public Runnable
+        , public CPPUNIT_NS::TestListener {
+    public:
+        Worker(ParallelExecutor* executor, CPPUNIT_NS::TestResult* controller);
+        virtual ~Worker();
+
+        void start();
+        void join();
+
+        // 以下方法通过lock保护，可能在其他工作线程上调用
+        void push(SuiteTask* task);
+        SuiteTask* popFront();
+        SuiteTask* popBack();
+        unsigned long long remainingCost();
+
+        // 实现Runnable::run()，在工作线程上执行
+        virtual void run() override;
+
+        // 重载TestListener的成员方法
+        virtual void startTest(CPPUNIT_NS::Test* test) override;
+        virtual void endTest(CPPUNIT_NS::Test* test) override;
+
+        ParallelExecutor* executor;
+        Thread* thread;
+        thread_id id;       // 在工作线程开始执行时赋值，由executor->lock保护
+        WorkerResult result;
+        CPPUNIT_NS::Test* runing_test;
+
+        CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock; // 保护queue和queued_cost
+        std::deque<SuiteTask*> queue; // 按估算耗时从长到短排列
+        unsigned long long queued_cost;
+        unsigned long long assigned_cost; // 分配阶段使用，分配给这个Worker的总耗时
+    };
+    typedef CppUnitVector<Worker*> Workers;
+
+    unsigned int worker_count;
+    ProgressListenerManager* listener_manager;
+    const DurationHistory* history;
+    const RegressionGate* regression_gate;
+
+    CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock; // 保护Worker::id和SuiteTask::is_completed
+    SuiteTasks tasks;
+    Workers workers;
+
+    // 把可以并行的单位按估算耗时从长到短分配到各个Worker的队列中
+    void distribute(unsigned int parallel_count);
+
+    // worker自己的队列空了之后，从剩余耗时最多的Worker那里窃取一个任务，都空了的时候返回NULL
+    SuiteTask* steal(Worker* thief);
+
+    // 按原来的顺序回放已经完成的并行单位，wait为true时会等待所有并行单位完成
+    void mergeCompletedTasks(CPPUNIT_NS::TestResult* controller, bool wait);
+
+    void clear();
+
+private:
+    ParallelExecutor(const ParallelExecutor& other);
+    ParallelExecutor& operator=(const ParallelExecutor& other);
+};
+
+CUTEST_NS_END
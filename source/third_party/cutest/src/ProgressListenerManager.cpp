@@ -3,6 +3,9 @@
 #include "cutest/Helper.h"
 #include "cutest/Runner.h"
 
+#include "FailureLog.h"
+#include "Thread.h"
+
 #include <algorithm>
 
 #include <cppunit/Test.h>
@@ -11,7 +14,23 @@
 CUTEST_NS_BEGIN
 
 ProgressListenerManager::ProgressListenerManager()
-    : failure_index(0) {}
+    : drainer(this)
+    , drain_scheduled(0)
+    , async_dispatch(false)
+    , regression_gate(NULL)
+    , failure_log(NULL)
+    , producer_id(0)
+    , failure_index(0)
+    , test_start_ns(0)
+    , merging_ns(NULL) {}
+
+unsigned long long
+ProgressListenerManager::now() const {
+    if (this->merging_ns) {
+        return *this->merging_ns;
+    }
+    return CUTEST_NS::tickCountNs();
+}
 
 void
 ProgressListenerManager::add(ProgressListener* listener) {
@@ -29,42 +48,195 @@ ProgressListenerManager::remove(ProgressListener* listener) {
     }
 }
 
-class StartTestRunTask : public ProgressListenerManager::TaskBase {
+void
+ProgressListenerManager::setAsyncDispatch(bool value) {
+    this->async_dispatch = value;
+}
+
+bool
+ProgressListenerManager::asyncDispatch() const {
+    return this->async_dispatch;
+}
+
+void
+ProgressListenerManager::setRegressionGate(const RegressionGate* gate) {
+    this->regression_gate = gate;
+}
+
+void
+ProgressListenerManager::setFailureLog(const FailureLog* log) {
+    this->failure_log = log;
+}
+
+ProgressListenerManager::EventQueue::EventQueue()
+    : tail(0)
+    , cached_head(0)
+    , head(0)
+    , cached_tail(0) {}
+
+bool
+ProgressListenerManager::EventQueue::push(const PendingEvent& event) {
+    long tail_index = this->tail.load();
+    long next = (tail_index + 1) % CAPACITY;
+    // 只有按缓存的head看起来满了，才重新读取消费者的下标
+    if (next == this->cached_head) {
+        this->cached_head = this->head.load();
+        if (next == this->cached_head) {
+            return false;
+        }
+    }
+
+    this->events[tail_index] = event;
+    this->tail.store(next);
+    return true;
+}
+
+bool
+ProgressListenerManager::EventQueue::pop(PendingEvent& event) {
+    long head_index = this->head.load();
+    // 只有按缓存的tail看起来空了，才重新读取生产者的下标
+    if (head_index == this->cached_tail) {
+        this->cached_tail = this->tail.load();
+        if (head_index == this->cached_tail) {
+            return false;
+        }
+    }
+
+    event = this->events[head_index];
+    this->head.store((head_index + 1) % CAPACITY);
+    return true;
+}
+
+static ProgressListenerManager::PendingEvent
+makeEvent(ProgressListenerManager::PendingEvent::Type type, CPPUNIT_NS::Test* test, unsigned long long time_ns) {
+    ProgressListenerManager::PendingEvent event;
+    event.type = type;
+    event.test = test;
+    event.failure = NULL;
+    event.owns_failure = false;
+    event.time_ns = time_ns;
+    event.elapsed_ns = 0;
+    return event;
+}
+
+class DispatchTask : public ProgressListenerManager::TaskBase {
 protected:
-    CPPUNIT_NS::Test* test;
+    ProgressListenerManager::PendingEvent pending;
 
 public:
-    StartTestRunTask(ProgressListenerManager* manager, Event* event, CPPUNIT_NS::Test* test_in)
+    DispatchTask(ProgressListenerManager* manager, Event* event, const ProgressListenerManager::PendingEvent& pending_in)
         : ProgressListenerManager::TaskBase(manager, event)
-        , test(test_in) {}
+        , pending(pending_in) {}
 
     virtual void run() {
-        this->manager->startTestRunImmediately(this->test);
+        this->manager->handleImmediately(this->pending);
     }
 };
 
 void
-ProgressListenerManager::startTestRun(CPPUNIT_NS::Test* test, CPPUNIT_NS::TestResult*) {
+ProgressListenerManager::dispatch(const PendingEvent& event) {
     if (CUTEST_NS::isOnMainThread()) {
-        startTestRunImmediately(test);
-    } else {
-        Event* event = Event::createInstance();
-        StartTestRunTask* task = new StartTestRunTask(this, event, test);
-        Runner::instance()->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
+        handleImmediately(event);
+        return;
+    }
+
+    // Suite结束和整个执行结束时需要同步，其余事件只要放进队列，主线程会按顺序处理
+    bool can_queue = this->async_dispatch
+        && PendingEvent::END_SUITE != event.type
+        && PendingEvent::END_TEST_RUN != event.type
+        && CUTEST_NS::currentThreadId() == this->producer_id;
+
+    if (can_queue) {
+        // FailureLog中的记录在整个执行期间都有效，可以直接引用；其他failure在调用者返回之后就失效了，队列中保存它的副本
+        PendingEvent queued = event;
+        if (queued.failure && !FailureLog::isLogged(queued.failure)) {
+            queued.failure = queued.failure->clone();
+            queued.owns_failure = true;
+        }
+
+        if (this->queue.push(queued)) {
+            if (0 == this->drain_scheduled.compareExchange(0, 1)) {
+                Runner::instance()->asyncRunOnMainThread(&this->drainer, false);
+            }
+            return;
+        }
+        if (queued.owns_failure) {
+            delete queued.failure;
+        }
+    }
+
+    Event* wait_event = Event::createInstance();
+    DispatchTask* task = new DispatchTask(this, wait_event, event);
+    Runner::instance()->asyncRunOnMainThread(task, true);
+    wait_event->wait();
+    wait_event->destroy();
+}
+
+void
+ProgressListenerManager::drain() {
+    // 先清除标记再取事件，之后放进队列的事件要么在这里处理，要么由新投递的drainer处理；
+    // 这里要用带完整屏障的exchange()，不能让后面对tail的读取提前到清除标记之前
+    this->drain_scheduled.exchange(0);
+
+    PendingEvent event;
+    while (this->queue.pop(event)) {
+        handle(event);
+        if (event.owns_failure) {
+            delete event.failure;
+        }
+    }
+}
+
+void
+ProgressListenerManager::handleImmediately(const PendingEvent& event) {
+    drain();
+    handle(event);
+}
+
+void
+ProgressListenerManager::handle(const PendingEvent& event) {
+    switch (event.type) {
+    case PendingEvent::START_TEST_RUN:
+        startTestRunImmediately(event.test, event.time_ns);
+        break;
+    case PendingEvent::END_TEST_RUN:
+        endTestRunImmediately(event.test, event.time_ns);
+        break;
+    case PendingEvent::START_SUITE:
+        startSuiteImmediately(event.test, event.time_ns);
+        break;
+    case PendingEvent::END_SUITE:
+        endSuiteImmediately(event.test, event.time_ns);
+        break;
+    case PendingEvent::START_TEST:
+        StartTestImmediately(event.test);
+        break;
+    case PendingEvent::ADD_FAILURE:
+        addFailureImmediately(*event.failure);
+        break;
+    case PendingEvent::END_TEST:
+        endTestImmediately(event.test, event.elapsed_ns);
+        break;
+    default:
+        break;
     }
 }
 
 void
-ProgressListenerManager::startTestRunImmediately(CPPUNIT_NS::Test* test) {
+ProgressListenerManager::startTestRun(CPPUNIT_NS::Test* test, CPPUNIT_NS::TestResult*) {
+    this->producer_id = CUTEST_NS::currentThreadId();
+    dispatch(makeEvent(PendingEvent::START_TEST_RUN, test, now()));
+}
+
+void
+ProgressListenerManager::startTestRunImmediately(CPPUNIT_NS::Test* test, unsigned long long time_ns) {
     while (!this->test_record.empty()) {
         this->test_record.pop();
     }
     this->failure_index = 0;
 
     TestRecord record;
-    record.start_ms = CUTEST_NS::tickCount64();
+    record.start_ns = time_ns;
     this->test_record.push(record);
 
     TestProgressListeners::iterator it = this->listeners.begin();
@@ -74,78 +246,44 @@ ProgressListenerManager::startTestRunImmediately(CPPUNIT_NS::Test* test) {
     }
 }
 
-class EndTestRunTask : public ProgressListenerManager::TaskBase {
-protected:
-    CPPUNIT_NS::Test* test;
-
-public:
-    EndTestRunTask(ProgressListenerManager* manager, Event* event, CPPUNIT_NS::Test* test_in)
-        : ProgressListenerManager::TaskBase(manager, event)
-        , test(test_in) {}
-
-    virtual void run() {
-        this->manager->endTestRunImmediately(this->test);
-    }
-};
-
 void
 ProgressListenerManager::endTestRun(CPPUNIT_NS::Test* test, CPPUNIT_NS::TestResult*) {
-    if (CUTEST_NS::isOnMainThread()) {
-        endTestRunImmediately(test);
-    } else {
-        Event* event = Event::createInstance();
-        Runner* runner = Runner::instance();
-        EndTestRunTask* task = new EndTestRunTask(this, event, test);
-        runner->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
-    }
+    dispatch(makeEvent(PendingEvent::END_TEST_RUN, test, now()));
 }
 
 void
-ProgressListenerManager::endTestRunImmediately(CPPUNIT_NS::Test* test) {
+ProgressListenerManager::endTestRunImmediately(CPPUNIT_NS::Test* test, unsigned long long time_ns) {
     TestRecord& record = this->test_record.top();
-    unsigned int elapsed_ms = (unsigned int)(CUTEST_NS::tickCount64() - record.start_ms);
+    unsigned long long elapsed_ns = time_ns - record.start_ns;
     this->test_record.pop();
 
+    if (this->regression_gate) {
+        CppUnitVector<Regression> regressions = this->regression_gate->regressions();
+        if (!regressions.empty()) {
+            TestProgressListeners::iterator listener = this->listeners.begin();
+            while (listener != this->listeners.end()) {
+                (*listener)->onRegressionReport(regressions);
+                ++listener;
+            }
+        }
+    }
+
     TestProgressListeners::reverse_iterator it = this->listeners.rbegin();
     while (it != this->listeners.rend()) {
-        (*it)->onRunnerEnd(test, elapsed_ms);
+        (*it)->onRunnerEndNs(test, elapsed_ns);
         ++it;
     }
 }
 
-class StartSuiteTask : public ProgressListenerManager::TaskBase {
-protected:
-    CPPUNIT_NS::Test* suite;
-
-public:
-    StartSuiteTask(ProgressListenerManager* manager, Event* event, CPPUNIT_NS::Test* suite_in)
-        : ProgressListenerManager::TaskBase(manager, event)
-        , suite(suite_in) {}
-
-    virtual void run() {
-        this->manager->startSuiteImmediately(this->suite);
-    }
-};
-
 void
 ProgressListenerManager::startSuite(CPPUNIT_NS::Test* suite) {
-    if (CUTEST_NS::isOnMainThread()) {
-        startSuiteImmediately(suite);
-    } else {
-        Event* event = Event::createInstance();
-        StartSuiteTask* task = new StartSuiteTask(this, event, suite);
-        Runner::instance()->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
-    }
+    dispatch(makeEvent(PendingEvent::START_SUITE, suite, now()));
 }
 
 void
-ProgressListenerManager::startSuiteImmediately(CPPUNIT_NS::Test* suite) {
+ProgressListenerManager::startSuiteImmediately(CPPUNIT_NS::Test* suite, unsigned long long time_ns) {
     TestRecord record;
-    record.start_ms = CUTEST_NS::tickCount64();
+    record.start_ns = time_ns;
     this->test_record.push(record);
 
     TestProgressListeners::iterator it = this->listeners.begin();
@@ -155,80 +293,36 @@ ProgressListenerManager::startSuiteImmediately(CPPUNIT_NS::Test* suite) {
     }
 }
 
-class EndSuiteTask : public ProgressListenerManager::TaskBase {
-protected:
-    CPPUNIT_NS::Test* suite;
-
-public:
-    EndSuiteTask(ProgressListenerManager* manager, Event* event, CPPUNIT_NS::Test* suite_in)
-        : ProgressListenerManager::TaskBase(manager, event)
-        , suite(suite_in) {}
-
-    virtual void run() {
-        this->manager->endSuiteImmediately(this->suite);
-    }
-};
-
 void
 ProgressListenerManager::endSuite(CPPUNIT_NS::Test* suite) {
-    if (CUTEST_NS::isOnMainThread()) {
-        endSuiteImmediately(suite);
-    } else {
-        Runner* runner = Runner::instance();
-        Event* event = Event::createInstance();
-        EndSuiteTask* task = new EndSuiteTask(this, event, suite);
-        runner->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
-    }
+    dispatch(makeEvent(PendingEvent::END_SUITE, suite, now()));
 }
 
 void
-ProgressListenerManager::endSuiteImmediately(CPPUNIT_NS::Test* suite) {
+ProgressListenerManager::endSuiteImmediately(CPPUNIT_NS::Test* suite, unsigned long long time_ns) {
     TestRecord& record = this->test_record.top();
-    unsigned int elapsed_ms = (unsigned int)(CUTEST_NS::tickCount64() - record.start_ms);
+    unsigned long long elapsed_ns = time_ns - record.start_ns;
     this->test_record.pop();
 
     TestProgressListeners::reverse_iterator it = this->listeners.rbegin();
     while (it != this->listeners.rend()) {
-        (*it)->onSuiteEnd(suite, elapsed_ms);
+        (*it)->onSuiteEndNs(suite, elapsed_ns);
         ++it;
     }
 }
 
-class StartTestTask : public ProgressListenerManager::TaskBase {
-protected:
-    CPPUNIT_NS::Test* test;
-
-public:
-    StartTestTask(ProgressListenerManager* manager, Event* event, CPPUNIT_NS::Test* test_in)
-        : ProgressListenerManager::TaskBase(manager, event)
-        , test(test_in) {}
-
-    virtual void run() {
-        this->manager->StartTestImmediately(this->test);
-    }
-};
-
 void
 ProgressListenerManager::startTest(CPPUNIT_NS::Test* test) {
-    if (CUTEST_NS::isOnMainThread()) {
-        StartTestImmediately(test);
-    } else {
-        Event* event = Event::createInstance();
-        StartTestTask* task = new StartTestTask(this, event, test);
-        Runner::instance()->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
-    }
+    dispatch(makeEvent(PendingEvent::START_TEST, test, now()));
+
     // 在这记录开始时间，避免把线程切换的时间也计算在内
-    TestRecord record;
-    record.start_ms = CUTEST_NS::tickCount64();
-    this->test_record.push(record);
+    this->test_start_ns = now();
 }
 
 void
 ProgressListenerManager::StartTestImmediately(CPPUNIT_NS::Test* test) {
+    this->test_record.push(TestRecord());
+
     TestProgressListeners::iterator it = this->listeners.begin();
     while (it != this->listeners.end()) {
         (*it)->onTestStart(test);
@@ -236,37 +330,11 @@ ProgressListenerManager::StartTestImmediately(CPPUNIT_NS::Test* test) {
     }
 }
 
-class AddFailureTask : public ProgressListenerManager::TaskBase {
-protected:
-    CPPUNIT_NS::TestFailure* failure;
-
-public:
-    AddFailureTask(ProgressListenerManager* manager_in, Event* event, const CPPUNIT_NS::TestFailure& failure_in)
-        : ProgressListenerManager::TaskBase(manager_in, event)
-        , failure(NULL) {
-        this->failure = failure_in.clone();
-    }
-
-    virtual ~AddFailureTask() {
-        delete this->failure;
-    }
-
-    virtual void run() {
-        this->manager->addFailureImmediately(*this->failure);
-    }
-};
-
 void
 ProgressListenerManager::addFailure(const CPPUNIT_NS::TestFailure& failure) {
-    if (CUTEST_NS::isOnMainThread()) {
-        addFailureImmediately(failure);
-    } else {
-        Event* event = Event::createInstance();
-        AddFailureTask* task = new AddFailureTask(this, event, failure);
-        Runner::instance()->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
-    }
+    PendingEvent event = makeEvent(PendingEvent::ADD_FAILURE, failure.failedTest(), now());
+    event.failure = &failure;
+    dispatch(event);
 }
 
 void
@@ -290,50 +358,174 @@ ProgressListenerManager::addFailureImmediately(const CPPUNIT_NS::TestFailure& fa
     ++this->failure_index;
 }
 
-class EndTestTask : public ProgressListenerManager::TaskBase {
-protected:
-    CPPUNIT_NS::Test* test;
-    unsigned int elapsed_ms;
-
-public:
-    EndTestTask(ProgressListenerManager* manager, Event* event, CPPUNIT_NS::Test* test_in, unsigned int elapsed_ms_in)
-        : ProgressListenerManager::TaskBase(manager, event)
-        , test(test_in)
-        , elapsed_ms(elapsed_ms_in) {}
-
-    virtual void run() {
-        this->manager->endTestImmediately(this->test, this->elapsed_ms);
-    }
-};
-
 void
 ProgressListenerManager::endTest(CPPUNIT_NS::Test* test) {
-    Runner* runner = Runner::instance();
     // 在这记录用例耗时，避免把线程切换的时间也计算在内
-    TestRecord& record = this->test_record.top();
-    unsigned int elapsed_ms = (unsigned int)(CUTEST_NS::tickCount64() - record.start_ms);
-
-    if (CUTEST_NS::isOnMainThread()) {
-        endTestImmediately(test, elapsed_ms);
-    } else {
-        Event* event = Event::createInstance();
-        EndTestTask* task = new EndTestTask(this, event, test, elapsed_ms);
-        runner->asyncRunOnMainThread(task, true);
-        event->wait();
-        event->destroy();
-    }
+    unsigned long long time_ns = now();
+    PendingEvent event = makeEvent(PendingEvent::END_TEST, test, time_ns);
+    event.elapsed_ns = time_ns - this->test_start_ns;
+    dispatch(event);
 }
 
 void
-ProgressListenerManager::endTestImmediately(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) {
+ProgressListenerManager::endTestImmediately(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
     TestRecord& record = this->test_record.top();
+
+    // 用例结束之后不会再有它的失败，这时取到的就是全部省略的失败，也要计入用例的错误数、失败数
+    if (this->failure_log) {
+        CppUnitVector<OmittedFailure> omitted = this->failure_log->omittedFailures(test);
+        if (!omitted.empty()) {
+            for (size_t i = 0; i < omitted.size(); ++i) {
+                if (omitted[i].is_error) {
+                    record.errors += (int)omitted[i].count;
+                } else {
+                    record.failures += (int)omitted[i].count;
+                }
+            }
+
+            TestProgressListeners::iterator listener = this->listeners.begin();
+            while (listener != this->listeners.end()) {
+                (*listener)->onFailuresOmitted(test, omitted);
+                ++listener;
+            }
+        }
+    }
+
+    // 测量结果保存在用例上，直到下次执行才会清除，所以异步分发或者并行回放时也不需要另外保存
+    BenchmarkTest* benchmark = dynamic_cast<BenchmarkTest*>(test);
+    if (benchmark && benchmark->benchmarkResult()) {
+        TestProgressListeners::iterator listener = this->listeners.begin();
+        while (listener != this->listeners.end()) {
+            (*listener)->onBenchmarkEnd(test, *benchmark->benchmarkResult());
+            ++listener;
+        }
+    }
+
     TestProgressListeners::reverse_iterator it = this->listeners.rbegin();
     while (it != this->listeners.rend()) {
-        (*it)->onTestEnd(test, record.errors, record.failures, elapsed_ms);
+        (*it)->onTestEndNs(test, record.errors, record.failures, elapsed_ns);
         ++it;
     }
 
     this->test_record.pop();
 }
 
+ProgressListenerManager::Recorder::Recorder() {}
+
+ProgressListenerManager::Recorder::~Recorder() {
+    clear();
+}
+
+void
+ProgressListenerManager::Recorder::clear() {
+    RecordedEvents::iterator it = this->events.begin();
+    while (it != this->events.end()) {
+        delete it->exception;
+        ++it;
+    }
+    this->events.clear();
+}
+
+void
+ProgressListenerManager::Recorder::record(EventType type, CPPUNIT_NS::Test* test) {
+    RecordedEvent event;
+    event.type = type;
+    event.test = test;
+    event.exception = NULL;
+    event.is_error = false;
+    event.time_ns = CUTEST_NS::tickCountNs();
+    this->events.push_back(event);
+}
+
+void
+ProgressListenerManager::Recorder::startSuite(CPPUNIT_NS::Test* suite) {
+    record(EVENT_START_SUITE, suite);
+}
+
+void
+ProgressListenerManager::Recorder::endSuite(CPPUNIT_NS::Test* suite) {
+    record(EVENT_END_SUITE, suite);
+}
+
+void
+ProgressListenerManager::Recorder::startTest(CPPUNIT_NS::Test* test) {
+    record(EVENT_START_TEST, test);
+}
+
+void
+ProgressListenerManager::Recorder::addFailure(const CPPUNIT_NS::TestFailure& failure) {
+    record(EVENT_ADD_FAILURE, failure.failedTest());
+
+    // 工作线程上的失败直接接管exception，其他来源的failure在调用者返回之后就失效了，保存它的副本
+    const Failure* handed_off = dynamic_cast<const Failure*>(&failure);
+    RecordedEvent& event = this->events.back();
+    event.exception = handed_off ? handed_off->release() : failure.thrownException()->clone();
+    event.is_error = failure.isError();
+}
+
+void
+ProgressListenerManager::Recorder::endTest(CPPUNIT_NS::Test* test) {
+    record(EVENT_END_TEST, test);
+}
+
+ProgressListenerManager::Recorder::Failure::Failure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception, bool is_error)
+    : CPPUNIT_NS::TestFailure(test, exception, is_error)
+    , is_released(false) {}
+
+ProgressListenerManager::Recorder::Failure::~Failure() {
+    // 已经交给Recorder的exception不能由TestFailure的析构函数销毁
+    if (this->is_released) {
+        this->m_thrownException = NULL;
+    }
+}
+
+CPPUNIT_NS::Exception*
+ProgressListenerManager::Recorder::Failure::release() const {
+    if (this->is_released) {
+        return NULL;
+    }
+
+    this->is_released = true;
+    return this->m_thrownException;
+}
+
+void
+ProgressListenerManager::merge(Recorder* recorder, CPPUNIT_NS::TestResult* controller) {
+    Recorder::RecordedEvents::iterator it = recorder->events.begin();
+    while (it != recorder->events.end()) {
+        // 回放期间，TestRecord的计时都以事件实际发生的时刻为准
+        this->merging_ns = &it->time_ns;
+
+        switch (it->type) {
+        case Recorder::EVENT_START_SUITE:
+            controller->startSuite(it->test);
+            break;
+        case Recorder::EVENT_END_SUITE:
+            controller->endSuite(it->test);
+            break;
+        case Recorder::EVENT_START_TEST:
+            controller->startTest(it->test);
+            break;
+        case Recorder::EVENT_ADD_FAILURE:
+            // exception的所有权交给controller
+            if (it->is_error) {
+                controller->addError(it->test, it->exception);
+            } else {
+                controller->addFailure(it->test, it->exception);
+            }
+            it->exception = NULL;
+            break;
+        case Recorder::EVENT_END_TEST:
+            controller->endTest(it->test);
+            break;
+        default:
+            break;
+        }
+        ++it;
+    }
+
+    this->merging_ns = NULL;
+    recorder->clear();
+}
+
 CUTEST_NS_END
@@ -1,11 +1,19 @@
 ﻿#pragma once
 
+#include <cppunit/Exception.h>
+#include <cppunit/TestFailure.h>
 #include <cppunit/TestListener.h>
+#include <cppunit/TestResult.h>
 
 #include "cutest/Event.h"
+#include "cutest/Helper.h"
 #include "cutest/Runnable.h"
 #include "cutest/ProgressListener.h"
 
+#include "FailureLog.h"
+#include "RegressionGate.h"
+#include "Thread.h"
+
 // std
 #include <cppunit/portability/CppUnitVector.h>
 #include <stack>
@@ -20,6 +28,16 @@ public:
     void add(ProgressListener* listener);
     void remove(ProgressListener* listener);
 
+    // 见Runner::setAsyncProgressDispatch()，需要在startTestRun()之前设置
+    void setAsyncDispatch(bool value);
+    bool asyncDispatch() const;
+
+    // 见Runner::setPerformanceBaseline()，gate不为NULL时，执行结束前把它发现的退化通知给所有ProgressListener
+    void setRegressionGate(const RegressionGate* gate);
+
+    // 见Runner::setFailureRetention()，用例结束时把log中这个用例省略的失败通知给所有ProgressListener
+    void setFailureLog(const FailureLog* log);
+
 protected:
     typedef CppUnitVector<ProgressListener*> TestProgressListeners;
     TestProgressListeners listeners;
@@ -28,16 +46,16 @@ public:
     //////////////////////////////////////////////////////////////////////////
     // 重载TestListener的成员方法
     virtual void startTestRun(CPPUNIT_NS::Test* test, CPPUNIT_NS::TestResult*);
-    void startTestRunImmediately(CPPUNIT_NS::Test* test);
+    void startTestRunImmediately(CPPUNIT_NS::Test* test, unsigned long long time_ns);
 
     virtual void endTestRun(CPPUNIT_NS::Test* test, CPPUNIT_NS::TestResult*);
-    void endTestRunImmediately(CPPUNIT_NS::Test* test);
+    void endTestRunImmediately(CPPUNIT_NS::Test* test, unsigned long long time_ns);
 
     virtual void startSuite(CPPUNIT_NS::Test* suite);
-    void startSuiteImmediately(CPPUNIT_NS::Test* suite);
+    void startSuiteImmediately(CPPUNIT_NS::Test* suite, unsigned long long time_ns);
 
     virtual void endSuite(CPPUNIT_NS::Test* suite);
-    void endSuiteImmediately(CPPUNIT_NS::Test* suite);
+    void endSuiteImmediately(CPPUNIT_NS::Test* suite, unsigned long long time_ns);
 
     virtual void startTest(CPPUNIT_NS::Test* test);
     void StartTestImmediately(CPPUNIT_NS::Test* test);
@@ -46,7 +64,92 @@ public:
     void addFailureImmediately(const CPPUNIT_NS::TestFailure& failure);
 
     virtual void endTest(CPPUNIT_NS::Test* test);
-    void endTestImmediately(CPPUNIT_NS::Test* test, unsigned int elapsed_ms);
+    void endTestImmediately(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns);
+
+    // 待分发给ProgressListener的事件
+    struct PendingEvent {
+        enum Type {
+            START_TEST_RUN = 0,
+            END_TEST_RUN,
+            START_SUITE,
+            END_SUITE,
+            START_TEST,
+            ADD_FAILURE,
+            END_TEST,
+        };
+
+        Type type;
+        CPPUNIT_NS::Test* test;
+        const CPPUNIT_NS::TestFailure* failure; // 只有ADD_FAILURE才有
+        bool owns_failure;                      // failure是否为放进队列时复制的副本，处理完之后要销毁
+        unsigned long long time_ns;             // 事件发生的时刻，单位：ns
+        unsigned long long elapsed_ns;          // 只有END_TEST才有
+    };
+
+    // 在主线程上调用，先处理完队列中的事件，再处理event
+    void handleImmediately(const PendingEvent& event);
+
+    /*
+        并行执行时，工作线程上的事件先由Recorder连同发生的时刻一起记录下来，
+        轮到这个Suite时再通过merge()按顺序回放给controller，
+        这样每个Suite的事件仍然是完整、有序的，ProgressListener收到的耗时也是实际的耗时。
+    */
+    class Recorder : public CPPUNIT_NS::TestListener {
+        friend class ProgressListenerManager;
+
+    public:
+        Recorder();
+        virtual ~Recorder();
+
+        void clear();
+
+        virtual void startSuite(CPPUNIT_NS::Test* suite) override;
+        virtual void endSuite(CPPUNIT_NS::Test* suite) override;
+        virtual void startTest(CPPUNIT_NS::Test* test) override;
+        virtual void addFailure(const CPPUNIT_NS::TestFailure& failure) override;
+        virtual void endTest(CPPUNIT_NS::Test* test) override;
+
+        /*
+            工作线程的TestResult（见ParallelExecutor::WorkerResult）用它通知失败，
+            Recorder直接接管其中的exception，不再clone()；没有被接管时，析构时仍然销毁exception
+        */
+        class Failure : public CPPUNIT_NS::TestFailure {
+        public:
+            Failure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception, bool is_error);
+            virtual ~Failure();
+
+            // 转移exception的所有权，Failure析构之前，后面的TestListener仍然可以访问exception
+            CPPUNIT_NS::Exception* release() const;
+
+        protected:
+            mutable bool is_released;
+        };
+
+    protected:
+        enum EventType {
+            EVENT_START_SUITE = 0,
+            EVENT_END_SUITE,
+            EVENT_START_TEST,
+            EVENT_ADD_FAILURE,
+            EVENT_END_TEST,
+        };
+
+        struct RecordedEvent {
+            EventType type;
+            CPPUNIT_NS::Test* test;
+            CPPUNIT_NS::Exception* exception; // 只有EVENT_ADD_FAILURE才有，回放时交给controller
+            bool is_error;
+            unsigned long long time_ns;       // 事件发生的时刻，单位：ns
+        };
+
+        typedef CppUnitVector<RecordedEvent> RecordedEvents;
+        RecordedEvents events;
+
+        void record(EventType type, CPPUNIT_NS::Test* test);
+    };
+
+    // 把recorder记录的事件按顺序回放给controller的所有TestListener，回放之后recorder会被清空
+    void merge(Recorder* recorder, CPPUNIT_NS::TestResult* controller);
 
     class TaskBase : public Runnable {
     protected:
@@ -66,20 +169,89 @@ public:
     };
 
 protected:
+    // 在主线程上把event通知给所有ProgressListener
+    void handle(const PendingEvent& event);
+
+    /*
+        把event交给主线程处理：
+        - 在主线程上调用时，直接调用handleImmediately()；
+        - 异步分发时，执行用例的线程只把event放进队列，必要时投递一个drainer，不等待；
+        - 其余情况（包括队列已满）投递一个任务，等主线程处理完队列中的事件和event之后再返回。
+    */
+    void dispatch(const PendingEvent& event);
+
+    // 在主线程上按顺序处理队列中的所有事件
+    void drain();
+
+    /*
+        单生产者单消费者的环形队列：生产者是执行用例的线程，消费者是主线程。
+        head只由消费者修改，tail只由生产者修改，留一个空位来区分队列满和队列空。
+    */
+    class EventQueue {
+    public:
+        EventQueue();
+
+        bool push(const PendingEvent& event); // 队列已满时返回false
+        bool pop(PendingEvent& event);        // 队列为空时返回false
+
+    protected:
+        enum { CAPACITY = 1024 };
+
+        PendingEvent events[CAPACITY];
+
+        // 生产者使用：tail只由生产者修改，cached_head是上次读到的head
+        AtomicLong tail;
+        long cached_head;
+
+        // 消费者（主线程）使用：head只由消费者修改，cached_tail是上次读到的tail
+        AtomicLong head;
+        long cached_tail;
+    };
+    EventQueue queue;
+
+    class Drainer : public Runnable {
+    public:
+        explicit Drainer(ProgressListenerManager* manager_in)
+            : manager(manager_in) {}
+
+        // 实现Runnable::run()，在主线程上执行
+        virtual void run() {
+            this->manager->drain();
+        }
+
+    protected:
+        ProgressListenerManager* manager;
+    };
+    Drainer drainer;
+    AtomicLong drain_scheduled; // 非0表示已经投递了drainer，主线程还没有开始处理
+
+    bool async_dispatch;
+    const RegressionGate* regression_gate;
+    const FailureLog* failure_log;
+    thread_id producer_id; // 执行用例的线程，即调用startTestRun()的线程
+
     struct TestRecord {
         TestRecord()
-            : start_ms(0)
+            : start_ns(0)
             , errors(0)
             , failures(0) {}
 
-        unsigned long long start_ms;
+        unsigned long long start_ns;
         int errors;
         int failures;
     };
 
+    // 只在主线程上访问
     std::stack<TestRecord> test_record;
 
     unsigned int failure_index;
+
+    // 用例开始的时刻，在执行用例的线程上记录和使用，用来计算用例耗时
+    unsigned long long test_start_ns;
+
+    // merge()期间指向正在回放的事件发生的时刻，其余时间为NULL
+    const unsigned long long* merging_ns;
+    unsigned long long now() const;
 };
 
 CUTEST_NS_END
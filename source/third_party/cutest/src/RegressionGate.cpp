@@ -0,0 +1,367 @@
+﻿#include "RegressionGate.h"
+
+#include <cppunit/Exception.h>
+#include <cppunit/Message.h>
+#include <cppunit/ProtectorContext.h>
+
+#include "cutest/Helper.h"
+#include "cutest/Runner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#include <stdio.h>
+#include <utility>
+
+CUTEST_NS_BEGIN
+
+namespace {
+
+// 基准测试的单侧显著性水平
+const double SIGNIFICANCE = 0.01;
+
+// 两边的样本数都不少于这个数时才做Mann-Whitney U检验，否则只比较中位数
+const size_t MIN_SAMPLES = 5;
+
+// 普通用例至少慢了这么多才认为是退化，单位：ns，避免耗时很短的用例因为抖动而失败
+const unsigned long long MIN_DELTA_NS = 1000000;
+
+double
+median(CppUnitVector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    if (values.size() % 2) {
+        return values[middle];
+    }
+    return (values[middle - 1] + values[middle]) / 2;
+}
+
+// 标准正态分布的上侧概率P(Z > z)，erfc()用Abramowitz-Stegun 7.1.26近似，误差小于1.5e-7
+double
+normalUpperTail(double z) {
+    double x = fabs(z) / sqrt(2.0);
+    double t = 1 / (1 + 0.3275911 * x);
+    double erfc = t * (0.254829592 + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429)))) * exp(-x * x);
+    return z >= 0 ? erfc / 2 : 1 - erfc / 2;
+}
+
+/*
+    Mann-Whitney U检验：current比baseline大（即变慢了）的单侧p值，
+    用正态近似计算，并修正了相同值和连续性
+*/
+double
+mannWhitneyGreater(const CppUnitVector<double>& current, const CppUnitVector<double>& baseline) {
+    typedef std::pair<double, bool> Sample; // second为true表示来自current
+    CppUnitVector<Sample> samples;
+    for (size_t index = 0; index < current.size(); ++index) {
+        samples.push_back(Sample(current[index], true));
+    }
+    for (size_t index = 0; index < baseline.size(); ++index) {
+        samples.push_back(Sample(baseline[index], false));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // 相同的值取平均秩
+    double rank_sum = 0;
+    double ties = 0;
+    size_t begin = 0;
+    while (begin < samples.size()) {
+        size_t end = begin + 1;
+        while (end < samples.size() && samples[end].first == samples[begin].first) {
+            ++end;
+        }
+
+        double rank = (begin + 1 + end) / 2.0;
+        for (size_t index = begin; index < end; ++index) {
+            if (samples[index].second) {
+                rank_sum += rank;
+            }
+        }
+
+        double count = (double)(end - begin);
+        ties += count * count * count - count;
+        begin = end;
+    }
+
+    double n1 = (double)current.size();
+    double n2 = (double)baseline.size();
+    double n = n1 + n2;
+    double u = rank_sum - n1 * (n1 + 1) / 2;
+    double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+    if (variance <= 0) {
+        return 1;
+    }
+
+    return normalUpperTail((u - n1 * n2 / 2 - 0.5) / sqrt(variance));
+}
+
+double
+ratioOf(const Regression& regression) {
+    return regression.current_ns / std::max(regression.baseline_ns, 1.0);
+}
+
+bool
+isWorseThan(const Regression& left, const Regression& right) {
+    return ratioOf(left) > ratioOf(right);
+}
+
+// 失败信息的详细描述，比如"median per iteration 15.7 us -> 19.2 us (+22.3%), Mann-Whitney p = 0.0004"
+std::string
+describe(const Regression& regression) {
+    std::string description = regression.is_benchmark ? "median per iteration " : "elapsed ";
+    description += formatDuration(regression.baseline_ns);
+    description += " -> ";
+    description += formatDuration(regression.current_ns);
+
+    char buffer[64] = {0};
+    ::sprintf(buffer, " (%+.1f%%)", (ratioOf(regression) - 1) * 100);
+    description += buffer;
+
+    if (regression.p_value >= 0) {
+        ::sprintf(buffer, ", Mann-Whitney p = %.2g", regression.p_value);
+        description += buffer;
+    }
+    return description;
+}
+
+} // namespace
+
+RegressionGate::RegressionGate()
+    : threshold_percent(0)
+    , current_regressed(false)
+    , has_benchmark(false) {}
+
+void
+RegressionGate::setFiles(const char* baseline_path_in, const char* output_path_in, unsigned int threshold_percent_in) {
+    this->baseline_path = baseline_path_in ? baseline_path_in : "";
+    this->output_path = output_path_in ? output_path_in : "";
+    this->threshold_percent = threshold_percent_in;
+
+    this->baseline.clear();
+    if (!this->baseline_path.empty()) {
+        load(this->baseline_path, this->baseline);
+    }
+}
+
+bool
+RegressionGate::isEnabled() const {
+    return hasBaseline() || !this->output_path.empty();
+}
+
+bool
+RegressionGate::hasBaseline() const {
+    return !this->baseline.empty();
+}
+
+CPPUNIT_NS::Protector*
+RegressionGate::createTimer() const {
+    return new Timer(this);
+}
+
+bool
+RegressionGate::compare(
+    const std::string& name,
+    unsigned long long elapsed_ns,
+    const BenchmarkResult* benchmark,
+    Regression& regression) const {
+    Records::const_iterator it = this->baseline.find(name);
+    if (it == this->baseline.end()) {
+        return false;
+    }
+
+    const Record& record = it->second;
+    double limit = 1 + this->threshold_percent / 100.0;
+    regression.name = name;
+
+    if (benchmark && !benchmark->samples_ns.empty() && !record.samples_ns.empty()) {
+        regression.is_benchmark = true;
+        regression.baseline_ns = median(record.samples_ns);
+        regression.current_ns = median(benchmark->samples_ns);
+        if (regression.current_ns <= regression.baseline_ns * limit) {
+            return false;
+        }
+
+        if (benchmark->samples_ns.size() < MIN_SAMPLES || record.samples_ns.size() < MIN_SAMPLES) {
+            return true;
+        }
+        regression.p_value = mannWhitneyGreater(benchmark->samples_ns, record.samples_ns);
+        return regression.p_value < SIGNIFICANCE;
+    }
+
+    regression.baseline_ns = (double)record.elapsed_ns;
+    regression.current_ns = (double)elapsed_ns;
+    return regression.current_ns > regression.baseline_ns * limit
+           && elapsed_ns >= record.elapsed_ns + MIN_DELTA_NS;
+}
+
+CppUnitVector<Regression>
+RegressionGate::regressions() const {
+    CppUnitVector<Regression> sorted(this->found);
+    std::stable_sort(sorted.begin(), sorted.end(), isWorseThan);
+    return sorted;
+}
+
+const char*
+RegressionGate::failureDescription() {
+    return "performance regression";
+}
+
+void
+RegressionGate::load(const std::string& path, Records& records) {
+    std::ifstream file(path.c_str());
+    unsigned long long elapsed_ns = 0;
+    unsigned int count = 0;
+    while (file >> elapsed_ns >> count) {
+        Record record;
+        record.elapsed_ns = elapsed_ns;
+
+        double sample = 0;
+        for (unsigned int index = 0; index < count && file >> sample; ++index) {
+            record.samples_ns.push_back(sample);
+        }
+
+        // 跳过样本和用例名之间的空格
+        std::string name;
+        std::getline(file, name);
+        std::string::size_type pos = name.find_first_not_of(' ');
+        if (std::string::npos == pos) {
+            continue;
+        }
+
+        records[name.substr(pos)] = record;
+    }
+}
+
+void
+RegressionGate::save() {
+    if (this->output_path.empty()) {
+        return;
+    }
+
+    // 本次没有执行的用例保留基线中的结果
+    Records records(this->baseline);
+    Records::iterator it = this->current.begin();
+    while (it != this->current.end()) {
+        records[it->first] = it->second;
+        ++it;
+    }
+
+    std::ofstream file(this->output_path.c_str(), std::ios::out | std::ios::trunc);
+    file.precision(10);
+    it = records.begin();
+    while (it != records.end()) {
+        const Record& record = it->second;
+        file << record.elapsed_ns << ' ' << record.samples_ns.size();
+        for (size_t index = 0; index < record.samples_ns.size(); ++index) {
+            file << ' ' << record.samples_ns[index];
+        }
+        file << ' ' << it->first << '\n';
+        ++it;
+    }
+}
+
+void
+RegressionGate::onRunnerStart(CPPUNIT_NS::Test* test) {
+    this->current.clear();
+    this->found.clear();
+    this->current_regressed = false;
+    this->has_benchmark = false;
+}
+
+void
+RegressionGate::onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
+    save();
+}
+
+void
+RegressionGate::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) {
+    const CPPUNIT_NS::Exception* exception = failure.thrownException();
+    if (exception && exception->message().shortDescription() == failureDescription()) {
+        this->current_regressed = true;
+    }
+}
+
+void
+RegressionGate::onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) {
+    this->benchmark = result;
+    this->has_benchmark = true;
+}
+
+void
+RegressionGate::onTestEndNs(
+    CPPUNIT_NS::Test* test,
+    unsigned int error_count,
+    unsigned int failure_count,
+    unsigned long long elapsed_ns) {
+    std::string name = test->getName();
+    Record& record = this->current[name];
+    record.elapsed_ns = elapsed_ns;
+    record.samples_ns.clear();
+    if (this->has_benchmark) {
+        record.samples_ns = this->benchmark.samples_ns;
+    }
+
+    // 退化是在执行用例的线程上判定的，这里只用主线程上的结果生成报告
+    if (this->current_regressed) {
+        Regression regression;
+        compare(name, elapsed_ns, this->has_benchmark ? &this->benchmark : NULL, regression);
+        this->found.push_back(regression);
+    }
+
+    this->current_regressed = false;
+    this->has_benchmark = false;
+}
+
+RegressionGate::Timer::Timer(const RegressionGate* gate_in)
+    : gate(gate_in)
+    , start_ns(0)
+    , depth(0)
+    , failed(false) {}
+
+bool
+RegressionGate::Timer::protect(const CPPUNIT_NS::Functor& functor, const CPPUNIT_NS::ProtectorContext& context) {
+    // TestCase::run()用这两个描述分别保护setUp()和tearDown()，中间runTest()的描述为空
+    bool is_outermost = (0 == this->depth);
+    bool is_set_up = ("setUp() failed" == context.m_shortDescription);
+    bool is_tear_down = ("tearDown() failed" == context.m_shortDescription);
+    if (is_outermost && is_set_up) {
+        this->start_ns = CUTEST_NS::tickCountNs();
+        this->failed = false;
+    }
+
+    bool succeeded = false;
+    ++this->depth;
+    try {
+        succeeded = functor();
+    } catch (...) {
+        --this->depth;
+        this->failed = true;
+        throw;
+    }
+    --this->depth;
+    if (!succeeded) {
+        this->failed = true;
+    }
+
+    if (is_outermost && is_tear_down && !this->failed) {
+        unsigned long long elapsed_ns = CUTEST_NS::tickCountNs() - this->start_ns;
+        const BenchmarkTest* benchmark = dynamic_cast<const BenchmarkTest*>(context.m_test);
+        const BenchmarkResult* result = benchmark ? benchmark->benchmarkResult() : NULL;
+
+        Regression regression;
+        if (this->gate->compare(context.m_test->getName(), elapsed_ns, result, regression)) {
+            // 这时用例还没有结束，失败会记录到这个用例上
+            Runner::instance()->addFailure(
+                false,
+                new CPPUNIT_NS::Exception(CPPUNIT_NS::Message(failureDescription(), describe(regression))));
+        }
+    }
+
+    return succeeded;
+}
+
+CUTEST_NS_END
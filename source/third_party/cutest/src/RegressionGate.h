@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <cppunit/Protector.h>
+#include <cppunit/portability/CppUnitVector.h>
+
+#include <map>
+#include <string>
+
+#include "cutest/ProgressListener.h"
+
+CUTEST_NS_BEGIN
+
+/*
+    和性能基线比较，见Runner::setPerformanceBaseline()：
+    - 在每个执行用例的TestResult上安装createTimer()创建的Protector，用例的tearDown()结束时在执行用例的线程上和基线比较，
+      退化时通过Runner::addFailure()把这个用例标记为失败；
+    - 作为ProgressListener在主线程上记录本次的结果和被标记为退化的用例，onRunnerEnd()时写到输出文件。
+    文件为文本格式，每行一个用例："耗时(ns) 样本数 样本1(ns) ... 样本N(ns) 用例名"，普通用例的样本数为0。
+*/
+class RegressionGate : public ProgressListener {
+public:
+    RegressionGate();
+
+    // 设置文件和阈值，并立即加载基线，见Runner::setPerformanceBaseline()
+    void setFiles(const char* baseline_path, const char* output_path, unsigned int threshold_percent);
+    bool isEnabled() const;   // 需要比较或者需要输出
+    bool hasBaseline() const; // 加载到了基线，需要比较
+
+    // 有基线时，给执行用例的TestResult创建一个计时的Protector，通过TestResult::pushProtector()安装，由TestResult负责销毁
+    CPPUNIT_NS::Protector* createTimer() const;
+
+    /*
+        把名为name的用例本次的结果和基线比较，benchmark可以为NULL，退化时返回true；
+        只要基线中有这个用例就会填写regression，只读取基线，可以在任何线程上调用。
+    */
+    bool compare(
+        const std::string& name,
+        unsigned long long elapsed_ns,
+        const BenchmarkResult* benchmark,
+        Regression& regression) const;
+
+    // 本次执行中被标记为退化的用例，按退化比例从大到小排列，只能在主线程上调用
+    CppUnitVector<Regression> regressions() const;
+
+    // 用例被标记为退化时，失败信息的简短描述
+    static const char* failureDescription();
+
+    //////////////////////////////////////////////////////////////////////////
+    // 重载ProgressListener的成员方法
+    virtual void onRunnerStart(CPPUNIT_NS::Test* test) override;
+    virtual void onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) override;
+    virtual void onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) override;
+    virtual void onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) override;
+    virtual void onTestEndNs(
+        CPPUNIT_NS::Test* test,
+        unsigned int error_count,
+        unsigned int failure_count,
+        unsigned long long elapsed_ns) override;
+    //////////////////////////////////////////////////////////////////////////
+
+protected:
+    std::string baseline_path;
+    std::string output_path;
+    unsigned int threshold_percent;
+
+    struct Record {
+        Record()
+            : elapsed_ns(0) {}
+
+        unsigned long long elapsed_ns;
+        CppUnitVector<double> samples_ns; // 只有基准测试才有
+    };
+    typedef std::map<std::string, Record> Records; // key为用例名
+    Records baseline;
+    Records current;
+
+    // 以下只在主线程上访问，用来记录当前用例的情况
+    bool current_regressed;
+    bool has_benchmark;
+    BenchmarkResult benchmark;
+    CppUnitVector<Regression> found;
+
+    static void load(const std::string& path, Records& records);
+    void save();
+
+    /*
+        从setUp()开始计时，到tearDown()结束时和基线比较，每个TestResult一个；
+        ExplicitEndTestCaller等会在主线程上嵌套调用protect()，这时执行用例的线程在等待主线程，
+        只在最外层（即执行用例的线程上）计时和比较。
+    */
+    class Timer : public CPPUNIT_NS::Protector {
+    public:
+        explicit Timer(const RegressionGate* gate);
+
+        virtual bool protect(const CPPUNIT_NS::Functor& functor, const CPPUNIT_NS::ProtectorContext& context) override;
+
+    protected:
+        const RegressionGate* gate;
+        unsigned long long start_ns;
+        unsigned int depth; // protect()的嵌套层数
+        bool failed; // 用例在setUp()、runTest()或者tearDown()中抛出了异常，不再比较
+    };
+};
+
+CUTEST_NS_END
@@ -4,7 +4,8 @@ CUTEST_NS_BEGIN
 
 Result::Result(SynchronizedObject::SynchronizationObject* listener_lock, SynchronizedObject::SynchronizationObject* stop_lock_in)
     : CPPUNIT_NS::TestResult(listener_lock)
-    , stop_lock(stop_lock_in) {}
+    , stop_lock(stop_lock_in)
+    , failure_log(NULL) {}
 
 Result::~Result() {
     delete this->stop_lock;
@@ -28,4 +29,33 @@ Result::stop() {
     CPPUNIT_NS::TestResult::m_stop = true;
 }
 
+void
+Result::setFailureLog(FailureLog* failure_log_in) {
+    this->failure_log = failure_log_in;
+}
+
+void
+Result::addError(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e) {
+    if (this->failure_log) {
+        const CPPUNIT_NS::TestFailure* failure = this->failure_log->add(test, e, true);
+        if (failure) {
+            CPPUNIT_NS::TestResult::addFailure(*failure);
+        }
+    } else {
+        CPPUNIT_NS::TestResult::addError(test, e);
+    }
+}
+
+void
+Result::addFailure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e) {
+    if (this->failure_log) {
+        const CPPUNIT_NS::TestFailure* failure = this->failure_log->add(test, e, false);
+        if (failure) {
+            CPPUNIT_NS::TestResult::addFailure(*failure);
+        }
+    } else {
+        CPPUNIT_NS::TestResult::addFailure(test, e);
+    }
+}
+
 CUTEST_NS_END
@@ -5,6 +5,8 @@
 
 #include "cutest/Define.h"
 
+#include "FailureLog.h"
+
 CUTEST_NS_BEGIN
 
 class GTEST_API_ Result : public CPPUNIT_NS::TestResult {
@@ -17,8 +19,17 @@ public:
     virtual void stop();
     virtual bool shouldStop() const;
 
+    // 设置之后，addError()、addFailure()把失败记录到failure_log中，通知TestListener的也是这条记录，不再另外复制；
+    // 超出保留上限而省略的失败不通知TestListener，见FailureLog::add()
+    void setFailureLog(FailureLog* failure_log);
+
+    // 重载CPPUNIT_NS::TestResult的方法，exception的所有权交给failure_log
+    virtual void addError(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e);
+    virtual void addFailure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* e);
+
 protected:
     CPPUNIT_NS::SynchronizedObject::SynchronizationObject* stop_lock;
+    FailureLog* failure_log;
 
 private:
     Result(const Result& other);
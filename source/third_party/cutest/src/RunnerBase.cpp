@@ -3,26 +3,106 @@
 #include "cutest/ExplicitEndTest.h"
 #include "cutest/Runnable.h"
 
+#include <cppunit/TestSuite.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
 #include "gtest/gtest-message.h"
 
+#include "TestList.h"
+#include "Thread.h"
+
 CUTEST_NS_BEGIN
 
+// delayRunOnMainThread()投递的任务
+class DelayTask : public TimerWheel::Timer {
+public:
+    DelayTask(Runnable* runnable_in, bool is_auto_delete_in)
+        : runnable(runnable_in)
+        , is_auto_delete(is_auto_delete_in) {}
+
+    virtual void run() {
+        this->runnable->run();
+        discard();
+    }
+
+    virtual void discard() {
+        if (this->is_auto_delete) {
+            delete this->runnable;
+        }
+        delete this;
+    }
+
+protected:
+    Runnable* runnable;
+    bool is_auto_delete;
+};
+
 RunnerBase::RunnerBase()
     : test_decorator(NULL)
+    , parallel_executor(NULL)
+    , parallel_worker_count(0)
+    , isolated_executor(NULL)
+    , process_isolation(false)
+    , failure_retention(0)
+    , registry_lock(Thread::createLock())
+    , timer_wheel(Thread::createLock())
     , runing_test(NULL)
     , always_call_test_on_main_thread(false)
     , treat_timeout_as_error(false)
     , state(STATE_NONE) {
     addListener(this);
+    this->duration_history.setTestIndex(&this->test_index);
+    this->timer_wheel.setAlarm(this);
+    this->auto_end_test.setTimerWheel(&this->timer_wheel);
+    CPPUNIT_NS::TestFactoryRegistry::setSynchronizationObject(this->registry_lock);
 }
 
 RunnerBase::~RunnerBase() {
+    // 派生类已经析构，之后不能再调用arm()
+    this->timer_wheel.setAlarm(NULL);
+
     stop();
+    destroyDecorator();
+
+    CPPUNIT_NS::TestSuite::setSelectionHook(NULL);
+    CPPUNIT_NS::TestFactoryRegistry::setSynchronizationObject(NULL);
+    delete this->registry_lock;
+}
+
+void
+RunnerBase::destroyDecorator() {
+    this->listener_manager.setFailureLog(NULL);
 
     if (this->test_decorator) {
         this->test_decorator->destroy();
         this->test_decorator = NULL;
     }
+
+    // 要在test_decorator之后销毁，test_decorator销毁时会等待工作线程结束
+    if (this->parallel_executor) {
+        delete this->parallel_executor;
+        this->parallel_executor = NULL;
+    }
+
+    if (this->isolated_executor) {
+        delete this->isolated_executor;
+        this->isolated_executor = NULL;
+    }
+}
+
+IsolatedExecutor*
+RunnerBase::createIsolatedExecutor(CPPUNIT_NS::Test* test) {
+    return NULL;
+}
+
+FILE*
+RunnerBase::openEventStream(const char* target) {
+    return ::fopen(target, "w");
+}
+
+void
+RunnerBase::delayRunOnMainThread(unsigned int delay_ms, Runnable* runnable, bool is_auto_delete) {
+    this->timer_wheel.schedule(new DelayTask(runnable, is_auto_delete), CUTEST_NS::tickCount64() + delay_ms);
 }
 
 void
@@ -45,6 +125,124 @@ RunnerBase::treatTimeoutAsError() {
     return this->treat_timeout_as_error;
 }
 
+void
+RunnerBase::setParallelWorkerCount(unsigned int count) {
+    this->parallel_worker_count = count;
+}
+
+unsigned int
+RunnerBase::parallelWorkerCount() {
+    return this->parallel_worker_count;
+}
+
+void
+RunnerBase::setDurationHistoryFile(const char* path) {
+    this->duration_history.setFile(path);
+
+    if (this->duration_history.isEnabled()) {
+        addListener(&this->duration_history);
+    } else {
+        removeListener(&this->duration_history);
+    }
+}
+
+void
+RunnerBase::setProcessIsolation(bool value) {
+    this->process_isolation = value;
+}
+
+bool
+RunnerBase::processIsolation() {
+    return this->process_isolation;
+}
+
+void
+RunnerBase::setAsyncProgressDispatch(bool value) {
+    this->listener_manager.setAsyncDispatch(value);
+}
+
+bool
+RunnerBase::asyncProgressDispatch() {
+    return this->listener_manager.asyncDispatch();
+}
+
+void
+RunnerBase::setPerformanceBaseline(const char* baseline_path, const char* output_path, unsigned int threshold_percent) {
+    this->regression_gate.setFiles(baseline_path, output_path, threshold_percent);
+
+    if (this->regression_gate.isEnabled()) {
+        addListener(&this->regression_gate);
+    } else {
+        removeListener(&this->regression_gate);
+    }
+    this->listener_manager.setRegressionGate(this->regression_gate.hasBaseline() ? &this->regression_gate : NULL);
+}
+
+const RegressionGate*
+RunnerBase::regressionGate() const {
+    return &this->regression_gate;
+}
+
+void
+RunnerBase::setEventStream(const char* target) {
+    FILE* file = NULL;
+    if (target && *target) {
+        file = openEventStream(target);
+        if (!file) {
+            ::fprintf(stderr, "Unable to open the event stream \"%s\"\n", target);
+        }
+    }
+    this->event_stream.setFile(file);
+
+    if (this->event_stream.isEnabled()) {
+        addListener(&this->event_stream);
+    } else {
+        removeListener(&this->event_stream);
+    }
+}
+
+void
+RunnerBase::setSharding(unsigned int total_shards, unsigned int shard_index, bool balance_by_duration) {
+    this->test_shard.setup(total_shards, shard_index, balance_by_duration ? &this->duration_history : NULL);
+    this->duration_history.setReadOnly(this->test_shard.isEnabled());
+
+    // 不分片时不安装钩子，构造用例树时只经过--gtest_filter的筛选
+    CPPUNIT_NS::TestSuite::setSelectionHook(this->test_shard.isEnabled() ? &RunnerBase::selectTest : NULL);
+}
+
+bool
+RunnerBase::selectTest(const char* suite_name, const char* test_name) {
+    return static_cast<RunnerBase*>(Runner::instance())->test_shard.select(suite_name, test_name);
+}
+
+void
+RunnerBase::setFailureRetention(unsigned int max_per_test) {
+    this->failure_retention = max_per_test;
+}
+
+unsigned int
+RunnerBase::failureRetention() {
+    return this->failure_retention;
+}
+
+bool
+RunnerBase::listTests(const char* output) {
+    TestList list;
+    list.collect(&CPPUNIT_NS::TestFactoryRegistry::getRegistry());
+
+    if (!output || !*output) {
+        return list.write(stdout, this->always_call_test_on_main_thread);
+    }
+
+    FILE* file = ::fopen(output, "w");
+    if (!file) {
+        ::fprintf(stderr, "Unable to open \"%s\" to list the tests\n", output);
+        return false;
+    }
+    bool written = list.write(file, this->always_call_test_on_main_thread);
+    return (0 == ::fclose(file)) && written;
+}
+
 void
 RunnerBase::addListener(ProgressListener* listener) {
     this->listener_manager.add(listener);
@@ -69,13 +267,34 @@ RunnerBase::start(CPPUNIT_NS::Test* test) {
         return;
     }
 
-    if (this->test_decorator) {
-        this->test_decorator->destroy();
-        this->test_decorator = NULL;
+    destroyDecorator();
+    this->test_index.build(test);
+    this->test_shard.reset();
+
+    if (this->process_isolation) {
+        this->isolated_executor = createIsolatedExecutor(test);
+    }
+
+    if (this->isolated_executor) {
+        test = this->isolated_executor;
+    } else if (this->parallel_worker_count > 1) {
+        this->parallel_executor = new ParallelExecutor(
+            test,
+            this->parallel_worker_count,
+            &this->listener_manager,
+            this->duration_history.isEnabled() ? &this->duration_history : NULL,
+            &this->regression_gate);
+
+        test = this->parallel_executor;
     }
 
     this->test_decorator = Decorator::createInstance(test);
+    this->test_decorator->failureLog()->setRetention(this->failure_retention);
+    this->listener_manager.setFailureLog(this->test_decorator->failureLog());
     this->test_decorator->addListener(&this->listener_manager);
+    if (this->regression_gate.hasBaseline()) {
+        this->test_decorator->pushProtector(this->regression_gate.createTimer());
+    }
     this->test_decorator->start();
 }
 
@@ -105,6 +324,14 @@ RunnerBase::stop() {
 
 void
 RunnerBase::addFailure(bool is_error, CPPUNIT_NS::Exception* exception) {
+    if (this->isolated_executor && this->isolated_executor->addFailure(is_error, exception)) {
+        return;
+    }
+
+    if (this->parallel_executor && this->parallel_executor->addFailure(is_error, exception)) {
+        return;
+    }
+
     if (this->test_decorator) {
         this->test_decorator->addFailure(is_error, exception);
     }
@@ -113,8 +340,7 @@ RunnerBase::addFailure(bool is_error, CPPUNIT_NS::Exception* exception) {
 unsigned int
 RunnerBase::errorCount() const {
     if (this->test_decorator) {
-        const CPPUNIT_NS::TestResultCollector* collector = this->test_decorator->testResultCollector();
-        return (unsigned int)collector->testErrors();
+        return this->test_decorator->failureLog()->errorCount();
     }
     return 0;
 }
@@ -122,8 +348,7 @@ RunnerBase::errorCount() const {
 unsigned int
 RunnerBase::failureCount() const {
     if (this->test_decorator) {
-        const CPPUNIT_NS::TestResultCollector* collector = this->test_decorator->testResultCollector();
-        return (unsigned int)collector->testFailures();
+        return this->test_decorator->failureLog()->failureCount();
     }
     return 0;
 }
@@ -131,8 +356,7 @@ RunnerBase::failureCount() const {
 unsigned int
 RunnerBase::totalFailureCount() const {
     if (this->test_decorator) {
-        const CPPUNIT_NS::TestResultCollector* collector = this->test_decorator->testResultCollector();
-        return (unsigned int)collector->testFailuresTotal();
+        return this->test_decorator->failureLog()->totalCount();
     }
     return 0;
 }
@@ -140,14 +364,16 @@ RunnerBase::totalFailureCount() const {
 const CPPUNIT_NS::TestFailure*
 RunnerBase::failureAt(unsigned int index) const {
     if (this->test_decorator) {
-        const CPPUNIT_NS::TestResultCollector* collector = this->test_decorator->testResultCollector();
-        if (index < collector->failures().size()) {
-            return collector->failures()[index];
-        }
+        return this->test_decorator->failureLog()->at(index);
     }
     return NULL;
 }
 
+unsigned int
+RunnerBase::countTestCases(CPPUNIT_NS::Test* test) const {
+    return this->test_index.countTestCases(test);
+}
+
 void
 RunnerBase::registerExplicitEndTest(ExplicitEndTest* test, unsigned int timeout_ms) {
     this->runing_test = test;
@@ -5,7 +5,15 @@
 
 #include "AutoEndTest.h"
 #include "Decorator.h"
+#include "DurationHistory.h"
+#include "EventStream.h"
+#include "IsolatedExecutor.h"
+#include "ParallelExecutor.h"
 #include "ProgressListenerManager.h"
+#include "RegressionGate.h"
+#include "TestIndex.h"
+#include "TestShard.h"
+#include "TimerWheel.h"
 
 CUTEST_NS_BEGIN
 
@@ -14,7 +22,8 @@ class ExplicitEndTest;
 class RunnerBase
     : public Runner
     , public ProgressListener
-    , public Runnable {
+    , public Runnable
+    , public TimerWheel::Alarm {
     friend thread_id CUTEST_NS::mainThreadId();
 
 public:
@@ -22,12 +31,40 @@ public:
     virtual ~RunnerBase();
 
 public:
+    // 延迟任务统一由timer_wheel管理，平台相关的RunnerImpl只需要实现TimerWheel::Alarm
+    virtual void delayRunOnMainThread(unsigned int delay_ms, Runnable* runnable, bool is_auto_delete) override;
+
     virtual void setAlwaysCallTestOnMainThread(bool value) override;
     virtual bool alwaysCallTestOnMainThread() override;
 
     virtual void setTreatTimeoutAsError(bool value) override;
     virtual bool treatTimeoutAsError() override;
 
+    virtual void setParallelWorkerCount(unsigned int count) override;
+    virtual unsigned int parallelWorkerCount() override;
+
+    virtual void setDurationHistoryFile(const char* path) override;
+
+    virtual void setProcessIsolation(bool value) override;
+    virtual bool processIsolation() override;
+
+    virtual void setAsyncProgressDispatch(bool value) override;
+    virtual bool asyncProgressDispatch() override;
+
+    virtual void setPerformanceBaseline(const char* baseline_path, const char* output_path, unsigned int threshold_percent) override;
+
+    // 进程隔离时，子进程要在自己的TestResult上安装基线比较
+    const RegressionGate* regressionGate() const;
+
+    virtual void setEventStream(const char* target) override;
+
+    virtual void setSharding(unsigned int total_shards, unsigned int shard_index, bool balance_by_duration) override;
+
+    virtual void setFailureRetention(unsigned int max_per_test) override;
+    virtual unsigned int failureRetention() override;
+
+    virtual bool listTests(const char* output) override;
+
 public: // Runner接口族的实现
     virtual void addListener(ProgressListener* listener) override;
     virtual void removeListener(ProgressListener* listener) override;
@@ -45,15 +82,41 @@ public:
     virtual unsigned int failureCount() const override;
     virtual unsigned int totalFailureCount() const override;
     virtual const CPPUNIT_NS::TestFailure* failureAt(unsigned int index) const override;
+    virtual unsigned int countTestCases(CPPUNIT_NS::Test* test) const override;
 
 protected:
     Decorator* test_decorator;
+    TestIndex test_index; // start()时建立，见Runner::countTestCases()
+    ParallelExecutor* parallel_executor; // 只有并行执行时才会创建，被test_decorator包装
+    unsigned int parallel_worker_count;
+    DurationHistory duration_history;
+    TestShard test_shard;
+    RegressionGate regression_gate;
+    EventStream event_stream;
+    IsolatedExecutor* isolated_executor; // 只有进程隔离时才会创建，被test_decorator包装
+    bool process_isolation;
+    unsigned int failure_retention;
+
+    // 安装给TestFactoryRegistry的锁，工作线程上也可以查找、注册TestFactoryRegistry
+    CPPUNIT_NS::SynchronizedObject::SynchronizationObject* registry_lock;
+
+    void destroyDecorator();
+
+    // 分片时安装给TestSuite的选择钩子，把用例分给一个分片，返回它是否属于本分片
+    static bool selectTest(const char* suite_name, const char* test_name);
+
+    // 创建进程隔离执行器，平台不支持时返回NULL，用例仍然在当前进程中执行
+    virtual IsolatedExecutor* createIsolatedExecutor(CPPUNIT_NS::Test* test);
+
+    // 打开setEventStream()指定的target，默认只支持文件和命名管道，失败时返回NULL
+    virtual FILE* openEventStream(const char* target);
 
 public: // ExplicitEndTest相关的方法
     virtual void registerExplicitEndTest(ExplicitEndTest* test, unsigned int timeout_ms) override;
     virtual void unregisterExplicitEndTest(ExplicitEndTest* test) override;
 
 protected:
+    TimerWheel timer_wheel;
     ExplicitEndTest* runing_test;
     AutoEndTest auto_end_test;
     bool always_call_test_on_main_thread;
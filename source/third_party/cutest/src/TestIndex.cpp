@@ -0,0 +1,123 @@
+﻿#include "TestIndex.h"
+
+#include <algorithm>
+
+CUTEST_NS_BEGIN
+
+namespace {
+
+struct EntryLess {
+    bool operator()(const std::pair<const CPPUNIT_NS::Test*, int>& left, const CPPUNIT_NS::Test* right) const {
+        return left.first < right;
+    }
+};
+
+} // namespace
+
+TestIndex::TestIndex() {}
+
+void
+TestIndex::clear() {
+    this->tests.clear();
+    this->names.clear();
+    this->parents.clear();
+    this->ends.clear();
+    this->test_counts.clear();
+    this->entries.clear();
+}
+
+void
+TestIndex::build(CPPUNIT_NS::Test* root) {
+    clear();
+    if (!root) {
+        return;
+    }
+
+    // 用显式的栈做先序遍历，子节点逆序入栈，保证出栈的顺序和原来的顺序相同
+    typedef std::pair<CPPUNIT_NS::Test*, int> Pending; // 节点和父节点的id
+    CppUnitVector<Pending> pending;
+    pending.push_back(Pending(root, NOT_FOUND));
+    while (!pending.empty()) {
+        Pending current = pending.back();
+        pending.pop_back();
+
+        CPPUNIT_NS::Test* test = current.first;
+        int child_count = test->getChildTestCount();
+
+        this->tests.push_back(test);
+        this->names.push_back(test->getName());
+        this->parents.push_back(current.second);
+        this->ends.push_back(this->size());
+        // 叶子节点的用例数由它自己决定（比如RepeatedTest），Suite的用例数之后由子节点累加
+        this->test_counts.push_back(child_count ? 0 : test->countTestCases());
+
+        int id = this->size() - 1;
+        for (int index = child_count - 1; index >= 0; --index) {
+            pending.push_back(Pending(test->getChildTestAt(index), id));
+        }
+    }
+
+    // 子节点的id总是比父节点大，逆序遍历一次就能把范围和用例数累加到父节点上
+    for (int id = this->size() - 1; id > 0; --id) {
+        int parent = this->parents[id];
+        this->ends[parent] = std::max(this->ends[parent], this->ends[id]);
+        this->test_counts[parent] += this->test_counts[id];
+    }
+
+    this->entries.reserve(this->tests.size());
+    for (int id = 0; id < this->size(); ++id) {
+        this->entries.push_back(Entry(this->tests[id], id));
+    }
+    std::sort(this->entries.begin(), this->entries.end());
+}
+
+int
+TestIndex::size() const {
+    return (int)this->tests.size();
+}
+
+int
+TestIndex::find(const CPPUNIT_NS::Test* test) const {
+    CppUnitVector<Entry>::const_iterator it =
+        std::lower_bound(this->entries.begin(), this->entries.end(), test, EntryLess());
+    if (it == this->entries.end() || it->first != test) {
+        return NOT_FOUND;
+    }
+    return it->second;
+}
+
+CPPUNIT_NS::Test*
+TestIndex::test(int id) const {
+    return this->tests[id];
+}
+
+const std::string&
+TestIndex::name(int id) const {
+    return this->names[id];
+}
+
+int
+TestIndex::parent(int id) const {
+    return this->parents[id];
+}
+
+int
+TestIndex::end(int id) const {
+    return this->ends[id];
+}
+
+unsigned int
+TestIndex::testCount(int id) const {
+    return this->test_counts[id];
+}
+
+unsigned int
+TestIndex::countTestCases(CPPUNIT_NS::Test* test) const {
+    int id = find(test);
+    if (NOT_FOUND == id) {
+        return (unsigned int)test->countTestCases();
+    }
+    return this->test_counts[id];
+}
+
+CUTEST_NS_END
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <cppunit/Test.h>
+#include <cppunit/portability/CppUnitVector.h>
+
+#include "cutest/Define.h"
+
+#include <string>
+#include <utility>
+
+CUTEST_NS_BEGIN
+
+/*
+    用例树的扁平索引，Runner::start()时建立，执行期间用例树不再变化：
+    - 按先序遍历把每个节点（Suite或用例）依次存到连续的数组中，节点的id就是它的下标，
+      节点的所有子孙紧跟在它后面，即[id + 1, end(id))；
+    - 每个节点的名字、父节点、用例数都预先算好，查询时不再递归遍历用例树，也不调用Test的虚函数；
+    - 通过Test*查找id是在按地址排序的数组上二分查找。
+    只能在build()之后读取，build()不是线程安全的。
+*/
+class TestIndex {
+public:
+    enum { NOT_FOUND = -1 };
+
+    TestIndex();
+
+    void build(CPPUNIT_NS::Test* root);
+    void clear();
+
+    int size() const;
+
+    // test不在索引中时返回NOT_FOUND
+    int find(const CPPUNIT_NS::Test* test) const;
+
+    CPPUNIT_NS::Test* test(int id) const;
+    const std::string& name(int id) const;
+    int parent(int id) const; // 根节点返回NOT_FOUND
+    int end(int id) const;
+    unsigned int testCount(int id) const;
+
+    bool isLeaf(int id) const {
+        return end(id) == id + 1;
+    }
+
+    // 等价于test->countTestCases()，只有test不在索引中时才会遍历它的子树
+    unsigned int countTestCases(CPPUNIT_NS::Test* test) const;
+
+protected:
+    CppUnitVector<CPPUNIT_NS::Test*> tests;
+    CppUnitVector<std::string> names;
+    CppUnitVector<int> parents;
+    CppUnitVector<int> ends;
+    CppUnitVector<unsigned int> test_counts;
+
+    typedef std::pair<const CPPUNIT_NS::Test*, int> Entry;
+    CppUnitVector<Entry> entries; // 按Test*排序，用于find()
+};
+
+CUTEST_NS_END
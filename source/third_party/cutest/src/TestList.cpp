@@ -0,0 +1,69 @@
+﻿#include "TestList.h"
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include "src/gtest-internal-inl.h"
+
+#include "EventStream.h"
+
+CUTEST_NS_BEGIN
+
+TestList::TestList()
+    : unlisted_count(0) {
+}
+
+void
+TestList::collect(CPPUNIT_NS::TestFactoryRegistry* registry) {
+    if (!this->visited.insert(registry).second) {
+        return;
+    }
+
+    CppUnitVector<CPPUNIT_NS::TestFactory*> factories;
+    registry->getFactories(factories);
+    for (size_t index = 0; index < factories.size(); ++index) {
+        CPPUNIT_NS::TestFactoryRegistry* child = dynamic_cast<CPPUNIT_NS::TestFactoryRegistry*>(factories[index]);
+        if (child) {
+            collect(child);
+            continue;
+        }
+
+        const CPPUNIT_NS::TestMetadata* metadata = factories[index]->metadata();
+        if (NULL == metadata) {
+            ++this->unlisted_count;
+        } else if (testing::internal::UnitTestOptions::FilterMatchesTest(metadata->suiteName, metadata->testName)) {
+            this->tests.push_back(metadata);
+        }
+    }
+}
+
+bool
+TestList::write(FILE* file, bool always_on_main_thread) const {
+    // 每个用例一行，方便直接用grep等工具处理
+    std::string text = "{\"tests\":[";
+    for (size_t index = 0; index < this->tests.size(); ++index) {
+        const CPPUNIT_NS::TestMetadata* metadata = this->tests[index];
+        std::string name = std::string(metadata->suiteName) + "." + metadata->testName;
+
+        char numbers[64];
+        text += (0 == index) ? "\n{\"name\":" : ",\n{\"name\":";
+        appendJsonString(text, name.c_str());
+        text += ",\"suite\":";
+        appendJsonString(text, metadata->suiteName);
+        text += ",\"test\":";
+        appendJsonString(text, metadata->testName);
+        text += ",\"file\":";
+        appendJsonString(text, metadata->fileName ? metadata->fileName : "");
+        ::sprintf(numbers, ",\"line\":%d,\"timeout_ms\":%u", metadata->lineNumber, metadata->timeoutMs);
+        text += numbers;
+        text += ",\"thread\":";
+        text += (always_on_main_thread || metadata->mainThread) ? "\"main\"}" : "\"any\"}";
+    }
+
+    char footer[64];
+    ::sprintf(footer, "\n],\"unlisted\":%u}\n", this->unlisted_count);
+    text += footer;
+
+    return text.size() == ::fwrite(text.data(), 1, text.size(), file) && 0 == ::fflush(file);
+}
+
+CUTEST_NS_END
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cppunit/extensions/TestFactory.h>
+#include <cppunit/portability/CppUnitVector.h>
+
+#include "cutest/Define.h"
+
+#include <stdio.h>
+#include <set>
+#include <string>
+
+CPPUNIT_NS_BEGIN
+class TestFactoryRegistry;
+CPPUNIT_NS_END
+
+CUTEST_NS_BEGIN
+
+/*
+    列出用例，见Runner::listTests()：
+    - 只遍历TestFactoryRegistry和TestFactory::metadata()，不调用makeTest()，所以不会构造用例和fixture；
+    - 同一个registry可能注册在多处（比如同时在根registry和命名registry中），只列出一次；
+    - 没有TestMetadata的TestFactory（比如cppunit的TestSuiteFactory）只有构造之后才知道其中的用例，只计数；
+    - 和gtest的--gtest_list_tests一样不考虑分片：分片按构造用例树的顺序分配，没有列出的用例也会占用分片，
+      不构造就无法得到和执行时一致的结果。
+*/
+class TestList {
+public:
+    TestList();
+
+    // 收集registry下通过--gtest_filter的用例
+    void collect(CPPUNIT_NS::TestFactoryRegistry* registry);
+
+    // 以JSON写到file，always_on_main_thread为true时所有用例都在主线程执行
+    bool write(FILE* file, bool always_on_main_thread) const;
+
+protected:
+    std::set<CPPUNIT_NS::TestFactoryRegistry*> visited;
+    CppUnitVector<const CPPUNIT_NS::TestMetadata*> tests; // 注册顺序
+    unsigned int unlisted_count; // 没有TestMetadata的TestFactory数
+};
+
+CUTEST_NS_END
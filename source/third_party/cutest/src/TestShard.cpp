@@ -0,0 +1,50 @@
+﻿#include "TestShard.h"
+
+CUTEST_NS_BEGIN
+
+TestShard::TestShard()
+    : total(0)
+    , index(0)
+    , history(NULL) {}
+
+void
+TestShard::setup(unsigned int total_in, unsigned int index_in, const DurationHistory* history_in) {
+    this->total = total_in > 1 ? total_in : 0;
+    this->index = index_in;
+    this->history = (history_in && history_in->isEnabled()) ? history_in : NULL;
+    reset();
+}
+
+bool
+TestShard::isEnabled() const {
+    return this->total > 1;
+}
+
+void
+TestShard::reset() {
+    this->loads.assign(this->total, 0);
+}
+
+bool
+TestShard::select(const char* suite_name, const char* test_name) {
+    if (!isEnabled()) {
+        return true;
+    }
+
+    unsigned int target = 0;
+    for (unsigned int i = 1; i < this->total; ++i) {
+        if (this->loads[i] < this->loads[target]) {
+            target = i;
+        }
+    }
+
+    unsigned long long load = 1;
+    if (this->history) {
+        std::string name = suite_name ? std::string(suite_name) + "." + test_name : std::string(test_name);
+        load += this->history->estimateLeaf(name);
+    }
+    this->loads[target] += load;
+    return target == this->index;
+}
+
+CUTEST_NS_END
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <cppunit/portability/CppUnitVector.h>
+
+#include "cutest/Define.h"
+
+#include "DurationHistory.h"
+
+#include <string>
+
+CUTEST_NS_BEGIN
+
+/*
+    分片执行，见Runner::setSharding()：
+    - 构造用例树时，按select()的调用顺序把用例逐个分给当前负载最小的分片，负载相同时分给序号小的；
+    - 按耗时分配时，用例的负载为历史耗时(ms) + 1，加1是为了让耗时不到1ms的用例也能均匀分开；
+      否则每个用例的负载都为1，结果就是轮流分配（round-robin）；
+    - 每个分片都用同样的用例顺序和历史记录做同样的计算，所以结果是确定的，每个用例恰好属于一个分片。
+*/
+class TestShard {
+public:
+    TestShard();
+
+    // total为0或1时不分片；history为NULL或者没有启用时轮流分配
+    void setup(unsigned int total, unsigned int index, const DurationHistory* history);
+    bool isEnabled() const;
+
+    // 清空已经分配的负载，重新构造用例树之前调用
+    void reset();
+
+    /*
+        把用例分给一个分片，返回它是否属于本分片；不分片时总是返回true
+        @param suite_name 用例所在的TestCase名，为NULL时test_name是完整的用例名
+        @param test_name 用例名
+        只有按耗时分配时才需要拼出完整的用例名来查找历史记录，轮流分配时不分配内存。
+    */
+    bool select(const char* suite_name, const char* test_name);
+
+protected:
+    unsigned int total;
+    unsigned int index;
+    const DurationHistory* history;
+    CppUnitVector<unsigned long long> loads; // 每个分片已经分配的负载
+};
+
+CUTEST_NS_END
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <cppunit/SynchronizedObject.h>
+
+#include "cutest/Runnable.h"
+
+CUTEST_NS_BEGIN
+
+/*
+    跨平台的线程封装，供并行执行用例等跨平台代码使用，
+    各平台的实现见win/ThreadImpl.cpp、android/ThreadImpl.cpp和linux/ThreadImpl.cpp
+*/
+class Thread {
+public:
+    // 工厂方法，创建之后新线程立即开始执行runnable->run()
+    static Thread* createInstance(Runnable* runnable);
+
+    // 创建平台相关的锁对象，调用者负责delete
+    static CPPUNIT_NS::SynchronizedObject::SynchronizationObject* createLock();
+
+    /*
+        原子操作，供AtomicLong使用：
+        - atomicLoad()是acquire语义，atomicStore()是release语义，都不加锁；
+        - atomicExchange()和atomicCompareExchange()带有完整的内存屏障
+    */
+    static long atomicLoad(const volatile long* value);
+    static void atomicStore(volatile long* value, long new_value);
+    // 把*value改为new_value，返回*value原来的值
+    static long atomicExchange(volatile long* value, long new_value);
+    // *value等于expected时改为desired，返回*value原来的值
+    static long atomicCompareExchange(volatile long* value, long expected, long desired);
+
+protected:
+    // 外部要通过destroy()来销毁Thread对象
+    virtual ~Thread() {}
+
+public:
+    // 等待线程结束，只能调用一次
+    virtual void join() = 0;
+
+    // 销毁Thread对象，如果还没有join()，会先等待线程结束
+    virtual void destroy() = 0;
+};
+
+/*
+    long类型的原子变量，只能通过下面的方法访问，供ProgressListenerManager等无锁的数据结构使用；
+    内存序见Thread::atomicLoad()等方法
+*/
+class AtomicLong {
+public:
+    explicit AtomicLong(long initial = 0)
+        : value(initial) {}
+
+    long load() const {
+        return Thread::atomicLoad(&this->value);
+    }
+
+    void store(long new_value) {
+        Thread::atomicStore(&this->value, new_value);
+    }
+
+    long exchange(long new_value) {
+        return Thread::atomicExchange(&this->value, new_value);
+    }
+
+    long compareExchange(long expected, long desired) {
+        return Thread::atomicCompareExchange(&this->value, expected, desired);
+    }
+
+private:
+    volatile long value;
+
+    AtomicLong(const AtomicLong& other);
+    AtomicLong& operator=(const AtomicLong& other);
+};
+
+CUTEST_NS_END
@@ -0,0 +1,243 @@
+﻿#include "TimerWheel.h"
+
+#include "cutest/Helper.h"
+
+#include <string.h>
+
+CUTEST_NS_BEGIN
+
+TimerWheel::TimerWheel(CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock)
+    : CPPUNIT_NS::SynchronizedObject(lock)
+    , current_ms(0)
+    , count(0)
+    , armed_ms(0)
+    , alarm(NULL) {
+    ::memset(this->level0, 0, sizeof(this->level0));
+    ::memset(this->levels, 0, sizeof(this->levels));
+}
+
+TimerWheel::~TimerWheel() {
+    CppUnitVector<Timer*> timers;
+    takeAll(timers);
+
+    for (size_t i = 0; i < timers.size(); ++i) {
+        timers[i]->discard();
+    }
+}
+
+void
+TimerWheel::setAlarm(Alarm* alarm_in) {
+    ExclusiveZone zone(m_syncObject);
+    this->alarm = alarm_in;
+}
+
+void
+TimerWheel::schedule(Timer* timer, unsigned long long due_ms) {
+    ExclusiveZone zone(m_syncObject);
+
+    if (timer->slot) {
+        unlink(timer);
+        --this->count;
+    }
+
+    // 时间轮空着的时候没有推进，从当前时刻重新开始，免得expire()从很久以前逐ms追上来
+    if (0 == this->count) {
+        this->current_ms = CUTEST_NS::tickCount64();
+    }
+
+    timer->due_ms = due_ms;
+    place(timer);
+    ++this->count;
+
+    unsigned long long due = due_ms > this->current_ms ? due_ms : this->current_ms;
+    if (this->alarm && (0 == this->armed_ms || due < this->armed_ms)) {
+        this->armed_ms = due;
+        this->alarm->arm(due);
+    }
+}
+
+bool
+TimerWheel::cancel(Timer* timer) {
+    ExclusiveZone zone(m_syncObject);
+
+    // Alarm不用重新设置，到时多调用一次expire()而已
+    if (!timer->slot) {
+        return false;
+    }
+    unlink(timer);
+    --this->count;
+    return true;
+}
+
+void
+TimerWheel::expire(unsigned long long now_ms) {
+    CppUnitVector<Timer*> expired;
+
+    {
+        ExclusiveZone zone(m_syncObject);
+
+        while (this->count && this->current_ms <= now_ms) {
+            unsigned int index = (unsigned int)(this->current_ms & (LEVEL0_SIZE - 1));
+
+            // 第0层转完一圈，把上一层对应槽中的Timer分散下来，上一层也转完一圈时再继续往上
+            if (0 == index) {
+                for (unsigned int level = 0; level < LEVELS - 1; ++level) {
+                    if (0 != cascade(level)) {
+                        break;
+                    }
+                }
+            }
+
+            while (this->level0[index]) {
+                Timer* timer = this->level0[index];
+                unlink(timer);
+                --this->count;
+                expired.push_back(timer);
+            }
+            ++this->current_ms;
+        }
+
+        this->armed_ms = 0;
+        if (this->count && this->alarm) {
+            this->armed_ms = nextDue();
+            this->alarm->arm(this->armed_ms);
+        }
+    }
+
+    // 在锁外执行，Timer::run()里面可能会再次调用schedule()
+    for (size_t i = 0; i < expired.size(); ++i) {
+        expired[i]->run();
+    }
+}
+
+void
+TimerWheel::resetAfterFork(CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock) {
+    m_syncObject = lock;
+
+    CppUnitVector<Timer*> timers;
+    takeAll(timers);
+    this->armed_ms = 0;
+}
+
+void
+TimerWheel::place(Timer* timer) {
+    unsigned long long due = timer->due_ms > this->current_ms ? timer->due_ms : this->current_ms;
+    unsigned long long delta = due - this->current_ms;
+
+    if (delta < LEVEL0_SIZE) {
+        link(&this->level0[due & (LEVEL0_SIZE - 1)], timer);
+        return;
+    }
+
+    // 超出时间轮范围的，先放在最高层最远的槽中，转到时再按剩余的时长重新放置
+    if (delta >= (1ULL << SPAN_BITS)) {
+        delta = (1ULL << SPAN_BITS) - 1;
+        due = this->current_ms + delta;
+    }
+
+    unsigned int level = 0;
+    unsigned int shift = LEVEL0_BITS;
+    while (delta >= (1ULL << (shift + LEVEL_BITS))) {
+        ++level;
+        shift += LEVEL_BITS;
+    }
+    link(&this->levels[level][(due >> shift) & (LEVEL_SIZE - 1)], timer);
+}
+
+void
+TimerWheel::link(Timer** slot, Timer* timer) {
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot) {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+}
+
+void
+TimerWheel::unlink(Timer* timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        *timer->slot = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+
+    timer->slot = NULL;
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+unsigned int
+TimerWheel::cascade(unsigned int level) {
+    unsigned int shift = LEVEL0_BITS + LEVEL_BITS * level;
+    unsigned int index = (unsigned int)((this->current_ms >> shift) & (LEVEL_SIZE - 1));
+
+    Timer* timer = this->levels[level][index];
+    this->levels[level][index] = NULL;
+    while (timer) {
+        Timer* next = timer->next;
+        place(timer);
+        timer = next;
+    }
+    return index;
+}
+
+unsigned long long
+TimerWheel::nextDue() const {
+    unsigned long long due = (unsigned long long)-1;
+
+    // 第0层的槽对应确定的时刻
+    for (unsigned int i = 0; i < LEVEL0_SIZE; ++i) {
+        if (this->level0[(this->current_ms + i) & (LEVEL0_SIZE - 1)]) {
+            due = this->current_ms + i;
+            break;
+        }
+    }
+
+    /*
+        上层的槽只知道什么时候分散到下层：第level层的槽在时刻为2^shift的整数倍时分散，
+        current_ms恰好是整数倍时，它所在的槽还没有分散，也要算上
+    */
+    unsigned int shift = LEVEL0_BITS;
+    for (unsigned int level = 0; level < LEVELS - 1; ++level) {
+        unsigned long long block = this->current_ms >> shift;
+        unsigned int first = (this->current_ms & ((1ULL << shift) - 1)) ? 1 : 0;
+        for (unsigned int i = first; i < first + LEVEL_SIZE; ++i) {
+            if (this->levels[level][(block + i) & (LEVEL_SIZE - 1)]) {
+                unsigned long long cascade_ms = (block + i) << shift;
+                if (cascade_ms < due) {
+                    due = cascade_ms;
+                }
+                break;
+            }
+        }
+        shift += LEVEL_BITS;
+    }
+    return due;
+}
+
+void
+TimerWheel::takeAll(CppUnitVector<Timer*>& timers) {
+    for (unsigned int index = 0; index < LEVEL0_SIZE; ++index) {
+        while (this->level0[index]) {
+            timers.push_back(this->level0[index]);
+            unlink(this->level0[index]);
+        }
+    }
+
+    for (unsigned int level = 0; level < LEVELS - 1; ++level) {
+        for (unsigned int index = 0; index < LEVEL_SIZE; ++index) {
+            while (this->levels[level][index]) {
+                timers.push_back(this->levels[level][index]);
+                unlink(this->levels[level][index]);
+            }
+        }
+    }
+    this->count = 0;
+}
+
+CUTEST_NS_END
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <cppunit/SynchronizedObject.h>
+
+#include <cppunit/portability/CppUnitVector.h>
+
+#include "cutest/Define.h"
+#include "cutest/Runnable.h"
+
+CUTEST_NS_BEGIN
+
+/*
+    分层时间轮，RunnerBase用它管理所有的延迟任务（见Runner::delayRunOnMainThread()、AutoEndTest），
+    整个Runner只需要一个系统定时器（见Alarm），总是指向时间轮下一次需要处理的时刻：
+    - 第0层有256个槽，每槽1ms；第1~3层各有64个槽，每槽为下一层转一圈的时长，总共可以覆盖2^26ms（约18.6小时），
+      更远的Timer先放在最高层，转到时再按剩余的时长重新放置；
+    - schedule()、cancel()只是把Timer挂到对应的槽上或者从槽上摘下来，都是O(1)；
+    - expire()逐ms向前推进，第0层转完一圈时才把上一层对应槽中的Timer分散到下层，到期的Timer交给调用者执行。
+    线程安全，Timer在调用expire()的线程（即主线程）上执行。
+*/
+class TimerWheel : protected CPPUNIT_NS::SynchronizedObject {
+public:
+    // 时间轮中的任务，由调用者分配，schedule()之后到执行或者cancel()之前不能销毁
+    class Timer : public Runnable {
+        friend class TimerWheel;
+
+    public:
+        Timer()
+            : slot(NULL)
+            , prev(NULL)
+            , next(NULL)
+            , due_ms(0) {}
+
+        virtual ~Timer() {}
+
+        // 时间轮销毁时还没有执行的Timer，通过它来释放资源，默认什么也不做
+        virtual void discard() {}
+
+    private:
+        Timer** slot; // 所在槽的链表头，不在时间轮中时为NULL
+        Timer* prev;
+        Timer* next;
+        unsigned long long due_ms;
+    };
+
+    // 系统定时器，由平台相关的RunnerImpl实现
+    class Alarm {
+    public:
+        virtual ~Alarm() {}
+
+        // 让主线程在due_ms（tickCount64()的时刻）调用expire()，覆盖之前设置的时刻；提前或者多调用几次expire()也没有关系
+        virtual void arm(unsigned long long due_ms) = 0;
+    };
+
+public:
+    TimerWheel(CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock);
+
+    // 对还没有执行的Timer调用Timer::discard()
+    virtual ~TimerWheel();
+
+    void setAlarm(Alarm* alarm);
+
+    // 在due_ms（tickCount64()的时刻）执行timer，已经过去的时刻在下一次expire()时执行；timer已经在时间轮中时改为新的时刻
+    void schedule(Timer* timer, unsigned long long due_ms);
+
+    // timer还在时间轮中时把它摘下来并返回true，之后它不会再被执行；已经执行或者正在执行时返回false
+    bool cancel(Timer* timer);
+
+    // 执行now_ms及之前到期的Timer，并重新设置Alarm，只能在主线程调用
+    void expire(unsigned long long now_ms);
+
+    /*
+        fork之后在子进程中调用，见RunnerImpl::resetAfterFork()：
+        - fork时其他线程可能正持有锁，换用新的lock，旧的锁直接丢弃；
+        - 时间轮中的Timer属于父进程，既不执行也不调用Timer::discard()，只把它们从时间轮中摘下来。
+    */
+    void resetAfterFork(CPPUNIT_NS::SynchronizedObject::SynchronizationObject* lock);
+
+protected:
+    enum {
+        LEVELS = 4,
+        LEVEL0_BITS = 8,
+        LEVEL_BITS = 6,
+        LEVEL0_SIZE = 1 << LEVEL0_BITS,
+        LEVEL_SIZE = 1 << LEVEL_BITS,
+        SPAN_BITS = LEVEL0_BITS + LEVEL_BITS * (LEVELS - 1), // 时间轮能覆盖的时长为2^SPAN_BITS ms
+    };
+
+    Timer* level0[LEVEL0_SIZE];
+    Timer* levels[LEVELS - 1][LEVEL_SIZE]; // 第1层到第LEVELS-1层
+
+    unsigned long long current_ms; // 下一个要处理的时刻，它之前的槽都已经处理过了
+    unsigned int count;            // 时间轮中的Timer数
+    unsigned long long armed_ms;   // 最近一次设置给alarm的时刻，为0表示没有设置
+    Alarm* alarm;
+
+    // 以下方法调用前需持有锁
+    void place(Timer* timer);
+    static void link(Timer** slot, Timer* timer);
+    static void unlink(Timer* timer);
+    unsigned int cascade(unsigned int level); // 返回分散的槽在这一层的位置
+    unsigned long long nextDue() const;
+    void takeAll(CppUnitVector<Timer*>& timers);
+
+private:
+    TimerWheel(const TimerWheel& other);
+    TimerWheel& operator =(const TimerWheel& other);
+};
+
+CUTEST_NS_END
@@ -0,0 +1,164 @@
+﻿#include "../CountDownLatchImpl.h"
+#include "EventImpl.h"
+#include "RunnerImpl.h"
+
+#include <cppunit/Exception.h>
+#include <cppunit/Message.h>
+#include <stdio.h>
+
+#include "cutest/Helper.h"
+#include "cutest/Runner.h"
+
+CUTEST_NS_BEGIN
+
+namespace {
+
+// 主线程阻塞在event上时，每隔这么久检查一次是否有到期的任务在等待主线程，单位：ms
+const unsigned int DEADLOCK_CHECK_INTERVAL_MS = 100;
+
+// 主线程上的任务到期超过这么久还不能执行，就认为latch在等待它countDown()，单位：ms
+const unsigned long long DEADLOCK_GRACE_MS = 2000;
+
+/*
+    主线程阻塞时，delayRunOnMainThread()的任务到期也无法执行，如果latch正是由它countDown()，就会永远等下去。
+    检测到这种情况时给当前用例报告错误并返回true，调用者不再阻塞
+*/
+bool
+reportMainThreadDeadlock() {
+    unsigned long long overdue_ms = static_cast<RunnerImpl*>(Runner::instance())->overdueMs();
+    if (overdue_ms < DEADLOCK_GRACE_MS) {
+        return false;
+    }
+
+    char detail[256] = {0};
+    ::snprintf(detail, sizeof(detail),
+               "a task posted by delayRunOnMainThread() has been due for %llu ms, "
+               "but cannot run while await() blocks the main thread; count the latch down on another thread",
+               overdue_ms);
+    Runner::instance()->addFailure(true, new CPPUNIT_NS::Exception(
+        CPPUNIT_NS::Message("CountDownLatch::await() deadlocks the main thread", detail)));
+    return true;
+}
+
+} // namespace
+
+CountDownLatchImpl::CountDownLatchImpl(int count_in)
+    : count(count_in)
+    , event(NULL) {
+    // 在构造时就创建事件，避免countDown()先于awaitOnWorkerThread()调用时丢失通知
+    this->event = Event::createInstance();
+}
+
+CountDownLatchImpl::~CountDownLatchImpl() {
+    if (this->event) {
+        this->event->destroy();
+        this->event = NULL;
+    }
+}
+
+void
+CountDownLatchImpl::await() {
+    // 快速路径：已经减到0时不用等待event，不加锁直接返回
+    if (getCount() <= 0) {
+        return;
+    }
+
+    if (CUTEST_NS::isOnMainThread()) {
+        awaitOnMainThread();
+    } else {
+        awaitOnWorkerThread();
+    }
+}
+
+bool
+CountDownLatchImpl::await(unsigned int timeout_ms) {
+    if (getCount() <= 0) {
+        return true;
+    }
+
+    if (CUTEST_NS::isOnMainThread()) {
+        return awaitOnMainThread(timeout_ms);
+    } else {
+        return awaitOnWorkerThread(timeout_ms);
+    }
+}
+
+void
+CountDownLatchImpl::countDown() {
+    // 减1之后latch可能已经被delete，只能通过自己持有的引用访问event
+    EventImpl* event_ref = static_cast<EventImpl*>(this->event);
+    event_ref->retain();
+    if (__sync_sub_and_fetch(&this->count, 1) <= 0) {
+        event_ref->post();
+    }
+    event_ref->destroy();
+}
+
+int
+CountDownLatchImpl::getCount() {
+    // 只读不写，acquire语义保证看到0之后，countDown()之前的修改也都可见
+    return __atomic_load_n(&this->count, __ATOMIC_ACQUIRE);
+}
+
+/*
+    主线程的消息循环在Java层的Looper中，native层没办法在等待期间驱动它，
+    所以主线程上也只能阻塞在event上，countDown()需要在其他线程上调用；
+    阻塞期间定时检查，发现主线程上的任务到期后一直不能执行时报告错误并返回，见reportMainThreadDeadlock()
+*/
+void
+CountDownLatchImpl::awaitOnMainThread() {
+    while (getCount() > 0) {
+        if (reportMainThreadDeadlock()) {
+            return;
+        }
+        this->event->wait(DEADLOCK_CHECK_INTERVAL_MS);
+    }
+
+    this->event->post();
+}
+
+bool
+CountDownLatchImpl::awaitOnMainThread(unsigned int timeout_ms) {
+    unsigned long long start = CUTEST_NS::tickCount64();
+
+    while (getCount() > 0) {
+        unsigned long long elapsed_ms = CUTEST_NS::tickCount64() - start;
+        if (elapsed_ms >= timeout_ms || reportMainThreadDeadlock()) {
+            return false;
+        }
+
+        unsigned long long wait_ms = timeout_ms - elapsed_ms;
+        this->event->wait((unsigned int)(wait_ms < DEADLOCK_CHECK_INTERVAL_MS ? wait_ms : DEADLOCK_CHECK_INTERVAL_MS));
+    }
+
+    this->event->post();
+    return true;
+}
+
+void
+CountDownLatchImpl::awaitOnWorkerThread() {
+    while (getCount() > 0) {
+        this->event->wait();
+    }
+
+    // event每次post()只唤醒一个线程，醒来之后再post()一次，把通知传给下一个在等待的线程
+    this->event->post();
+}
+
+bool
+CountDownLatchImpl::awaitOnWorkerThread(unsigned int timeout_ms) {
+    unsigned long long start = CUTEST_NS::tickCount64();
+
+    while (getCount() > 0) {
+        unsigned long long elapsed_ms = CUTEST_NS::tickCount64() - start;
+        if (elapsed_ms >= timeout_ms) {
+            return false;
+        }
+        this->event->wait((unsigned int)(timeout_ms - elapsed_ms));
+    }
+
+    this->event->post();
+    return true;
+}
+
+CUTEST_NS_END
@@ -11,10 +11,10 @@ Decorator::createInstance(CPPUNIT_NS::Test* test) {
 DecoratorImpl::DecoratorImpl(CPPUNIT_NS::Test* test)
     : TestDecorator(test)
     , test_result(new CPPUNIT_NS::SynchronizationObjectImpl(), new CPPUNIT_NS::SynchronizationObjectImpl())
-    , result_collector(new CPPUNIT_NS::SynchronizationObjectImpl())
+    , failure_log(new CPPUNIT_NS::SynchronizationObjectImpl())
     , runing_test(NULL) {
     test_result.addListener(this);
-    test_result.addListener(&this->result_collector);
+    test_result.setFailureLog(&this->failure_log);
 
     this->run_completed = Event::createInstance();
 }
@@ -35,6 +35,11 @@ DecoratorImpl::addListener(CPPUNIT_NS::TestListener* listener) {
     this->test_result.addListener(listener);
 }
 
+void
+DecoratorImpl::pushProtector(CPPUNIT_NS::Protector* protector) {
+    this->test_result.pushProtector(protector);
+}
+
 void
 DecoratorImpl::start() {
     this->run_completed->reset();
@@ -72,9 +77,9 @@ DecoratorImpl::stop() {
     this->test_result.stop();
 }
 
-const CPPUNIT_NS::TestResultCollector*
-DecoratorImpl::testResultCollector() {
-    return &this->result_collector;
+FailureLog*
+DecoratorImpl::failureLog() {
+    return &this->failure_log;
 }
 
 void
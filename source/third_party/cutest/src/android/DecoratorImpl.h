@@ -1,7 +1,6 @@
 ﻿#pragma once
 
 #include <cppunit/extensions/TestDecorator.h>
-#include <cppunit/TestResultCollector.h>
 #include <cppunit/Test.h>
 
 #include "../Decorator.h"
@@ -23,6 +22,7 @@ public:
     virtual void destroy() override;
 
     virtual void addListener(CPPUNIT_NS::TestListener* listener) override;
+    virtual void pushProtector(CPPUNIT_NS::Protector* protector) override;
 
     virtual void start() override;
     virtual void stop() override;
@@ -35,11 +35,11 @@ protected:
 
 public:
     virtual void addFailure(bool is_error, CPPUNIT_NS::Exception* exception) override;
-    virtual const CPPUNIT_NS::TestResultCollector* testResultCollector() override;
+    virtual FailureLog* failureLog() override;
 
 protected:
     Result test_result;
-    CPPUNIT_NS::TestResultCollector result_collector;
+    FailureLog failure_log;
 
 public: // 重载TestListener的成员方法
     virtual void startTest(CPPUNIT_NS::Test* test) override;
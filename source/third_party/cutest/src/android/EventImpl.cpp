@@ -1,17 +1,60 @@
 ﻿#include "EventImpl.h"
 
+#include <errno.h>
+#include <time.h>
+
 CUTEST_NS_BEGIN
 
+/*
+    destroy()之后的事件放回池中，createInstance()优先复用，
+    这样TestCaller、ProgressListenerManager等每次跨线程交接时都不需要再初始化mutex和条件变量，也不用分配内存
+*/
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static EventImpl* pool_head = NULL;
+static unsigned int pool_size = 0;
+
+static const unsigned int MAX_POOL_SIZE = 64;
+
 Event*
 Event::createInstance() {
-    return new EventImpl;
+    EventImpl* event = EventImpl::takeFromPool();
+    return event ? event : new EventImpl;
+}
+
+EventImpl*
+EventImpl::takeFromPool() {
+    ::pthread_mutex_lock(&pool_mutex);
+    EventImpl* event = pool_head;
+    if (event) {
+        pool_head = event->next_free;
+        --pool_size;
+    }
+    ::pthread_mutex_unlock(&pool_mutex);
+
+    if (event) {
+        event->refs = 1;
+    }
+
+    return event;
 }
 
-EventImpl::EventImpl() {
+EventImpl::EventImpl()
+    : signaled(false)
+    , next_free(NULL)
+    , refs(1) {
     ::pthread_mutex_init(&this->mutex, NULL);
+
+    // 超时等待基于CLOCK_MONOTONIC，避免系统时间被调整时等待时长出错
+#if __ANDROID_API__ >= 21
+    pthread_condattr_t attr;
+    ::pthread_condattr_init(&attr);
+    ::pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    ::pthread_cond_init(&this->cond, &attr);
+    ::pthread_condattr_destroy(&attr);
+#else
+    // android-21之前没有pthread_condattr_setclock()，由pthread_cond_timedwait_monotonic_np()指定时钟
     ::pthread_cond_init(&this->cond, NULL);
-    this->manual = false;
-    this->signaled = false;
+#endif
 }
 
 void
@@ -20,21 +63,41 @@ EventImpl::wait() {
     while (!this->signaled) {
         ::pthread_cond_wait(&this->cond, &this->mutex);
     }
-    if (!this->manual) {
-        this->signaled = false;
-    }
+    this->signaled = false;
     ::pthread_mutex_unlock(&this->mutex);
 }
 
 void
 EventImpl::wait(unsigned int timeout_ms) {
+    struct timespec deadline;
+    ::clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    ::pthread_mutex_lock(&this->mutex);
+    while (!this->signaled) {
+#if __ANDROID_API__ >= 21
+        int result = ::pthread_cond_timedwait(&this->cond, &this->mutex, &deadline);
+#else
+        int result = ::pthread_cond_timedwait_monotonic_np(&this->cond, &this->mutex, &deadline);
+#endif
+        if (ETIMEDOUT == result) {
+            break;
+        }
+    }
+    this->signaled = false;
+    ::pthread_mutex_unlock(&this->mutex);
 }
 
 void
 EventImpl::post() {
     ::pthread_mutex_lock(&this->mutex);
-    ::pthread_cond_signal(&this->cond);
     this->signaled = true;
+    ::pthread_cond_signal(&this->cond);
     ::pthread_mutex_unlock(&this->mutex);
 }
 
@@ -45,12 +108,37 @@ EventImpl::reset() {
     ::pthread_mutex_unlock(&this->mutex);
 }
 
+void
+EventImpl::retain() {
+    __sync_add_and_fetch(&this->refs, 1);
+}
+
 void
 EventImpl::destroy() {
+    if (__sync_sub_and_fetch(&this->refs, 1) > 0) {
+        return;
+    }
+
+    // 上一个使用者没有消费掉的信号不能留给下一个使用者
+    reset();
+
+    ::pthread_mutex_lock(&pool_mutex);
+    if (pool_size < MAX_POOL_SIZE) {
+        this->next_free = pool_head;
+        pool_head = this;
+        ++pool_size;
+        ::pthread_mutex_unlock(&pool_mutex);
+        return;
+    }
+    ::pthread_mutex_unlock(&pool_mutex);
+
+    release();
+}
+
+void
+EventImpl::release() {
     ::pthread_mutex_destroy(&this->mutex);
     ::pthread_cond_destroy(&this->cond);
-    this->manual = true;
-    this->signaled = false;
     delete this;
 }
 
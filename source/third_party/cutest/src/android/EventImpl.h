@@ -8,17 +8,38 @@ CUTEST_NS_BEGIN
 class EventImpl : public Event {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
-    bool manual;
     bool signaled;
 
+    // 放回池中之后指向下一个空闲的事件，见Event::createInstance()
+    EventImpl* next_free;
+
+    // 引用计数，createInstance()之后为1，减到0时才放回池中，见retain()
+    int refs;
+
 public:
     EventImpl();
 
+    // 从池中取出一个空闲的事件，池为空时返回NULL
+    static EventImpl* takeFromPool();
+
     virtual void wait();
     virtual void wait(unsigned int timeout_ms);
     virtual void post();
     virtual void reset();
+
+    // 释放一份引用，最后一份引用释放时才放回池中
     virtual void destroy();
+
+    /*
+        再持有一份引用，需要对应地调用一次destroy()。
+        CountDownLatch::countDown()用它在count减到0之前先持有event：
+        等待的线程看到0之后可能立即delete latch，post()不能依赖latch持有的那份引用。
+    */
+    void retain();
+
+protected:
+    // 真正销毁mutex和条件变量，池已满时由destroy()调用
+    void release();
 };
 
 CUTEST_NS_END
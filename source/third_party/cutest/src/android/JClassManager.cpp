@@ -11,6 +11,11 @@ JClassManager* JClassManager::instance() {
 }
 
 JClassManager::JClassManager() {
+    ::pthread_mutex_init(&this->jmethod_mutex, NULL);
+}
+
+JClassManager::~JClassManager() {
+    ::pthread_mutex_destroy(&this->jmethod_mutex);
 }
 
 void
@@ -36,6 +41,11 @@ JClassManager::deleteAllGlobalClassRef() {
         env->DeleteGlobalRef(it->second);
         ++it;
     }
+
+    // 类卸载之后方法ID也随之失效
+    ::pthread_mutex_lock(&this->jmethod_mutex);
+    this->jmethod_map.clear();
+    ::pthread_mutex_unlock(&this->jmethod_mutex);
 }
 
 jclass JClassManager::findGlobalClass(const char* class_name) {
@@ -47,6 +57,40 @@ jclass JClassManager::findGlobalClass(const char* class_name) {
     }
 }
 
+jmethodID
+JClassManager::findMethodID(const char* class_name, const char* method_name, const char* signature, bool is_static) {
+    jclass cls = findGlobalClass(class_name);
+    if (!cls) {
+        return NULL;
+    }
+
+    std::string key = std::string(method_name) + signature;
+    ::pthread_mutex_lock(&this->jmethod_mutex);
+    JMethodMap& methods = this->jmethod_map[class_name];
+    JMethodMap::iterator it = methods.find(key);
+    if (it != methods.end()) {
+        jmethodID id = it->second;
+        ::pthread_mutex_unlock(&this->jmethod_mutex);
+        return id;
+    }
+    ::pthread_mutex_unlock(&this->jmethod_mutex);
+
+    // 查找期间不持有锁，多个线程同时查找时结果相同，谁先写入都可以
+    JniEnv env;
+    jmethodID id = is_static
+        ? env->GetStaticMethodID(cls, method_name, signature)
+        : env->GetMethodID(cls, method_name, signature);
+    if (!id) {
+        env->ExceptionClear();
+        return NULL;
+    }
+
+    ::pthread_mutex_lock(&this->jmethod_mutex);
+    this->jmethod_map[class_name][key] = id;
+    ::pthread_mutex_unlock(&this->jmethod_mutex);
+    return id;
+}
+
 CUTEST_NS_END
 
 extern "C" JNIEXPORT jint JNICALL
@@ -5,46 +5,136 @@
 #include <cppunit/TestFailure.h>
 
 #include "cutest/Helper.h"
+#include "cutest/JClassManager.h"
+#include "cutest/Runner.h"
+
+#include "RunnerImpl.h"
+
+#include <map>
 
 CUTEST_NS_BEGIN
 
+namespace {
+
+// 积攒事件的时长，大约一帧，单位：ms
+const unsigned int FLUSH_DELAY_MS = 16;
+
+} // namespace
+
 JniProgressListener::JniProgressListener()
     : jni_env(NULL)
     , java_entity(NULL)
-    , java_class(NULL) {
+    , java_string_class(NULL)
+    , dispatch_method(NULL)
+    , event_count(0)
+    , flusher(this)
+    , flush_scheduled(false) {
 }
 
 JniProgressListener::~JniProgressListener() {
     deleteJavaRef();
 }
 
+JniProgressListener::PendingEvent&
+JniProgressListener::addEvent(EventType type, CPPUNIT_NS::Test* test, jint value0, jint value1, jint value2) {
+    if (this->event_count == this->events.size()) {
+        this->events.push_back(PendingEvent());
+    }
+
+    PendingEvent& event = this->events[this->event_count++];
+    event.type = type;
+    event.test = test;
+    event.file_name.clear();
+    event.values[0] = value0;
+    event.values[1] = value1;
+    event.values[2] = value2;
+
+    if (!this->flush_scheduled) {
+        this->flush_scheduled = true;
+        Runner::instance()->delayRunOnMainThread(FLUSH_DELAY_MS, &this->flusher, false);
+    }
+    return event;
+}
+
+void
+JniProgressListener::flush() {
+    if (0 == this->event_count || !this->java_entity) {
+        this->event_count = 0;
+        return;
+    }
+
+    JNIEnv* env = this->jni_env;
+    jsize count = (jsize)this->event_count;
+    jintArray values = env->NewIntArray(count * (VALUE_COUNT + 1));
+    jobjectArray names = env->NewObjectArray(count, this->java_string_class, NULL);
+
+    // 同一个用例的开始和结束事件共用一个jstring，结束事件用过之后就释放，避免局部引用过多
+    typedef std::map<CPPUNIT_NS::Test*, jstring> TestNames;
+    TestNames test_names;
+
+    jint* elements = env->GetIntArrayElements(values, NULL);
+    for (jsize index = 0; index < count; ++index) {
+        const PendingEvent& event = this->events[index];
+        jint* element = elements + index * (VALUE_COUNT + 1);
+        element[0] = event.type;
+        for (int i = 0; i < VALUE_COUNT; ++i) {
+            element[i + 1] = event.values[i];
+        }
+
+        if (event.test) {
+            TestNames::iterator it = test_names.find(event.test);
+            if (it == test_names.end()) {
+                it = test_names.insert(std::make_pair(event.test, env->NewStringUTF(event.test->getName().c_str()))).first;
+            }
+            env->SetObjectArrayElement(names, index, it->second);
+
+            if (EVENT_TEST_END == event.type) {
+                env->DeleteLocalRef(it->second);
+                test_names.erase(it);
+            }
+        } else if (EVENT_FAILURE_ADD == event.type) {
+            jstring name = env->NewStringUTF(event.file_name.c_str());
+            env->SetObjectArrayElement(names, index, name);
+            env->DeleteLocalRef(name);
+        }
+    }
+    env->ReleaseIntArrayElements(values, elements, 0);
+    this->event_count = 0;
+
+    // 这一批中还没有结束的用例
+    TestNames::iterator it = test_names.begin();
+    while (it != test_names.end()) {
+        env->DeleteLocalRef(it->second);
+        ++it;
+    }
+
+    jclass cls = JClassManager::instance()->findGlobalClass(RunnerImpl::jclassName());
+    env->CallStaticVoidMethod(cls, this->dispatch_method, this->java_entity, values, names);
+    env->DeleteLocalRef(values);
+    env->DeleteLocalRef(names);
+}
+
 void
 JniProgressListener::onRunnerStart(CPPUNIT_NS::Test* test) {
-    jmethodID id = this->jni_env->GetMethodID(this->java_class, "onRunnerStart", "(I)V");
-    this->jni_env->CallVoidMethod(this->java_entity, id, test->countTestCases());
+    addEvent(EVENT_RUNNER_START, NULL, Runner::instance()->countTestCases(test), 0, 0);
 }
 
 void
 JniProgressListener::onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) {
-    jmethodID id = this->jni_env->GetMethodID(this->java_class, "onRunnerEnd", "(I)V");
-    this->jni_env->CallVoidMethod(this->java_entity, id, elapsed_ms);
+    addEvent(EVENT_RUNNER_END, NULL, elapsed_ms, 0, 0);
+    flush();
     deleteJavaRef();
 }
 
 void
 JniProgressListener::onTestStart(CPPUNIT_NS::Test* test) {
-    jmethodID id = this->jni_env->GetMethodID(this->java_class, "onTestStart", "(Ljava/lang/String;)V");
-    jstring name = this->jni_env->NewStringUTF(test->getName().c_str());
-    this->jni_env->CallVoidMethod(this->java_entity, id, name);
-    this->jni_env->DeleteLocalRef(name);
+    addEvent(EVENT_TEST_START, test, 0, 0, 0);
 }
 
 void
 JniProgressListener::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) {
-    jmethodID id = this->jni_env->GetMethodID(this->java_class, "onFailureAdd", "(IZLjava/lang/String;I)V");
-    jstring name = this->jni_env->NewStringUTF(makeFilePathShorter(failure.sourceLine().fileName()).c_str());
-    this->jni_env->CallVoidMethod(this->java_entity, id, index, failure.isError(), name, failure.sourceLine().lineNumber());
-    this->jni_env->DeleteLocalRef(name);
+    PendingEvent& event = addEvent(EVENT_FAILURE_ADD, NULL, index, failure.isError(), failure.sourceLine().lineNumber());
+    event.file_name = makeFilePathShorter(failure.sourceLine().fileName());
 }
 
 void
@@ -53,10 +143,7 @@ JniProgressListener::onTestEnd(
     unsigned int error_count,
     unsigned int failure_count,
     unsigned int elapsed_ms) {
-    jmethodID id = this->jni_env->GetMethodID(this->java_class, "onTestEnd", "(Ljava/lang/String;III)V");
-    jstring name = this->jni_env->NewStringUTF(test->getName().c_str());
-    this->jni_env->CallVoidMethod(this->java_entity, id, name, error_count, failure_count, elapsed_ms);
-    this->jni_env->DeleteLocalRef(name);
+    addEvent(EVENT_TEST_END, test, error_count, failure_count, elapsed_ms);
 }
 
 void
@@ -65,18 +152,29 @@ JniProgressListener::setJavaEntity(JNIEnv* env, jobject value) {
 
     this->jni_env = env;
     this->java_entity = env->NewGlobalRef(value);
-    this->java_class = (jclass)env->NewGlobalRef(env->GetObjectClass(this->java_entity));
+
+    jclass string_class = env->FindClass("java/lang/String");
+    this->java_string_class = (jclass)env->NewGlobalRef(string_class);
+    env->DeleteLocalRef(string_class);
+
+    this->dispatch_method = JClassManager::instance()->findMethodID(
+        RunnerImpl::jclassName(),
+        "dispatchProgress",
+        "(Lcom/tencent/cutest/ProgressListener;[I[Ljava/lang/String;)V",
+        true);
 }
 
 void JniProgressListener::deleteJavaRef() {
+    this->event_count = 0;
+
     if (this->java_entity) {
         this->jni_env->DeleteGlobalRef(this->java_entity);
         this->java_entity = NULL;
     }
 
-    if (this->java_class) {
-        this->jni_env->DeleteGlobalRef(this->java_class);
-        this->java_class = NULL;
+    if (this->java_string_class) {
+        this->jni_env->DeleteGlobalRef(this->java_string_class);
+        this->java_string_class = NULL;
     }
 }
 
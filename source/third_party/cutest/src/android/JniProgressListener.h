@@ -3,6 +3,7 @@
 #include "cutest/ProgressListener.h"
 #include "cutest/Runnable.h"
 
+#include <cppunit/portability/CppUnitVector.h>
 #include <jni.h>
 
 #include <stack>
@@ -10,6 +11,13 @@
 
 CUTEST_NS_BEGIN
 
+/*
+    把进度事件转发给Java层的ProgressListener：
+    - 事件先在native层积攒起来，每帧（FLUSH_DELAY_MS）通过Runner.dispatchProgress()批量交给Java层，
+      runner结束时立即交出剩余的事件；
+    - Java层的方法ID在setJavaEntity()时查找一次；
+    - 同一批事件中同一个用例的名字只创建一个jstring。
+*/
 class JniProgressListener : public ProgressListener {
 public:
     JniProgressListener();
@@ -34,7 +42,51 @@ protected:
     void deleteJavaRef();
     JNIEnv* jni_env;
     jobject java_entity;
-    jclass java_class;
+    jclass java_string_class;
+    jmethodID dispatch_method; // Runner.dispatchProgress()
+
+    // 和Runner.java中的EVENT_*一一对应
+    enum EventType {
+        EVENT_RUNNER_START = 0,
+        EVENT_RUNNER_END,
+        EVENT_TEST_START,
+        EVENT_FAILURE_ADD,
+        EVENT_TEST_END,
+    };
+
+    // 每个事件在Java层的int数组中占VALUE_COUNT + 1个元素：类型和参数
+    enum { VALUE_COUNT = 3 };
+
+    struct PendingEvent {
+        EventType type;
+        CPPUNIT_NS::Test* test;  // EVENT_TEST_START和EVENT_TEST_END才有
+        std::string file_name;   // 只有EVENT_FAILURE_ADD才有
+        jint values[VALUE_COUNT];
+    };
+    CppUnitVector<PendingEvent> events;
+    size_t event_count; // events中有效的事件数，events只增不减，以便复用其中的file_name
+
+    PendingEvent& addEvent(EventType type, CPPUNIT_NS::Test* test, jint value0, jint value1, jint value2);
+
+    // 把积攒的事件一次交给Java层
+    void flush();
+
+    class Flusher : public Runnable {
+    public:
+        explicit Flusher(JniProgressListener* listener_in)
+            : listener(listener_in) {}
+
+        // 实现Runnable::run()，在主线程上执行
+        virtual void run() {
+            this->listener->flush_scheduled = false;
+            this->listener->flush();
+        }
+
+    protected:
+        JniProgressListener* listener;
+    };
+    Flusher flusher;
+    bool flush_scheduled;
 };
 
 CUTEST_NS_END
@@ -3,6 +3,7 @@
 #include <android/log.h>
 #include <cppunit/Test.h>
 #include <cppunit/TestFailure.h>
+#include <stdio.h>
 
 #include "cutest/Helper.h"
 #include "cutest/Runner.h"
@@ -55,16 +56,16 @@ Logger::onRunnerStart(CPPUNIT_NS::Test* test) {
     this->failed_test_cases.clear();
 
     printString("[==========] Running %s from %s.",
-                testing::FormatTestCount(test->countTestCases()).c_str(),
+                testing::FormatTestCount(Runner::instance()->countTestCases(test)).c_str(),
                 test->getName().c_str());
 }
 
 void
-Logger::onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) {
-    printString("[==========] %s from %s ran. (%u ms total)",
-                testing::FormatTestCount(test->countTestCases()).c_str(),
+Logger::onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
+    printString("[==========] %s from %s ran. (%s ms total)",
+                testing::FormatTestCount(Runner::instance()->countTestCases(test)).c_str(),
                 test->getName().c_str(),
-                elapsed_ms);
+                formatElapsedMs(elapsed_ns).c_str());
 
     printString("[  PASSED  ] %s.", testing::FormatTestCount(this->passed_test_cases).c_str());
 
@@ -85,16 +86,16 @@ Logger::onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) {
 void
 Logger::onSuiteStart(CPPUNIT_NS::Test* suite) {
     printString("[----------] %s from %s",
-                testing::FormatTestCount(suite->countTestCases()).c_str(),
+                testing::FormatTestCount(Runner::instance()->countTestCases(suite)).c_str(),
                 suite->getName().c_str());
 }
 
 void
-Logger::onSuiteEnd(CPPUNIT_NS::Test* suite, unsigned int elapsed_ms) {
-    printString("[----------] %s from %s (%u ms total)\n",
-                testing::FormatTestCount(suite->countTestCases()).c_str(),
+Logger::onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns) {
+    printString("[----------] %s from %s (%s ms total)\n",
+                testing::FormatTestCount(Runner::instance()->countTestCases(suite)).c_str(),
                 suite->getName().c_str(),
-                elapsed_ms);
+                formatElapsedMs(elapsed_ns).c_str());
 }
 
 void
@@ -109,7 +110,12 @@ Logger::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure)
         printString("");
     }
 
-    if (failure.isError()) {
+    // 没有出错位置的失败（如性能退化）只输出描述
+    if (!failure.sourceLine().isValid()) {
+        printString("%s: %s",
+                    failure.isError() ? "error" : "failure",
+                    failure.thrownException()->what());
+    } else if (failure.isError()) {
         printString("%s(%u): error : %s",
                     makeFilePathShorter(failure.sourceLine().fileName()).c_str(),
                     failure.sourceLine().lineNumber(),
@@ -124,20 +130,83 @@ Logger::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure)
 }
 
 void
-Logger::onTestEnd(
+Logger::onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<OmittedFailure>& omitted) {
+    if (this->first_failure_of_a_test) {
+        printString("");
+    }
+
+    for (size_t i = 0; i < omitted.size(); ++i) {
+        const OmittedFailure& failure = omitted[i];
+        if (!failure.source_line.isValid()) {
+            printString("%s omitted %u times, the first one: %s",
+                        failure.is_error ? "error" : "failure",
+                        failure.count,
+                        failure.message.c_str());
+        } else {
+            printString("%s(%u): %s omitted %u times, the first one: %s",
+                        makeFilePathShorter(failure.source_line.fileName()).c_str(),
+                        failure.source_line.lineNumber(),
+                        failure.is_error ? "error" : "failure",
+                        failure.count,
+                        failure.message.c_str());
+        }
+    }
+    this->first_failure_of_a_test = false;
+}
+
+void
+Logger::onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) {
+    printString("[ BENCHMARK] %s: mean %s (95%% CI %s ~ %s), median %s, p99 %s, %u samples x %llu iterations, %u outliers",
+                test->getName().c_str(),
+                formatDuration(result.mean_ns).c_str(),
+                formatDuration(result.ci_low_ns).c_str(),
+                formatDuration(result.ci_high_ns).c_str(),
+                formatDuration(result.median_ns).c_str(),
+                formatDuration(result.p99_ns).c_str(),
+                (unsigned int)result.samples_ns.size(),
+                result.iterations,
+                result.outliers);
+}
+
+void
+Logger::onRegressionReport(const CppUnitVector<Regression>& regressions) {
+    printString("[REGRESSION] %s slower than the performance baseline, ranked by slowdown:",
+                testing::FormatTestCount((int)regressions.size()).c_str());
+
+    for (size_t index = 0; index < regressions.size(); ++index) {
+        const Regression& regression = regressions[index];
+        double baseline_ns = regression.baseline_ns > 1 ? regression.baseline_ns : 1;
+
+        char p_value[32] = {0};
+        if (regression.p_value >= 0) {
+            ::sprintf(p_value, ", p = %.2g", regression.p_value);
+        }
+
+        printString("[REGRESSION] %+7.1f%% %s: %s%s -> %s%s",
+                    (regression.current_ns / baseline_ns - 1) * 100,
+                    regression.name.c_str(),
+                    regression.is_benchmark ? "median per iteration " : "",
+                    formatDuration(regression.baseline_ns).c_str(),
+                    formatDuration(regression.current_ns).c_str(),
+                    p_value);
+    }
+}
+
+void
+Logger::onTestEndNs(
     CPPUNIT_NS::Test* test,
     unsigned int error_count,
     unsigned int failure_count,
-    unsigned int elapsed_ms) {
+    unsigned long long elapsed_ns) {
     if (0 == error_count && 0 == failure_count) {
-        printString("[       OK ] %s (%u ms)",
+        printString("[       OK ] %s (%s ms)",
                     test->getName().c_str(),
-                    elapsed_ms);
+                    formatElapsedMs(elapsed_ns).c_str());
         ++this->passed_test_cases;
     } else {
-        printString("[  FAILED  ] %s (%u ms)",
+        printString("[  FAILED  ] %s (%s ms)",
                     test->getName().c_str(),
-                    elapsed_ms);
+                    formatElapsedMs(elapsed_ns).c_str());
         this->failed_test_cases.push_back(test->getName());
     }
 }
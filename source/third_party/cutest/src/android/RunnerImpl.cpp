@@ -4,6 +4,7 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include "cutest/JClassManager.h"
 #include "cutest/JniEnv.h"
+#include <time.h>
 
 CUTEST_NS_BEGIN
 
@@ -13,10 +14,16 @@ initGoogleMock() {
 
 unsigned long long
 tickCount64() {
-    struct timeval current;
-    gettimeofday(&current, NULL);
-    unsigned long long sec = current.tv_sec;
-    return (sec * 1000 + current.tv_usec / 1000);
+    return CUTEST_NS::tickCountNs() / 1000000;
+}
+
+unsigned long long
+tickCountNs() {
+    // 不用gettimeofday()，系统时间被调整时它会跳变
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    unsigned long long sec = now.tv_sec;
+    return (sec * 1000000000ULL + now.tv_nsec);
 }
 
 thread_id
@@ -30,9 +37,14 @@ Runner::instance() {
     return &runner_impl;
 }
 
-RunnerImpl::RunnerImpl() {
+RunnerImpl::RunnerImpl()
+    : armed_due_ms(0) {
     JClassManager::instance()->registerGlobalClassName(RunnerImpl::jclassName());
     JClassManager::instance()->newAllGlobalClassRef();
+    this->async_run_method = JClassManager::instance()->findMethodID(
+        RunnerImpl::jclassName(), "asyncRunOnMainThread", "(JZ)V", true);
+    this->arm_timer_method = JClassManager::instance()->findMethodID(
+        RunnerImpl::jclassName(), "armTimer", "(J)V", true);
     this->listener_manager.add(&test_progress_logger);
 
     // 通过这个异步方法给main_thread_id赋值
@@ -44,18 +56,32 @@ RunnerImpl::asyncRunOnMainThread(Runnable* runnable, bool is_auto_delete) {
     jclass cls = JClassManager::instance()->findGlobalClass(RunnerImpl::jclassName());
 
     JniEnv env;
-    jmethodID id = env->GetStaticMethodID(cls, "asyncRunOnMainThread", "(JZ)V");
-    env->CallStaticVoidMethod(cls, id, (jlong)runnable, (jboolean)is_auto_delete);
+    env->CallStaticVoidMethod(cls, this->async_run_method, (jlong)runnable, (jboolean)is_auto_delete);
 }
 
 void
-RunnerImpl::delayRunOnMainThread(
-    unsigned int delay_ms, Runnable* runnable, bool is_auto_delete) {
+RunnerImpl::arm(unsigned long long due_ms) {
+    unsigned long long now_ms = CUTEST_NS::tickCount64();
+    unsigned long long delay_ms = due_ms > now_ms ? due_ms - now_ms : 0;
+    __atomic_store_n(&this->armed_due_ms, due_ms, __ATOMIC_RELEASE);
     jclass cls = JClassManager::instance()->findGlobalClass(RunnerImpl::jclassName());
 
     JniEnv env;
-    jmethodID id = env->GetStaticMethodID(cls, "delayRunOnMainThread", "(JJZ)V");
-    env->CallStaticVoidMethod(cls, id, (jlong)delay_ms, (jlong)runnable, (jboolean)is_auto_delete);
+    env->CallStaticVoidMethod(cls, this->arm_timer_method, (jlong)delay_ms);
+}
+
+void
+RunnerImpl::onTimer() {
+    // 先清零再expire()，还有没到期的任务时expire()会重新arm()
+    __atomic_store_n(&this->armed_due_ms, 0ULL, __ATOMIC_RELEASE);
+    this->timer_wheel.expire(CUTEST_NS::tickCount64());
+}
+
+unsigned long long
+RunnerImpl::overdueMs() {
+    unsigned long long due_ms = __atomic_load_n(&this->armed_due_ms, __ATOMIC_ACQUIRE);
+    unsigned long long now_ms = CUTEST_NS::tickCount64();
+    return (0 != due_ms && now_ms > due_ms) ? now_ms - due_ms : 0;
 }
 
 void
@@ -100,6 +126,12 @@ Java_com_tencent_cutest_Runner_internalRun(
     }
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_tencent_cutest_Runner_onTimer(
+    JNIEnv* env, jobject thiz) {
+    ((CUTEST_NS::RunnerImpl*)CUTEST_NS::Runner::instance())->onTimer();
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_com_tencent_cutest_Runner_failureDetails(
     JNIEnv* env, jobject thiz, jint index) {
@@ -20,12 +20,26 @@ public:
 protected:
     Logger test_progress_logger;
 
+    // Java层Runner的静态方法，构造时查找一次，之后每次投递任务直接使用
+    jmethodID async_run_method;
+    jmethodID arm_timer_method;
+
+    // TimerWheel::Alarm的实现，通过Java层Runner.armTimer()在主线程的Handler上只保留一个延迟任务
+    virtual void arm(unsigned long long due_ms) override;
+
+    unsigned long long armed_due_ms; // 最近一次arm()的时刻，onTimer()之后为0，见overdueMs()
+
 public:
     // Runner的接口实现
     virtual void asyncRunOnMainThread(Runnable* runnable, bool is_auto_delete);
-    virtual void delayRunOnMainThread(unsigned int delay_ms, Runnable* runnable, bool is_auto_delete);
 
     virtual void waitUntilAllTestEnd();
+
+    // 由Java层Runner.onTimer()在主线程调用
+    void onTimer();
+
+    // 时间轮中的任务已经到期多久，单位ms，没有到期的任务时返回0；主线程阻塞时，到期的任务要等它返回才能执行
+    unsigned long long overdueMs();
 };
 
 CUTEST_NS_END
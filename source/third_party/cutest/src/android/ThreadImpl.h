@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include "../Thread.h"
+#include <pthread.h>
+
+CUTEST_NS_BEGIN
+
+class ThreadImpl : public Thread {
+public:
+    ThreadImpl(Runnable* runnable);
+
+    virtual void join();
+    virtual void destroy();
+
+protected:
+    static void* threadFunction(void* param);
+
+    Runnable* runnable;
+    pthread_t thread;
+    bool joinable;
+};
+
+CUTEST_NS_END
@@ -0,0 +1,122 @@
+﻿#include "../CountDownLatchImpl.h"
+#include "EventImpl.h"
+#include "RunnerImpl.h"
+
+#include "cutest/Helper.h"
+#include "cutest/Runner.h"
+
+CUTEST_NS_BEGIN
+
+CountDownLatchImpl::CountDownLatchImpl(int count_in)
+    : count(count_in)
+    , event(NULL) {
+    // 在构造时就创建事件，避免countDown()先于awaitOnWorkerThread()调用时丢失通知
+    this->event = Event::createInstance();
+}
+
+CountDownLatchImpl::~CountDownLatchImpl() {
+    if (this->event) {
+        this->event->destroy();
+        this->event = NULL;
+    }
+}
+
+void
+CountDownLatchImpl::await() {
+    // 快速路径：已经减到0时不用等待event，也不用驱动消息循环，不加锁直接返回
+    if (getCount() <= 0) {
+        return;
+    }
+
+    if (CUTEST_NS::isOnMainThread()) {
+        awaitOnMainThread();
+    } else {
+        awaitOnWorkerThread();
+    }
+}
+
+bool
+CountDownLatchImpl::await(unsigned int timeout_ms) {
+    if (getCount() <= 0) {
+        return true;
+    }
+
+    if (CUTEST_NS::isOnMainThread()) {
+        return awaitOnMainThread(timeout_ms);
+    } else {
+        return awaitOnWorkerThread(timeout_ms);
+    }
+}
+
+void
+CountDownLatchImpl::countDown() {
+    // 减1之后latch可能已经被delete，只能通过自己持有的引用访问event
+    EventImpl* event_ref = static_cast<EventImpl*>(this->event);
+    event_ref->retain();
+    if (__sync_sub_and_fetch(&this->count, 1) <= 0) {
+        event_ref->post();
+
+        // 主线程可能正在awaitOnMainThread()中等待消息循环，需要把它唤醒
+        static_cast<RunnerImpl*>(Runner::instance())->wakeUp();
+    }
+    event_ref->destroy();
+}
+
+int
+CountDownLatchImpl::getCount() {
+    // 只读不写，acquire语义保证看到0之后，countDown()之前的修改也都可见
+    return __atomic_load_n(&this->count, __ATOMIC_ACQUIRE);
+}
+
+void
+CountDownLatchImpl::awaitOnMainThread() {
+    // 主线程不能阻塞，需要继续驱动消息循环，countDown()可能就在主线程上被调用
+    RunnerImpl* runner = static_cast<RunnerImpl*>(Runner::instance());
+    while (getCount() > 0) {
+        runner->processEvents(-1);
+    }
+}
+
+bool
+CountDownLatchImpl::awaitOnMainThread(unsigned int timeout_ms) {
+    unsigned long long start = CUTEST_NS::tickCount64();
+
+    RunnerImpl* runner = static_cast<RunnerImpl*>(Runner::instance());
+    while (getCount() > 0) {
+        unsigned long long elapsed_ms = CUTEST_NS::tickCount64() - start;
+        if (elapsed_ms >= timeout_ms) {
+            return false;
+        }
+        runner->processEvents((int)(timeout_ms - elapsed_ms));
+    }
+
+    return true;
+}
+
+void
+CountDownLatchImpl::awaitOnWorkerThread() {
+    while (getCount() > 0) {
+        this->event->wait();
+    }
+
+    // event每次post()只唤醒一个线程，醒来之后再post()一次，把通知传给下一个在等待的线程
+    this->event->post();
+}
+
+bool
+CountDownLatchImpl::awaitOnWorkerThread(unsigned int timeout_ms) {
+    unsigned long long start = CUTEST_NS::tickCount64();
+
+    while (getCount() > 0) {
+        unsigned long long elapsed_ms = CUTEST_NS::tickCount64() - start;
+        if (elapsed_ms >= timeout_ms) {
+            return false;
+        }
+        this->event->wait((unsigned int)(timeout_ms - elapsed_ms));
+    }
+
+    this->event->post();
+    return true;
+}
+
+CUTEST_NS_END
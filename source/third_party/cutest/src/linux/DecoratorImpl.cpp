@@ -0,0 +1,119 @@
+﻿#include "DecoratorImpl.h"
+#include "SynchronizationObjectImpl.h"
+
+#include "cutest/Runner.h"
+
+#define GTEST_IMPLEMENTATION_ 1
+#include "src/gtest-internal-inl.h"
+#undef GTEST_IMPLEMENTATION_
+
+CUTEST_NS_BEGIN
+
+Decorator*
+Decorator::createInstance(CPPUNIT_NS::Test* test) {
+    return new DecoratorImpl(test);
+}
+
+DecoratorImpl::DecoratorImpl(CPPUNIT_NS::Test* test)
+    : TestDecorator(test)
+    , test_result(new CPPUNIT_NS::SynchronizationObjectImpl(), new CPPUNIT_NS::SynchronizationObjectImpl())
+    , failure_log(new CPPUNIT_NS::SynchronizationObjectImpl())
+    , result_printer(NULL)
+    , runing_test(NULL) {
+    test_result.addListener(this);
+    test_result.setFailureLog(&this->failure_log);
+
+    this->run_completed = Event::createInstance();
+}
+
+DecoratorImpl::~DecoratorImpl() {
+    if (this->result_printer) {
+        Runner::instance()->removeListener(this->result_printer);
+        delete this->result_printer;
+    }
+
+    this->run_completed->wait();
+    this->run_completed->destroy();
+    CPPUNIT_NS::TestDecorator::m_test = NULL;
+}
+
+void
+DecoratorImpl::destroy() {
+    delete this;
+}
+
+void
+DecoratorImpl::addListener(CPPUNIT_NS::TestListener* listener) {
+    this->test_result.addListener(listener);
+}
+
+void
+DecoratorImpl::pushProtector(CPPUNIT_NS::Protector* protector) {
+    this->test_result.pushProtector(protector);
+}
+
+void
+DecoratorImpl::start() {
+    // 根据参数构造TestResultXmlPrinter
+    if (testing::internal::UnitTestOptions::GetOutputFormat() == "xml") {
+        this->result_printer = new testing::internal::TestResultXmlPrinter(
+            testing::internal::UnitTestOptions::GetAbsolutePathToOutputFile().c_str());
+
+        Runner::instance()->addListener(this->result_printer);
+    }
+
+    this->run_completed->reset();
+
+    pthread_t thread;
+    if (0 == ::pthread_create(&thread, NULL, threadFunction, this)) {
+        // 工作线程结束的时机通过run_completed来判断，不需要join
+        ::pthread_detach(thread);
+    }
+}
+
+void*
+DecoratorImpl::threadFunction(void* param) {
+    DecoratorImpl* decorator = (DecoratorImpl*)param;
+
+    decorator->runOnWorkerThread();
+
+    return param;
+}
+
+void
+DecoratorImpl::runOnWorkerThread() {
+    this->test_result.runTest(this);
+
+    this->run_completed->post();
+}
+
+void
+DecoratorImpl::stop() {
+    this->test_result.stop();
+}
+
+FailureLog*
+DecoratorImpl::failureLog() {
+    return &this->failure_log;
+}
+
+void
+DecoratorImpl::startTest(CPPUNIT_NS::Test* test) {
+    this->runing_test = test;
+}
+
+void
+DecoratorImpl::endTest(CPPUNIT_NS::Test* test) {
+    this->runing_test = NULL;
+}
+
+void
+DecoratorImpl::addFailure(bool is_error, CPPUNIT_NS::Exception* exception) {
+    if (is_error) {
+        this->test_result.addError(this->runing_test, exception);
+    } else {
+        this->test_result.addFailure(this->runing_test, exception);
+    }
+}
+
+CUTEST_NS_END
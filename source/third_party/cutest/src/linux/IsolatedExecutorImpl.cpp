@@ -0,0 +1,667 @@
+﻿#include "IsolatedExecutorImpl.h"
+#include "RunnerImpl.h"
+
+#include <cppunit/Message.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestComposite.h>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../ParallelExecutor.h"
+#include "../Thread.h"
+
+#include "cutest/Runner.h"
+#include "gtest/gtest-death-test.h"
+
+#define GTEST_IMPLEMENTATION_ 1
+#include "src/gtest-internal-inl.h"
+#undef GTEST_IMPLEMENTATION_
+
+CUTEST_NS_BEGIN
+
+namespace {
+
+/*
+    记录的格式：4字节长度（不含自身） + 类型 + 节点下标 + 附加信息，附加信息包括：
+    - RECORD_ERROR和RECORD_FAILURE：失败信息；
+    - RECORD_END_TEST：是否有基准测试结果 + 基准测试结果（见BenchmarkTest）。
+*/
+
+void
+appendUInt32(std::string& record, uint32_t value) {
+    record.append((const char*)&value, sizeof(value));
+}
+
+void
+appendUInt64(std::string& record, uint64_t value) {
+    record.append((const char*)&value, sizeof(value));
+}
+
+void
+appendDouble(std::string& record, double value) {
+    record.append((const char*)&value, sizeof(value));
+}
+
+void
+appendString(std::string& record, const std::string& value) {
+    appendUInt32(record, (uint32_t)value.size());
+    record.append(value);
+}
+
+class RecordReader {
+public:
+    explicit RecordReader(const std::string& record_in)
+        : record(record_in)
+        , offset(0) {}
+
+    uint32_t readUInt32() {
+        uint32_t value = 0;
+        if (this->offset + sizeof(value) <= this->record.size()) {
+            ::memcpy(&value, this->record.data() + this->offset, sizeof(value));
+            this->offset += sizeof(value);
+        }
+        return value;
+    }
+
+    uint64_t readUInt64() {
+        uint64_t value = 0;
+        if (this->offset + sizeof(value) <= this->record.size()) {
+            ::memcpy(&value, this->record.data() + this->offset, sizeof(value));
+            this->offset += sizeof(value);
+        }
+        return value;
+    }
+
+    double readDouble() {
+        double value = 0;
+        if (this->offset + sizeof(value) <= this->record.size()) {
+            ::memcpy(&value, this->record.data() + this->offset, sizeof(value));
+            this->offset += sizeof(value);
+        }
+        return value;
+    }
+
+    std::string readString() {
+        uint32_t size = readUInt32();
+        if (this->offset + size > this->record.size()) {
+            size = (uint32_t)(this->record.size() - this->offset);
+        }
+        std::string value = this->record.substr(this->offset, size);
+        this->offset += size;
+        return value;
+    }
+
+private:
+    const std::string& record;
+    size_t offset;
+};
+
+// 子进程中的用例调用了exit()时，跳过全局对象的析构，直接以原来的退出码结束
+void
+exitChildImmediately(int status, void* arg) {
+    testing::internal::FlushInfoLog();
+    ::_exit(status);
+}
+
+} // namespace
+
+IsolatedExecutorImpl::ChildResult::ChildResult(IsolatedExecutorImpl* executor_in, int fd_in, unsigned int resume_in)
+    : runing_test(NULL)
+    , executor(executor_in)
+    , fd(fd_in)
+    , resume(resume_in) {}
+
+void
+IsolatedExecutorImpl::ChildResult::startSuite(CPPUNIT_NS::Test* test) {
+    int index = this->executor->indexOf(test);
+    if (index >= 0 && (unsigned int)index >= this->resume) {
+        send(RECORD_START_SUITE, test, NULL);
+    }
+}
+
+void
+IsolatedExecutorImpl::ChildResult::endSuite(CPPUNIT_NS::Test* test) {
+    // 内层Suite的TearDownTestCase()在外层Suite结束之前就已经执行完了
+    sendEndedSuites();
+
+    int index = this->executor->indexOf(test);
+    if (index >= 0 && this->executor->nodes[index].end > this->resume) {
+        this->ended_suites.push_back(test);
+    }
+}
+
+void
+IsolatedExecutorImpl::ChildResult::startTest(CPPUNIT_NS::Test* test) {
+    if (!isSkipped(test)) {
+        this->runing_test = test;
+        send(RECORD_START_TEST, test, NULL);
+    }
+}
+
+void
+IsolatedExecutorImpl::ChildResult::endTest(CPPUNIT_NS::Test* test) {
+    if (!isSkipped(test)) {
+        send(RECORD_END_TEST, test, NULL);
+        this->runing_test = NULL;
+    }
+}
+
+void
+IsolatedExecutorImpl::ChildResult::addError(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception) {
+    send(RECORD_ERROR, test, exception);
+
+    // 再交给基类通知TestListener（比如BenchmarkCaller要据此停止测量），exception由基类负责释放
+    CPPUNIT_NS::TestResult::addError(test, exception);
+}
+
+void
+IsolatedExecutorImpl::ChildResult::addFailure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception) {
+    send(RECORD_FAILURE, test, exception);
+    CPPUNIT_NS::TestResult::addFailure(test, exception);
+}
+
+bool
+IsolatedExecutorImpl::ChildResult::protect(
+    const CPPUNIT_NS::Functor& functor,
+    CPPUNIT_NS::Test* test,
+    const std::string& short_description) {
+    if (isSkipped(test)) {
+        return false;
+    }
+    return CPPUNIT_NS::TestResult::protect(functor, test, short_description);
+}
+
+void
+IsolatedExecutorImpl::ChildResult::done() {
+    send(RECORD_DONE, NULL, NULL);
+}
+
+void
+IsolatedExecutorImpl::ChildResult::sendEndedSuites() {
+    CppUnitVector<CPPUNIT_NS::Test*> suites;
+    suites.swap(this->ended_suites);
+
+    CppUnitVector<CPPUNIT_NS::Test*>::iterator it = suites.begin();
+    while (it != suites.end()) {
+        send(RECORD_END_SUITE, *it, NULL);
+        ++it;
+    }
+}
+
+bool
+IsolatedExecutorImpl::ChildResult::isSkipped(CPPUNIT_NS::Test* test) const {
+    int index = this->executor->indexOf(test);
+    return index >= 0 && (unsigned int)index < this->resume;
+}
+
+void
+IsolatedExecutorImpl::ChildResult::send(unsigned int type, CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception) {
+    if (RECORD_END_SUITE != type) {
+        sendEndedSuites();
+    }
+
+    std::string record;
+    appendUInt32(record, 0); // 长度最后再填
+    appendUInt32(record, type);
+    appendUInt32(record, (uint32_t)this->executor->indexOf(test));
+
+    if (exception) {
+        CPPUNIT_NS::SourceLine source_line = exception->sourceLine();
+        appendUInt32(record, (uint32_t)source_line.lineNumber());
+        appendString(record, source_line.fileName());
+
+        CPPUNIT_NS::Message message = exception->message();
+        appendString(record, message.shortDescription());
+        appendUInt32(record, (uint32_t)message.detailCount());
+        for (int index = 0; index < message.detailCount(); ++index) {
+            appendString(record, message.detailAt(index));
+        }
+    }
+
+    if (RECORD_END_TEST == type) {
+        BenchmarkTest* benchmark = dynamic_cast<BenchmarkTest*>(test);
+        const BenchmarkResult* result = benchmark ? benchmark->benchmarkResult() : NULL;
+        appendUInt32(record, result ? 1 : 0);
+        if (result) {
+            appendUInt64(record, result->iterations);
+            appendUInt32(record, (uint32_t)result->samples_ns.size());
+            for (size_t index = 0; index < result->samples_ns.size(); ++index) {
+                appendDouble(record, result->samples_ns[index]);
+            }
+        }
+    }
+
+    uint32_t size = (uint32_t)(record.size() - sizeof(size));
+    ::memcpy(&record[0], &size, sizeof(size));
+
+    size_t offset = 0;
+    while (offset < record.size()) {
+        ssize_t written = ::write(this->fd, record.data() + offset, record.size() - offset);
+        if (written > 0) {
+            offset += written;
+        } else if (written < 0 && EINTR == errno) {
+            continue;
+        } else {
+            break; // 父进程已经不再读取了
+        }
+    }
+}
+
+IsolatedExecutorImpl::IsolatedExecutorImpl(CPPUNIT_NS::Test* test)
+    : IsolatedExecutor(test)
+    , child_result(NULL)
+    , running(-1)
+    , resume(0) {}
+
+IsolatedExecutorImpl::~IsolatedExecutorImpl() {}
+
+void
+IsolatedExecutorImpl::buildNodes(CPPUNIT_NS::Test* test, int parent) {
+    unsigned int index = (unsigned int)this->nodes.size();
+
+    Node node;
+    node.test = test;
+    node.parent = parent;
+    node.end = index + 1;
+    node.is_leaf = (NULL == dynamic_cast<CPPUNIT_NS::TestComposite*>(test));
+    this->nodes.push_back(node);
+    this->indexes[test] = index;
+
+    int count = test->getChildTestCount();
+    for (int child = 0; child < count; ++child) {
+        buildNodes(test->getChildTestAt(child), (int)index);
+    }
+    this->nodes[index].end = (unsigned int)this->nodes.size();
+}
+
+int
+IsolatedExecutorImpl::indexOf(CPPUNIT_NS::Test* test) const {
+    Indexes::const_iterator it = this->indexes.find(test);
+    if (it == this->indexes.end()) {
+        return -1;
+    }
+    return (int)it->second;
+}
+
+void
+IsolatedExecutorImpl::run(CPPUNIT_NS::TestResult* controller) {
+    this->nodes.clear();
+    this->indexes.clear();
+    this->opened_suites.clear();
+    buildNodes(m_test, -1);
+
+    bool always_on_main_thread = Runner::instance()->alwaysCallTestOnMainThread();
+
+    // 根Suite本身没有SetUpTestCase/TearDownTestCase，直接通知controller即可
+    controller->startSuite(m_test);
+
+    // 根Suite的子节点从下标1开始，连续的可隔离子节点组成一个分片
+    unsigned int shard_begin = 1;
+    unsigned int index = 1;
+    while (index < this->nodes.size()) {
+        const Node& node = this->nodes[index];
+        if (always_on_main_thread || ParallelExecutor::isMainThreadBound(node.test)) {
+            if (shard_begin < index) {
+                runShard(controller, shard_begin, index);
+            }
+            if (controller->shouldStop()) {
+                break;
+            }
+
+            node.test->run(controller);
+            shard_begin = node.end;
+        }
+        index = node.end;
+    }
+
+    if (shard_begin < index && !controller->shouldStop()) {
+        runShard(controller, shard_begin, index);
+    }
+
+    controller->endSuite(m_test);
+}
+
+bool
+IsolatedExecutorImpl::addFailure(bool is_error, CPPUNIT_NS::Exception* exception) {
+    if (!this->child_result) {
+        return false;
+    }
+
+    if (is_error) {
+        this->child_result->addError(this->child_result->runing_test, exception);
+    } else {
+        this->child_result->addFailure(this->child_result->runing_test, exception);
+    }
+    return true;
+}
+
+void
+IsolatedExecutorImpl::runShard(CPPUNIT_NS::TestResult* controller, unsigned int begin, unsigned int end) {
+    this->resume = begin;
+    this->running = -1;
+
+    while (this->resume < end && !controller->shouldStop()) {
+        int fds[2];
+        if (0 != ::pipe2(fds, O_CLOEXEC)) {
+            controller->addError(m_test, new CPPUNIT_NS::Exception(
+                CPPUNIT_NS::Message("pipe() failed", testing::internal::GetLastErrnoDescription())));
+            break;
+        }
+
+        // 和death test一样，fork之前先flush，避免缓冲区中的内容在父子进程中各输出一次
+        testing::internal::FlushInfoLog();
+
+        pid_t pid = ::fork();
+        if (0 == pid) {
+            ::close(fds[0]);
+            runOnChild(fds[1], begin, end);
+        }
+
+        ::close(fds[1]);
+        if (pid < 0) {
+            ::close(fds[0]);
+            controller->addError(m_test, new CPPUNIT_NS::Exception(
+                CPPUNIT_NS::Message("fork() failed", testing::internal::GetLastErrnoDescription())));
+            break;
+        }
+
+        bool is_done = receive(controller, fds[0], pid);
+        ::close(fds[0]);
+
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && EINTR == errno) {
+        }
+
+        if (is_done) {
+            break;
+        }
+
+        if (controller->shouldStop()) {
+            // 子进程是被stop()结束的，不算崩溃
+            if (this->running >= 0) {
+                controller->endTest(this->nodes[this->running].test);
+                this->running = -1;
+            }
+            break;
+        }
+
+        reportCrash(controller, status, end);
+    }
+
+    closeAllSuites(controller);
+}
+
+IsolatedExecutorImpl::ChildWorker::ChildWorker(IsolatedExecutorImpl* executor_in, unsigned int begin_in, unsigned int end_in)
+    : completed(1)
+    , executor(executor_in)
+    , begin(begin_in)
+    , end(end_in) {}
+
+void
+IsolatedExecutorImpl::ChildWorker::run() {
+    unsigned int index = this->begin;
+    while (index < this->end) {
+        const Node& node = this->executor->nodes[index];
+        if (node.end > this->executor->resume) {
+            node.test->run(this->executor->child_result);
+        }
+        index = node.end;
+    }
+
+    this->completed.countDown();
+}
+
+void
+IsolatedExecutorImpl::runOnChild(int fd, unsigned int begin, unsigned int end) {
+    ChildResult result(this, fd, this->resume);
+    this->child_result = &result;
+    ::on_exit(exitChildImmediately, NULL);
+
+    RunnerImpl* runner = static_cast<RunnerImpl*>(Runner::instance());
+    runner->resetAfterFork();
+    if (runner->regressionGate()->hasBaseline()) {
+        result.pushProtector(runner->regressionGate()->createTimer());
+    }
+
+    ChildWorker worker(this, begin, end);
+    Thread* thread = Thread::createInstance(&worker);
+    worker.completed.await();
+    thread->destroy();
+
+    result.done();
+    testing::internal::FlushInfoLog();
+
+    // 不能调用exit()，全局的Runner对象析构时会一直等待用例结束
+    ::_exit(0);
+}
+
+bool
+IsolatedExecutorImpl::receive(CPPUNIT_NS::TestResult* controller, int fd, pid_t pid) {
+    std::string buffer;
+    bool is_killed = false;
+
+    while (true) {
+        // 先处理所有完整的记录
+        size_t offset = 0;
+        while (buffer.size() - offset >= sizeof(uint32_t)) {
+            uint32_t size = 0;
+            ::memcpy(&size, buffer.data() + offset, sizeof(size));
+            if (buffer.size() - offset - sizeof(size) < size) {
+                break;
+            }
+
+            if (dispatch(controller, buffer.substr(offset + sizeof(size), size))) {
+                return true;
+            }
+            offset += sizeof(size) + size;
+        }
+        buffer.erase(0, offset);
+
+        // 定时醒来检查是否被stop()，子进程中的用例可能一直不结束
+        struct pollfd item;
+        item.fd = fd;
+        item.events = POLLIN;
+        item.revents = 0;
+        int ready = ::poll(&item, 1, 100);
+        if (ready < 0 && EINTR != errno) {
+            return false;
+        }
+
+        if (ready <= 0) {
+            if (!is_killed && controller->shouldStop()) {
+                ::kill(pid, SIGKILL);
+                is_killed = true;
+            }
+            continue;
+        }
+
+        char chunk[4096];
+        ssize_t size = ::read(fd, chunk, sizeof(chunk));
+        if (size > 0) {
+            buffer.append(chunk, size);
+        } else if (0 == size) {
+            return false; // 子进程已经退出
+        } else if (EINTR != errno && EAGAIN != errno) {
+            return false;
+        }
+    }
+}
+
+bool
+IsolatedExecutorImpl::dispatch(CPPUNIT_NS::TestResult* controller, const std::string& record) {
+    RecordReader reader(record);
+    unsigned int type = reader.readUInt32();
+    int index = (int)reader.readUInt32();
+
+    CPPUNIT_NS::Test* test = NULL;
+    if (index >= 0 && (unsigned int)index < this->nodes.size()) {
+        test = this->nodes[index].test;
+    }
+
+    switch (type) {
+    case RECORD_START_SUITE:
+        if (test) {
+            openSuites(controller, index);
+        }
+        break;
+    case RECORD_END_SUITE:
+        if (test) {
+            closeSuites(controller, (unsigned int)index);
+        }
+        break;
+    case RECORD_START_TEST:
+        if (test) {
+            openSuites(controller, this->nodes[index].parent);
+            controller->startTest(test);
+            this->running = index;
+        }
+        break;
+    case RECORD_END_TEST:
+        if (test && reader.readUInt32()) {
+            // 只传回样本，统计值在这里重新计算，和子进程中的结果完全相同
+            BenchmarkResult result;
+            result.iterations = reader.readUInt64();
+            unsigned int count = reader.readUInt32();
+            for (unsigned int sample = 0; sample < count; ++sample) {
+                result.samples_ns.push_back(reader.readDouble());
+            }
+            computeBenchmarkStatistics(result);
+
+            BenchmarkTest* benchmark = dynamic_cast<BenchmarkTest*>(test);
+            if (benchmark) {
+                benchmark->setBenchmarkResult(result);
+            }
+        }
+        if (test) {
+            controller->endTest(test);
+            this->running = -1;
+            this->resume = (unsigned int)index + 1;
+        }
+        break;
+    case RECORD_ERROR:
+    case RECORD_FAILURE: {
+        int line = (int)reader.readUInt32();
+        std::string file = reader.readString();
+        CPPUNIT_NS::Message message(reader.readString());
+        unsigned int count = reader.readUInt32();
+        for (unsigned int detail = 0; detail < count; ++detail) {
+            message.addDetail(reader.readString());
+        }
+
+        // 没有指明用例时（比如在用例之外调用了Runner::addFailure()），记录到正在执行的用例上
+        if (!test) {
+            test = this->running >= 0 ? this->nodes[this->running].test : m_test;
+        }
+
+        CPPUNIT_NS::Exception* exception = new CPPUNIT_NS::Exception(message, CPPUNIT_NS::SourceLine(file, line));
+        if (RECORD_ERROR == type) {
+            controller->addError(test, exception);
+        } else {
+            controller->addFailure(test, exception);
+        }
+        break;
+    }
+    case RECORD_DONE:
+        return true;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+void
+IsolatedExecutorImpl::reportCrash(CPPUNIT_NS::TestResult* controller, int status, unsigned int end) {
+    CPPUNIT_NS::Message message("Test process exited unexpectedly", testing::internal::ExitSummary(status));
+
+    if (this->running >= 0) {
+        CPPUNIT_NS::Test* test = this->nodes[this->running].test;
+        controller->addError(test, new CPPUNIT_NS::Exception(message));
+        controller->endTest(test);
+        this->resume = (unsigned int)this->running + 1;
+        this->running = -1;
+        return;
+    }
+
+    // 崩溃发生在用例之外，比如TearDownTestCase()中，此时这个Suite的用例都已经执行完了
+    if (!this->opened_suites.empty()) {
+        unsigned int suite = this->opened_suites.back();
+        if (this->nodes[suite].end <= this->resume) {
+            controller->addError(this->nodes[suite].test, new CPPUNIT_NS::Exception(message));
+            closeSuites(controller, suite);
+            return;
+        }
+    }
+
+    /*
+        比如SetUpTestCase()中崩溃，记录到下一个用例上，并从它之后继续执行，
+        保证每次重新fork都至少前进一个用例
+    */
+    unsigned int next = this->resume;
+    while (next < end && !this->nodes[next].is_leaf) {
+        ++next;
+    }
+
+    if (next < end) {
+        CPPUNIT_NS::Test* test = this->nodes[next].test;
+        openSuites(controller, this->nodes[next].parent);
+        controller->startTest(test);
+        controller->addError(test, new CPPUNIT_NS::Exception(message));
+        controller->endTest(test);
+        this->resume = next + 1;
+    } else {
+        controller->addError(m_test, new CPPUNIT_NS::Exception(message));
+        this->resume = end;
+    }
+}
+
+void
+IsolatedExecutorImpl::openSuites(CPPUNIT_NS::TestResult* controller, int index) {
+    // 根Suite由run()负责通知
+    if (index <= 0) {
+        return;
+    }
+
+    openSuites(controller, this->nodes[index].parent);
+
+    if (std::find(this->opened_suites.begin(), this->opened_suites.end(), (unsigned int)index) == this->opened_suites.end()) {
+        controller->startSuite(this->nodes[index].test);
+        this->opened_suites.push_back((unsigned int)index);
+    }
+}
+
+void
+IsolatedExecutorImpl::closeSuites(CPPUNIT_NS::TestResult* controller, unsigned int index) {
+    if (std::find(this->opened_suites.begin(), this->opened_suites.end(), index) == this->opened_suites.end()) {
+        return;
+    }
+
+    while (!this->opened_suites.empty()) {
+        unsigned int suite = this->opened_suites.back();
+        this->opened_suites.pop_back();
+        controller->endSuite(this->nodes[suite].test);
+
+        if (suite == index) {
+            break;
+        }
+    }
+}
+
+void
+IsolatedExecutorImpl::closeAllSuites(CPPUNIT_NS::TestResult* controller) {
+    while (!this->opened_suites.empty()) {
+        unsigned int suite = this->opened_suites.back();
+        this->opened_suites.pop_back();
+        controller->endSuite(this->nodes[suite].test);
+    }
+}
+
+CUTEST_NS_END
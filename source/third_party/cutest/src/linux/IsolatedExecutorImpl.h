@@ -0,0 +1,140 @@
+﻿#pragma once
+
+#include "../IsolatedExecutor.h"
+
+#include "cutest/CountDownLatch.h"
+#include "cutest/Runnable.h"
+
+#include <cppunit/TestResult.h>
+#include <cppunit/portability/CppUnitVector.h>
+#include <map>
+#include <string>
+#include <sys/types.h>
+
+CUTEST_NS_BEGIN
+
+/*
+    Linux上的进程隔离执行器，见Runner::setProcessIsolation()：
+    - 用例树在fork之前已经由TestFactoryRegistry::makeTest()构造好，子进程直接继承，不需要再加载和注册一遍；
+    - 根Suite下连续的可隔离Suite组成一个分片，由一个子进程依次执行，事件以记录的形式通过管道回传，
+      调用run()的线程（即Decorator的工作线程）收到后立即转发给controller；
+    - 子进程崩溃时，把崩溃记录到正在执行的用例上，再fork新的子进程，从下一个用例继续执行；
+    - 必须在主线程执行的Suite直接在当前进程中执行；
+    - 同一时刻只有一个子进程，不和ParallelExecutor组合，所以进程隔离时用例不会并行执行；
+    - 从gtest的death test中只复用了ExitSummary()：death test的子进程只执行一条语句、只回传是否通过，
+      不能逐个用例地回传事件，所以记录和管道的读写是单独实现的。
+*/
+class IsolatedExecutorImpl : public IsolatedExecutor {
+public:
+    explicit IsolatedExecutorImpl(CPPUNIT_NS::Test* test);
+    virtual ~IsolatedExecutorImpl();
+
+    virtual void run(CPPUNIT_NS::TestResult* controller) override;
+    virtual bool addFailure(bool is_error, CPPUNIT_NS::Exception* exception) override;
+
+protected:
+    // 用例树中的一个节点，nodes按先序排列，在父子进程中完全相同，所以记录中用下标来指代Test
+    struct Node {
+        CPPUNIT_NS::Test* test;
+        int parent;        // 父节点的下标，根节点为-1
+        unsigned int end;  // 子树结束的位置（不含）
+        bool is_leaf;
+    };
+    typedef CppUnitVector<Node> Nodes;
+    typedef std::map<CPPUNIT_NS::Test*, unsigned int> Indexes;
+    Nodes nodes;
+    Indexes indexes;
+
+    void buildNodes(CPPUNIT_NS::Test* test, int parent);
+    int indexOf(CPPUNIT_NS::Test* test) const; // 不在用例树中时返回-1
+
+    enum RecordType {
+        RECORD_START_SUITE = 1,
+        RECORD_END_SUITE,
+        RECORD_START_TEST,
+        RECORD_END_TEST,
+        RECORD_ERROR,
+        RECORD_FAILURE,
+        RECORD_DONE,    // 子进程正常执行完整个分片
+    };
+
+    /*
+        子进程中使用的TestResult，把事件编码成记录写到管道中：
+        - 下标小于resume的用例已经由之前的子进程执行过，跳过它们，也不再通知；
+        - 只有子树中还有未执行用例的Suite才通知其结束；
+        - Suite结束的通知推迟到下一条记录之前发送，这时TearDownTestCase()已经执行完，
+          如果在其中崩溃，父进程可以把崩溃记录到这个Suite上。
+    */
+    class ChildResult : public CPPUNIT_NS::TestResult {
+    public:
+        ChildResult(IsolatedExecutorImpl* executor, int fd, unsigned int resume);
+
+        virtual void startSuite(CPPUNIT_NS::Test* test) override;
+        virtual void endSuite(CPPUNIT_NS::Test* test) override;
+        virtual void startTest(CPPUNIT_NS::Test* test) override;
+        virtual void endTest(CPPUNIT_NS::Test* test) override;
+        virtual void addError(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception) override;
+        virtual void addFailure(CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception) override;
+        virtual bool protect(
+            const CPPUNIT_NS::Functor& functor,
+            CPPUNIT_NS::Test* test,
+            const std::string& short_description) override;
+
+        void done();
+
+        CPPUNIT_NS::Test* runing_test;
+
+    protected:
+        IsolatedExecutorImpl* executor;
+        int fd;
+        unsigned int resume;
+
+        CppUnitVector<CPPUNIT_NS::Test*> ended_suites; // 尚未通知结束的Suite
+
+        bool isSkipped(CPPUNIT_NS::Test* test) const;
+        void sendEndedSuites();
+        void send(unsigned int type, CPPUNIT_NS::Test* test, CPPUNIT_NS::Exception* exception);
+    };
+    ChildResult* child_result; // 只在子进程中不为NULL
+
+    /*
+        子进程中只剩下调用fork()的线程，由它充当子进程的主线程来驱动消息循环，
+        用例则在新建的工作线程上执行，这样依赖主线程的用例（比如delayRunOnMainThread()）仍然可以正常工作。
+    */
+    class ChildWorker : public Runnable {
+    public:
+        ChildWorker(IsolatedExecutorImpl* executor, unsigned int begin, unsigned int end);
+
+        // 实现Runnable::run()，在子进程的工作线程上执行
+        virtual void run() override;
+
+        CountDownLatch completed;
+
+    protected:
+        IsolatedExecutorImpl* executor;
+        unsigned int begin;
+        unsigned int end;
+    };
+
+    // 以下成员只在父进程中使用
+    CppUnitVector<unsigned int> opened_suites; // 已经通知controller开始、尚未结束的Suite，由外到内
+    int running;          // 子进程中正在执行的用例，-1表示没有
+    unsigned int resume;  // 下一个子进程从这个位置开始执行
+
+    // 用子进程执行[begin, end)范围内的节点，崩溃之后重新fork，直到执行完或者被停止
+    void runShard(CPPUNIT_NS::TestResult* controller, unsigned int begin, unsigned int end);
+
+    // 在子进程中执行，不会返回
+    void runOnChild(int fd, unsigned int begin, unsigned int end);
+
+    // 读取并转发子进程的记录，直到管道关闭，收到RECORD_DONE时返回true
+    bool receive(CPPUNIT_NS::TestResult* controller, int fd, pid_t pid);
+    bool dispatch(CPPUNIT_NS::TestResult* controller, const std::string& record);
+
+    void reportCrash(CPPUNIT_NS::TestResult* controller, int status, unsigned int end);
+    void openSuites(CPPUNIT_NS::TestResult* controller, int index); // 包括index及其所有祖先，根Suite除外
+    void closeSuites(CPPUNIT_NS::TestResult* controller, unsigned int index); // 从最内层一直关闭到index
+    void closeAllSuites(CPPUNIT_NS::TestResult* controller);
+};
+
+CUTEST_NS_END
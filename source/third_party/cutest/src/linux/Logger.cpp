@@ -0,0 +1,219 @@
+﻿#include "../Logger.h"
+
+#include <cppunit/Test.h>
+#include <cppunit/TestFailure.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "cutest/Helper.h"
+#include "cutest/Runner.h"
+#include "gtest/gtest-export.h"
+
+using namespace testing::internal;
+
+CUTEST_NS_BEGIN
+
+void
+printColorString(GTestColor color, const char* format, ...) {
+    char buffer[1024] = {0};
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    ColoredPrintf(color, "%s", buffer);
+}
+
+// __FILE__是绝对路径时原样输出，makeFilePathShorter()会去掉开头的'/'；只规范化相对路径
+std::string
+formatFilePath(const std::string& path) {
+    return (!path.empty() && '/' == path[0]) ? path : makeFilePathShorter(path);
+}
+
+void
+printString(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+
+    fflush(stdout);
+}
+
+Logger::Logger()
+    : passed_test_cases(0)
+    , first_failure_of_a_test(true) {}
+
+void
+Logger::onRunnerStart(CPPUNIT_NS::Test* test) {
+    this->passed_test_cases = 0;
+    this->failed_test_cases.clear();
+
+    printColorString(COLOR_GREEN,  "[==========] ");
+    printString("Running %s from %s.\n",
+                testing::FormatTestCount(Runner::instance()->countTestCases(test)).c_str(),
+                test->getName().c_str());
+}
+
+void
+Logger::onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
+    printColorString(COLOR_GREEN,  "[==========] ");
+    printString("%s from %s ran. (%s ms total)\n",
+                testing::FormatTestCount(Runner::instance()->countTestCases(test)).c_str(),
+                test->getName().c_str(),
+                formatElapsedMs(elapsed_ns).c_str());
+
+    printColorString(COLOR_GREEN,  "[  PASSED  ] ");
+    printString("%s.\n", testing::FormatTestCount(this->passed_test_cases).c_str());
+
+    if (this->failed_test_cases.size()) {
+        printColorString(COLOR_RED,  "[  FAILED  ] ");
+        printString("%s, listed below:\n", testing::FormatTestCount((int)this->failed_test_cases.size()).c_str());
+
+        std::list<std::string>::iterator it = this->failed_test_cases.begin();
+        while (it != this->failed_test_cases.end()) {
+            printColorString(COLOR_RED,  "[  FAILED  ] ");
+            printString("%s\n", it->c_str());
+            ++it;
+        }
+
+        printString("\n%2d FAILED %s\n", (int)this->failed_test_cases.size(),
+                    this->failed_test_cases.size() == 1 ? "TEST" : "TESTS");
+    }
+}
+
+void
+Logger::onSuiteStart(CPPUNIT_NS::Test* suite) {
+    printColorString(COLOR_GREEN, "[----------] ");
+    printString("%s from %s\n",
+                testing::FormatTestCount(Runner::instance()->countTestCases(suite)).c_str(),
+                suite->getName().c_str());
+}
+
+void
+Logger::onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns) {
+    printColorString(COLOR_GREEN, "[----------] ");
+    printString("%s from %s (%s ms total)\n\n",
+                testing::FormatTestCount(Runner::instance()->countTestCases(suite)).c_str(),
+                suite->getName().c_str(),
+                formatElapsedMs(elapsed_ns).c_str());
+}
+
+void
+Logger::onTestStart(CPPUNIT_NS::Test* test) {
+    printColorString(COLOR_GREEN,  "[ RUN      ] ");
+    printString("%s\n", test->getName().c_str());
+    this->first_failure_of_a_test = true;
+}
+
+void
+Logger::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) {
+    if (this->first_failure_of_a_test) {
+        printString("\n");
+    }
+
+    // 没有出错位置的失败（如性能退化）只输出描述
+    if (!failure.sourceLine().isValid()) {
+        printString("%s: %s\n",
+                    failure.isError() ? "error" : "failure",
+                    failure.thrownException()->what());
+    } else if (failure.isError()) {
+        printString("%s:%u: error: %s\n",
+                    formatFilePath(failure.sourceLine().fileName()).c_str(),
+                    failure.sourceLine().lineNumber(),
+                    failure.thrownException()->what());
+    } else {
+        printString("%s:%u: failure: %s\n",
+                    formatFilePath(failure.sourceLine().fileName()).c_str(),
+                    failure.sourceLine().lineNumber(),
+                    failure.thrownException()->what());
+    }
+    this->first_failure_of_a_test = false;
+}
+
+void
+Logger::onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<OmittedFailure>& omitted) {
+    if (this->first_failure_of_a_test) {
+        printString("\n");
+    }
+
+    for (size_t i = 0; i < omitted.size(); ++i) {
+        const OmittedFailure& failure = omitted[i];
+        if (!failure.source_line.isValid()) {
+            printString("%s omitted %u times, the first one: %s\n",
+                        failure.is_error ? "error" : "failure",
+                        failure.count,
+                        failure.message.c_str());
+        } else {
+            printString("%s:%u: %s omitted %u times, the first one: %s\n",
+                        formatFilePath(failure.source_line.fileName()).c_str(),
+                        failure.source_line.lineNumber(),
+                        failure.is_error ? "error" : "failure",
+                        failure.count,
+                        failure.message.c_str());
+        }
+    }
+    this->first_failure_of_a_test = false;
+}
+
+void
+Logger::onBenchmarkEnd(CPPUNIT_NS::Test* test, const BenchmarkResult& result) {
+    printColorString(COLOR_GREEN,  "[ BENCHMARK] ");
+    printString("%s: mean %s (95%% CI %s ~ %s), median %s, p99 %s, %u samples x %llu iterations, %u outliers\n",
+                test->getName().c_str(),
+                formatDuration(result.mean_ns).c_str(),
+                formatDuration(result.ci_low_ns).c_str(),
+                formatDuration(result.ci_high_ns).c_str(),
+                formatDuration(result.median_ns).c_str(),
+                formatDuration(result.p99_ns).c_str(),
+                (unsigned int)result.samples_ns.size(),
+                result.iterations,
+                result.outliers);
+}
+
+void
+Logger::onRegressionReport(const CppUnitVector<Regression>& regressions) {
+    printColorString(COLOR_YELLOW, "[REGRESSION] ");
+    printString("%s slower than the performance baseline, ranked by slowdown:\n",
+                testing::FormatTestCount((int)regressions.size()).c_str());
+
+    for (size_t index = 0; index < regressions.size(); ++index) {
+        const Regression& regression = regressions[index];
+        double baseline_ns = regression.baseline_ns > 1 ? regression.baseline_ns : 1;
+
+        printColorString(COLOR_YELLOW, "[REGRESSION] ");
+        printString("%+7.1f%% %s: %s%s -> %s",
+                    (regression.current_ns / baseline_ns - 1) * 100,
+                    regression.name.c_str(),
+                    regression.is_benchmark ? "median per iteration " : "",
+                    formatDuration(regression.baseline_ns).c_str(),
+                    formatDuration(regression.current_ns).c_str());
+        if (regression.p_value >= 0) {
+            printString(", p = %.2g", regression.p_value);
+        }
+        printString("\n");
+    }
+}
+
+void
+Logger::onTestEndNs(
+    CPPUNIT_NS::Test* test,
+    unsigned int error_count,
+    unsigned int failure_count,
+    unsigned long long elapsed_ns) {
+    if (0 == error_count && 0 == failure_count) {
+        printColorString(COLOR_GREEN,  "[       OK ] ");
+        printString("%s (%s ms)\n",
+                    test->getName().c_str(),
+                    formatElapsedMs(elapsed_ns).c_str());
+        ++this->passed_test_cases;
+    } else {
+        printColorString(COLOR_RED,  "[  FAILED  ] ");
+        printString("%s (%s ms)\n",
+                    test->getName().c_str(),
+                    formatElapsedMs(elapsed_ns).c_str());
+        this->failed_test_cases.push_back(test->getName());
+    }
+}
+
+CUTEST_NS_END
@@ -0,0 +1,329 @@
+﻿#include "RunnerImpl.h"
+#include "IsolatedExecutorImpl.h"
+#include "../Thread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <signal.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gmock/gmock.h"
+
+CUTEST_NS_BEGIN
+
+void
+initGoogleMock() {
+    static bool init_once = true;
+    if (init_once) {
+        init_once = false;
+
+        // Linux上没有__argc/__wargv，从/proc/self/cmdline还原命令行参数，以支持--gtest_filter等参数
+        std::vector<std::string> args;
+        int fd = ::open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            std::string cmdline;
+            char buffer[4096];
+            ssize_t size = 0;
+            while ((size = ::read(fd, buffer, sizeof(buffer))) > 0) {
+                cmdline.append(buffer, size);
+            }
+            ::close(fd);
+
+            std::string::size_type start = 0;
+            while (start < cmdline.size()) {
+                std::string::size_type end = cmdline.find('\0', start);
+                if (std::string::npos == end) {
+                    end = cmdline.size();
+                }
+                args.push_back(cmdline.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+
+        std::vector<char*> argv;
+        for (size_t i = 0; i < args.size(); ++i) {
+            argv.push_back(&args[i][0]);
+        }
+        argv.push_back(NULL);
+
+        int argc = (int)args.size();
+        if (argc) {
+            testing::InitGoogleMock(&argc, &argv[0]);
+        }
+    }
+}
+
+unsigned long long
+tickCount64() {
+    return CUTEST_NS::tickCountNs() / 1000000;
+}
+
+unsigned long long
+tickCountNs() {
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    unsigned long long sec = now.tv_sec;
+    return (sec * 1000000000ULL + now.tv_nsec);
+}
+
+thread_id
+currentThreadId() {
+    return (thread_id)::syscall(SYS_gettid);
+}
+
+Runner*
+Runner::instance() {
+    static RunnerImpl runner_impl;
+    return &runner_impl;
+}
+
+RunnerImpl::RunnerImpl()
+    : epoll_fd(-1)
+    , event_fd(-1)
+    , timer_fd(-1) {
+    initGoogleMock();
+    this->listener_manager.add(&this->test_progress_logger);
+
+    ::pthread_mutex_init(&this->tasks_mutex, NULL);
+    createEventFds();
+
+    // 通过这个异步方法给main_thread_id赋值
+    asyncRunOnMainThread(this, false);
+}
+
+void
+RunnerImpl::createEventFds() {
+    this->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    this->event_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    this->timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = this->event_fd;
+    ::epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->event_fd, &event);
+
+    event.events = EPOLLIN;
+    event.data.fd = this->timer_fd;
+    ::epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->timer_fd, &event);
+}
+
+void
+RunnerImpl::resetAfterFork() {
+    // 这些fd和父进程共享同一个内核对象，继续使用会唤醒父进程的消息循环
+    ::close(this->timer_fd);
+    ::close(this->event_fd);
+    ::close(this->epoll_fd);
+    createEventFds();
+
+    // fork时其他线程可能正持有锁，子进程中只剩当前线程，直接重新初始化
+    ::pthread_mutex_init(&this->tasks_mutex, NULL);
+
+    // 这些任务属于父进程，由父进程负责执行和删除
+    this->async_tasks.clear();
+    this->timer_wheel.resetAfterFork(Thread::createLock());
+
+    RunnerBase::main_thread_id = CUTEST_NS::currentThreadId();
+}
+
+RunnerImpl::~RunnerImpl() {
+    waitUntilAllTestEnd();
+
+    ::close(this->timer_fd);
+    ::close(this->event_fd);
+    ::close(this->epoll_fd);
+
+    // 删除尚未执行且需要auto delete的Runnable对象
+    AsyncTasks::iterator async_it = this->async_tasks.begin();
+    while (async_it != this->async_tasks.end()) {
+        if (async_it->is_auto_delete) {
+            delete async_it->runnable;
+        }
+        ++async_it;
+    }
+
+    ::pthread_mutex_destroy(&this->tasks_mutex);
+}
+
+IsolatedExecutor*
+RunnerImpl::createIsolatedExecutor(CPPUNIT_NS::Test* test) {
+    return new IsolatedExecutorImpl(test);
+}
+
+/*
+    事件流的写函数：读端关闭之后写管道或socket会产生SIGPIPE，默认会结束进程。
+    写入期间只在当前线程屏蔽SIGPIPE，写入失败时取走这次写入产生的SIGPIPE，不改变整个进程的信号处理；
+    写入失败之后由EventStream停止输出
+*/
+static ssize_t
+writeEventStream(void* cookie, const char* buffer, size_t size) {
+    int fd = (int)(intptr_t)cookie;
+
+    sigset_t sigpipe_set;
+    ::sigemptyset(&sigpipe_set);
+    ::sigaddset(&sigpipe_set, SIGPIPE);
+
+    sigset_t pending;
+    ::sigpending(&pending);
+    bool was_pending = ::sigismember(&pending, SIGPIPE);
+
+    sigset_t old_set;
+    ::pthread_sigmask(SIG_BLOCK, &sigpipe_set, &old_set);
+
+    size_t written = 0;
+    bool failed = false;
+    while (written < size) {
+        ssize_t ret = ::write(fd, buffer + written, size - written);
+        if (ret < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            failed = true;
+            break;
+        }
+        written += ret;
+    }
+
+    if (failed && EPIPE == errno && !was_pending) {
+        int saved_errno = errno;
+        struct timespec no_wait = {0, 0};
+        ::sigtimedwait(&sigpipe_set, NULL, &no_wait);
+        errno = saved_errno;
+    }
+    ::pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+    return failed ? -1 : (ssize_t)written;
+}
+
+static int
+closeEventStream(void* cookie) {
+    return ::close((int)(intptr_t)cookie);
+}
+
+// 用fd打开事件流，写入时不会因为SIGPIPE结束进程，见writeEventStream()
+static FILE*
+openEventStreamFile(int fd) {
+    cookie_io_functions_t functions;
+    ::memset(&functions, 0, sizeof(functions));
+    functions.write = writeEventStream;
+    functions.close = closeEventStream;
+
+    FILE* file = ::fopencookie((void*)(intptr_t)fd, "w", functions);
+    if (!file) {
+        ::close(fd);
+    }
+    return file;
+}
+
+FILE*
+RunnerImpl::openEventStream(const char* target) {
+    const char prefix[] = "unix:";
+    if (0 != ::strncmp(target, prefix, sizeof(prefix) - 1)) {
+        // 文件或者命名管道
+        int fd = ::open(target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        return fd < 0 ? NULL : openEventStreamFile(fd);
+    }
+
+    struct sockaddr_un address;
+    ::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    const char* path = target + sizeof(prefix) - 1;
+    if (::strlen(path) >= sizeof(address.sun_path)) {
+        return NULL;
+    }
+    ::strcpy(address.sun_path, path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (::connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        ::close(fd);
+        return NULL;
+    }
+
+    return openEventStreamFile(fd);
+}
+
+void
+RunnerImpl::asyncRunOnMainThread(Runnable* runnable, bool is_auto_delete) {
+    ::pthread_mutex_lock(&this->tasks_mutex);
+    this->async_tasks.push_back(Task(runnable, is_auto_delete));
+    ::pthread_mutex_unlock(&this->tasks_mutex);
+
+    wakeUp();
+}
+
+void
+RunnerImpl::wakeUp() {
+    uint64_t value = 1;
+    ssize_t ret = ::write(this->event_fd, &value, sizeof(value));
+    (void)ret;
+}
+
+void
+RunnerImpl::arm(unsigned long long due_ms) {
+    struct itimerspec spec = {{0, 0}, {0, 0}};
+    spec.it_value.tv_sec = due_ms / 1000;
+    spec.it_value.tv_nsec = (long)(due_ms % 1000) * 1000000L;
+    if (0 == spec.it_value.tv_sec && 0 == spec.it_value.tv_nsec) {
+        spec.it_value.tv_nsec = 1; // 全0表示停止Timer
+    }
+
+    ::timerfd_settime(this->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+void
+RunnerImpl::processEvents(int timeout_ms) {
+    struct epoll_event events[2];
+    int count = ::epoll_wait(this->epoll_fd, events, 2, timeout_ms);
+
+    for (int i = 0; i < count; ++i) {
+        uint64_t value = 0;
+        ssize_t ret = ::read(events[i].data.fd, &value, sizeof(value));
+        (void)ret;
+
+        if (events[i].data.fd == this->event_fd) {
+            runAsyncTasks();
+        } else if (events[i].data.fd == this->timer_fd) {
+            this->timer_wheel.expire(CUTEST_NS::tickCount64());
+        }
+    }
+}
+
+void
+RunnerImpl::runAsyncTasks() {
+    AsyncTasks tasks;
+    ::pthread_mutex_lock(&this->tasks_mutex);
+    tasks.swap(this->async_tasks);
+    ::pthread_mutex_unlock(&this->tasks_mutex);
+
+    // 在锁外执行，Runnable::run()里面可能会再次投递任务
+    AsyncTasks::iterator it = tasks.begin();
+    while (it != tasks.end()) {
+        it->runnable->run();
+        if (it->is_auto_delete) {
+            delete it->runnable;
+        }
+        ++it;
+    }
+}
+
+void
+RunnerImpl::waitUntilAllTestEnd() {
+    while (STATE_NONE != this->state) {
+        processEvents(-1);
+    }
+}
+
+CUTEST_NS_END
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include "../Logger.h"
+#include "../RunnerBase.h"
+
+#include <deque>
+#include <pthread.h>
+
+CUTEST_NS_BEGIN
+
+class RunnerImpl
+    : public RunnerBase {
+public:
+    RunnerImpl();
+    virtual ~RunnerImpl();
+
+protected:
+    Logger test_progress_logger;
+
+    virtual IsolatedExecutor* createIsolatedExecutor(CPPUNIT_NS::Test* test) override;
+    virtual FILE* openEventStream(const char* target) override;
+
+public:
+    // Runner的接口实现
+    virtual void asyncRunOnMainThread(Runnable* runnable, bool is_auto_delete);
+
+    virtual void waitUntilAllTestEnd();
+
+    /*
+        在当前线程（即主线程）处理一轮消息循环：
+        - timeout_ms为-1表示一直等待，直到有异步任务或者时间轮中的Timer需要执行；
+        - timeout_ms为0表示只处理已经就绪的任务，不等待。
+        除waitUntilAllTestEnd()之外，CountDownLatchImpl在主线程等待时也通过它来驱动消息循环。
+    */
+    void processEvents(int timeout_ms);
+
+    // 唤醒正在processEvents()中等待的主线程，可以在任意线程调用
+    void wakeUp();
+
+    /*
+        fork之后在子进程中调用：重新创建消息循环用到的fd，丢弃从父进程继承来的任务和Timer，
+        并把当前线程作为子进程的主线程，见IsolatedExecutorImpl。
+    */
+    void resetAfterFork();
+
+protected:
+    struct Task {
+        Task(Runnable* runnable_in, bool is_auto_delete_in)
+            : runnable(runnable_in)
+            , is_auto_delete(is_auto_delete_in) {}
+
+        Runnable* runnable;
+        bool is_auto_delete;
+    };
+    typedef std::deque<Task> AsyncTasks;
+
+    int epoll_fd;
+    int event_fd;   // asyncRunOnMainThread()通过它唤醒主线程
+    int timer_fd;   // 时间轮的系统定时器，见arm()
+
+    pthread_mutex_t tasks_mutex; // 保护async_tasks，工作线程也会投递任务
+    AsyncTasks async_tasks;
+
+    void createEventFds();
+    void runAsyncTasks();
+
+    // TimerWheel::Alarm的实现，把timer_fd设置为due_ms
+    virtual void arm(unsigned long long due_ms) override;
+};
+
+CUTEST_NS_END
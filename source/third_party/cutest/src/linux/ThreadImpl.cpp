@@ -0,0 +1,67 @@
+﻿#include "ThreadImpl.h"
+#include "SynchronizationObjectImpl.h"
+
+CUTEST_NS_BEGIN
+
+Thread*
+Thread::createInstance(Runnable* runnable) {
+    return new ThreadImpl(runnable);
+}
+
+CPPUNIT_NS::SynchronizedObject::SynchronizationObject*
+Thread::createLock() {
+    return new CPPUNIT_NS::SynchronizationObjectImpl();
+}
+
+long
+Thread::atomicLoad(const volatile long* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void
+Thread::atomicStore(volatile long* value, long new_value) {
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+long
+Thread::atomicExchange(volatile long* value, long new_value) {
+    return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+}
+
+long
+Thread::atomicCompareExchange(volatile long* value, long expected, long desired) {
+    return __sync_val_compare_and_swap(value, expected, desired);
+}
+
+ThreadImpl::ThreadImpl(Runnable* runnable_in)
+    : runnable(runnable_in)
+    , joinable(false) {
+    if (0 == ::pthread_create(&this->thread, NULL, threadFunction, this)) {
+        this->joinable = true;
+    }
+}
+
+void*
+ThreadImpl::threadFunction(void* param) {
+    ThreadImpl* thread = (ThreadImpl*)param;
+
+    thread->runnable->run();
+
+    return param;
+}
+
+void
+ThreadImpl::join() {
+    if (this->joinable) {
+        this->joinable = false;
+        ::pthread_join(this->thread, NULL);
+    }
+}
+
+void
+ThreadImpl::destroy() {
+    join();
+    delete this;
+}
+
+CUTEST_NS_END
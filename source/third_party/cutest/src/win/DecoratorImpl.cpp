@@ -18,12 +18,12 @@ Decorator::createInstance(CPPUNIT_NS::Test* test) {
 DecoratorImpl::DecoratorImpl(CPPUNIT_NS::Test* test)
     : TestDecorator(test)
     , test_result(new CPPUNIT_NS::SynchronizationObjectImpl(), new CPPUNIT_NS::SynchronizationObjectImpl())
-    , result_collector(new CPPUNIT_NS::SynchronizationObjectImpl())
+    , failure_log(new CPPUNIT_NS::SynchronizationObjectImpl())
     , result_printer(NULL)
     , runing_test(NULL)
     , thread_handle(NULL) {
     test_result.addListener(this);
-    test_result.addListener(&this->result_collector);
+    test_result.setFailureLog(&this->failure_log);
 
     this->run_completed = Event::createInstance();
 }
@@ -49,6 +49,11 @@ DecoratorImpl::addListener(CPPUNIT_NS::TestListener* listener) {
     this->test_result.addListener(listener);
 }
 
+void
+DecoratorImpl::pushProtector(CPPUNIT_NS::Protector* protector) {
+    this->test_result.pushProtector(protector);
+}
+
 void
 DecoratorImpl::start() {
     // 根据参数构造TestResultXmlPrinter
@@ -102,9 +107,9 @@ DecoratorImpl::stop() {
     this->test_result.stop();
 }
 
-const CPPUNIT_NS::TestResultCollector*
-DecoratorImpl::testResultCollector() {
-    return &this->result_collector;
+FailureLog*
+DecoratorImpl::failureLog() {
+    return &this->failure_log;
 }
 
 void
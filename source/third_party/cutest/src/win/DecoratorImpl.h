@@ -1,7 +1,6 @@
 ﻿#pragma once
 
 #include <cppunit/extensions/TestDecorator.h>
-#include <cppunit/TestResultCollector.h>
 #include <cppunit/Test.h>
 #include <WTypes.h>
 
@@ -25,6 +24,7 @@ public:
     virtual void destroy();
 
     virtual void addListener(CPPUNIT_NS::TestListener* listener);
+    virtual void pushProtector(CPPUNIT_NS::Protector* protector);
 
     virtual void start();
     virtual void stop();
@@ -38,11 +38,11 @@ protected:
 
 public:
     virtual void addFailure(bool is_error, CPPUNIT_NS::Exception* exception);
-    virtual const CPPUNIT_NS::TestResultCollector* testResultCollector();
+    virtual FailureLog* failureLog();
 
 protected:
     Result test_result;
-    CPPUNIT_NS::TestResultCollector result_collector;
+    FailureLog failure_log;
     testing::internal::TestResultXmlPrinter* result_printer;
 
 public: // 重载TestListener的成员方法
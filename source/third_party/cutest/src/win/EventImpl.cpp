@@ -2,9 +2,31 @@
 
 CUTEST_NS_BEGIN
 
+/*
+    destroy()之后的事件放回池中，createInstance()优先复用，
+    这样TestCaller、ProgressListenerManager等每次跨线程交接时都不需要再创建内核事件对象；
+    池用的是系统提供的无锁单链表
+*/
+static struct EventPool {
+    EventPool() {
+        ::InitializeSListHead(&this->head);
+    }
+
+    SLIST_HEADER head;
+} event_pool;
+
+static const USHORT MAX_POOL_SIZE = 64;
+
 Event*
 Event::createInstance() {
-    return new EventImpl;
+    EventImpl* event = EventImpl::takeFromPool();
+    return event ? event : new EventImpl;
+}
+
+EventImpl*
+EventImpl::takeFromPool() {
+    PSLIST_ENTRY entry = ::InterlockedPopEntrySList(&event_pool.head);
+    return entry ? CONTAINING_RECORD(entry, EventImpl, free_entry) : NULL;
 }
 
 EventImpl::EventImpl() : event_handle(NULL) {
@@ -33,6 +55,20 @@ EventImpl::post() {
 
 void
 EventImpl::destroy() {
+    // 上一个使用者没有消费掉的信号不能留给下一个使用者
+    ::ResetEvent(this->event_handle);
+
+    // 深度只是一个近似值，并发时池可能略微超过上限，不影响正确性
+    if (::QueryDepthSList(&event_pool.head) < MAX_POOL_SIZE) {
+        ::InterlockedPushEntrySList(&event_pool.head, &this->free_entry);
+        return;
+    }
+
+    release();
+}
+
+void
+EventImpl::release() {
     ::CloseHandle(this->event_handle);
     delete this;
 }
@@ -1,21 +1,30 @@
 ﻿#pragma once
 
 #include "cutest/Event.h"
-#include <WTypes.h>
+#include <Windows.h>
 
 CUTEST_NS_BEGIN
 
 class EventImpl : public Event {
+    // 放回池中时使用，见Event::createInstance()，SLIST_ENTRY自带MEMORY_ALLOCATION_ALIGNMENT对齐
+    SLIST_ENTRY free_entry;
     HANDLE event_handle;
 
 public:
     EventImpl();
 
+    // 从池中取出一个空闲的事件，池为空时返回NULL
+    static EventImpl* takeFromPool();
+
     virtual void wait();
     virtual void wait(unsigned int timeout_ms);
     virtual void post();
     virtual void reset();
     virtual void destroy();
+
+protected:
+    // 真正关闭事件句柄，池已满时由destroy()调用
+    void release();
 };
 
 CUTEST_NS_END
@@ -1,6 +1,5 @@
 ﻿#include "RunnerImpl.h"
 
-#include <set>
 #include "gmock/gmock.h"
 
 CUTEST_NS_BEGIN
@@ -28,6 +27,20 @@ tickCount64() {
     return (unsigned long long)seconds * 1000 + millSeconds;
 }
 
+unsigned long long
+tickCountNs() {
+    static LARGE_INTEGER ticks_per_second = { 0 };
+    LARGE_INTEGER tick;
+    if (!ticks_per_second.QuadPart) {
+        ::QueryPerformanceFrequency(&ticks_per_second);
+    }
+    ::QueryPerformanceCounter(&tick);
+    LONGLONG seconds = tick.QuadPart / ticks_per_second.QuadPart;
+    LONGLONG leftPart = tick.QuadPart - (ticks_per_second.QuadPart * seconds);
+    LONGLONG nanoSeconds = leftPart * 1000000000 / ticks_per_second.QuadPart;
+    return (unsigned long long)seconds * 1000000000 + nanoSeconds;
+}
+
 thread_id
 currentThreadId() {
     return ::GetCurrentThreadId();
@@ -40,7 +53,6 @@ Runner::instance() {
 }
 
 HWND RunnerImpl::message_window = NULL;
-std::set<Runnable*> RunnerImpl::auto_delete_runnables;
 
 RunnerImpl::RunnerImpl() {
 	initGoogleMock();
@@ -80,12 +92,6 @@ RunnerImpl::~RunnerImpl() {
         ::DestroyWindow(RunnerImpl::message_window);
         RunnerImpl::message_window = NULL;
     }
-
-    std::set<Runnable*>::iterator it = RunnerImpl::auto_delete_runnables.begin();
-    while (it != RunnerImpl::auto_delete_runnables.end()) {
-        delete *it;
-        ++it;
-    }
 }
 
 void
@@ -94,12 +100,13 @@ RunnerImpl::asyncRunOnMainThread(Runnable* runnable, bool is_auto_delete) {
 }
 
 void
-RunnerImpl::delayRunOnMainThread(unsigned int delay_ms, Runnable* runnable, bool is_auto_delete) {
-    if (is_auto_delete) {
-        ::PostMessage(RunnerImpl::message_window, WM_DELAY_RUN_AUTO_DELETE, (WPARAM)runnable, delay_ms);
-    } else {
-        ::PostMessage(RunnerImpl::message_window, WM_DELAY_RUN, (WPARAM)runnable, delay_ms);
+RunnerImpl::arm(unsigned long long due_ms) {
+    unsigned long long now_ms = CUTEST_NS::tickCount64();
+    unsigned long long delay_ms = due_ms > now_ms ? due_ms - now_ms : 0;
+    if (delay_ms > USER_TIMER_MAXIMUM) {
+        delay_ms = USER_TIMER_MAXIMUM; // 到时多调用一次expire()，时间轮会重新设置
     }
+    ::PostMessage(RunnerImpl::message_window, WM_ARM_TIMER, 0, (LPARAM)delay_ms);
 }
 
 LRESULT CALLBACK
@@ -114,13 +121,8 @@ RunnerImpl::messageWindowProc(HWND wnd, UINT msg, WPARAM wparam, LPARAM lparam)
             }
         }
         break;
-    case WM_DELAY_RUN_AUTO_DELETE: {
-            RunnerImpl::auto_delete_runnables.insert((Runnable*)wparam);
-            ::SetTimer(RunnerImpl::message_window, (UINT_PTR)wparam, (UINT)lparam, &RunnerImpl::onTimer4DelayRunAutoDelete);
-        }
-        break;
-    case WM_DELAY_RUN: {
-            ::SetTimer(RunnerImpl::message_window, (UINT_PTR)wparam, (UINT)lparam, &RunnerImpl::onTimer4DelayRun);
+    case WM_ARM_TIMER: {
+            ::SetTimer(RunnerImpl::message_window, TIMER_WHEEL_ID, (UINT)lparam, &RunnerImpl::onTimer);
         }
         break;
     default: {
@@ -132,21 +134,12 @@ RunnerImpl::messageWindowProc(HWND wnd, UINT msg, WPARAM wparam, LPARAM lparam)
 }
 
 VOID CALLBACK
-RunnerImpl::onTimer4DelayRunAutoDelete(HWND wnd, UINT msg, UINT_PTR id_event, DWORD elapse_ms) {
-    ::KillTimer(wnd, id_event);
-
-    Runnable* runnable = (Runnable*)id_event;
-    RunnerImpl::auto_delete_runnables.erase(runnable);
-    runnable->run();
-    delete runnable;
-}
-
-VOID CALLBACK
-RunnerImpl::onTimer4DelayRun(HWND wnd, UINT msg, UINT_PTR id_event, DWORD elapse_ms) {
+RunnerImpl::onTimer(HWND wnd, UINT msg, UINT_PTR id_event, DWORD elapse_ms) {
     ::KillTimer(wnd, id_event);
 
-    Runnable* runnable = (Runnable*)id_event;
-    runnable->run();
+    // expire()中会通过arm()重新设置
+    RunnerImpl* runner = (RunnerImpl*)Runner::instance();
+    runner->timer_wheel.expire(CUTEST_NS::tickCount64());
 }
 
 void
@@ -3,7 +3,6 @@
 #include "../Logger.h"
 #include "../RunnerBase.h"
 
-#include <set>
 #include <wtypes.h>
 
 CUTEST_NS_BEGIN
@@ -20,23 +19,24 @@ protected:
 public:
     // Runner的接口实现
     virtual void asyncRunOnMainThread(Runnable* runnable, bool is_auto_delete);
-    virtual void delayRunOnMainThread(unsigned int delay_ms, Runnable* runnable, bool is_auto_delete);
 
     virtual void waitUntilAllTestEnd();
 
 protected:
     enum {
         WM_RUN = WM_USER + 1,
-        WM_DELAY_RUN_AUTO_DELETE,
-        WM_DELAY_RUN,
+        WM_ARM_TIMER, // SetTimer()要在消息窗口所在的线程调用，arm()通过这个消息转到主线程
+    };
+    enum {
+        TIMER_WHEEL_ID = 1, // 时间轮只用这一个Timer，重新SetTimer()会覆盖之前的设置
     };
     static HWND message_window;
     static LRESULT CALLBACK messageWindowProc(HWND wnd, UINT msg, WPARAM wparam, LPARAM lparam);
 
-    static VOID CALLBACK onTimer4DelayRunAutoDelete(HWND wnd, UINT msg, UINT_PTR id_event, DWORD elapse_ms);
-    static VOID CALLBACK onTimer4DelayRun(HWND wnd, UINT uMsg, UINT_PTR id_event, DWORD elapse_ms);
+    static VOID CALLBACK onTimer(HWND wnd, UINT msg, UINT_PTR id_event, DWORD elapse_ms);
 
-    static std::set<Runnable*> auto_delete_runnables;  // 用于缓存delayRunOnMainThread()中尚未执行且需要auto delete的Runnable对象
+    // TimerWheel::Alarm的实现
+    virtual void arm(unsigned long long due_ms) override;
 };
 
 CUTEST_NS_END
@@ -0,0 +1,80 @@
+﻿#include "ThreadImpl.h"
+#include "SynchronizationObjectImpl.h"
+
+#include <process.h>
+
+CUTEST_NS_BEGIN
+
+Thread*
+Thread::createInstance(Runnable* runnable) {
+    return new ThreadImpl(runnable);
+}
+
+CPPUNIT_NS::SynchronizedObject::SynchronizationObject*
+Thread::createLock() {
+    return new CPPUNIT_NS::SynchronizationObjectImpl();
+}
+
+/*
+    ReadAcquire和WriteRelease从Windows 8 SDK（VS2012）开始才有；
+    更早的编译器只支持x86/x64，按默认的/volatile:ms，volatile读写本身就是acquire/release语义
+*/
+long
+Thread::atomicLoad(const volatile long* value) {
+#if _MSC_VER >= 1700
+    return ::ReadAcquire(value);
+#else
+    return *value;
+#endif
+}
+
+void
+Thread::atomicStore(volatile long* value, long new_value) {
+#if _MSC_VER >= 1700
+    ::WriteRelease(value, new_value);
+#else
+    *value = new_value;
+#endif
+}
+
+long
+Thread::atomicExchange(volatile long* value, long new_value) {
+    return ::InterlockedExchange(value, new_value);
+}
+
+long
+Thread::atomicCompareExchange(volatile long* value, long expected, long desired) {
+    return ::InterlockedCompareExchange(value, desired, expected);
+}
+
+ThreadImpl::ThreadImpl(Runnable* runnable_in)
+    : runnable(runnable_in)
+    , thread_handle(NULL) {
+    this->thread_handle = (HANDLE)_beginthreadex(NULL, 0, threadFunction, this, 0, NULL);
+}
+
+UINT
+ThreadImpl::threadFunction(LPVOID param) {
+    ThreadImpl* thread = (ThreadImpl*)param;
+
+    thread->runnable->run();
+
+    return 0;
+}
+
+void
+ThreadImpl::join() {
+    if (this->thread_handle) {
+        ::WaitForSingleObject(this->thread_handle, INFINITE);
+        ::CloseHandle(this->thread_handle);
+        this->thread_handle = NULL;
+    }
+}
+
+void
+ThreadImpl::destroy() {
+    join();
+    delete this;
+}
+
+CUTEST_NS_END
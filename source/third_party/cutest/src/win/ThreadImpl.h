@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include "../Thread.h"
+#include <WTypes.h>
+
+CUTEST_NS_BEGIN
+
+class ThreadImpl : public Thread {
+public:
+    ThreadImpl(Runnable* runnable);
+
+    virtual void join();
+    virtual void destroy();
+
+protected:
+    static UINT __stdcall threadFunction(LPVOID param);
+
+    Runnable* runnable;
+    HANDLE thread_handle;
+};
+
+CUTEST_NS_END
@@ -2340,6 +2340,18 @@ bool StaticAssertTypeEq() {
 #define EXPLICIT_END_TEST_WITH_TIMEOUT_F(test_fixture, test_name, timeout_ms) \
   GTEST_EXPLICIT_END_TEST_(test_fixture, test_name, test_fixture, timeout_ms)
 
+// Defines a micro-benchmark that uses a test fixture.  The body is one
+// iteration of the code being measured; the runner calls it repeatedly
+// after SetUp(), calibrating the iteration count, warming up and
+// collecting samples (see CUTEST_NS::measureBenchmark()).  The result is
+// reported through CUTEST_NS::ProgressListener::onBenchmarkEnd().
+//
+//   BENCHMARK_F(StringTest, Append) {
+//     s_.append("x");
+//   }
+#define BENCHMARK_F(test_fixture, benchmark_name) \
+  GTEST_BENCHMARK_(test_fixture, benchmark_name, test_fixture)
+
 // Returns a path to temporary directory.
 // Tries to determine an appropriate directory for the platform.
 GTEST_API_ std::string TempDir();
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <cppunit/TestCase.h>
+#include <cppunit/TestFailure.h>
+#include <cppunit/TestListener.h>
+#include <cppunit/TestResult.h>
+
+#include "cutest/Benchmark.h"
+#include "cutest/Runnable.h"
+
+namespace testing {
+
+/*
+  BENCHMARK_F定义的用例：SetUp()之后由CUTEST_NS::measureBenchmark()反复执行用例体，
+  测量结果保存在CUTEST_NS::BenchmarkTest中，用例结束时通过ProgressListener::onBenchmarkEnd()通知出去；
+  用例体中出现失败时立即停止测量，不产生测量结果。
+*/
+template <class Fixture>
+class BenchmarkCaller
+  : public CUTEST_NS::BenchmarkTest
+  , public CPPUNIT_NS::TestListener
+  , public CPPUNIT_NS::TestCase {
+  typedef void (Fixture::*TestMethod)();
+
+  // 每次run()执行一遍用例体
+  class Body : public CUTEST_NS::Runnable {
+   public:
+    Body(Fixture* fixture, TestMethod test)
+      : m_fixture(fixture)
+      , m_test(test)
+    {}
+
+    virtual void run() {
+      (m_fixture->*m_test)();
+    }
+
+   private:
+    Fixture* m_fixture;
+    TestMethod m_test;
+  };
+
+  // 测量期间监听当前用例的失败，异常退出时也能移除
+  class ListenerGuard {
+   public:
+    ListenerGuard(CPPUNIT_NS::TestResult* result, CPPUNIT_NS::TestListener* listener)
+      : m_result(result)
+      , m_listener(listener) {
+      if (m_result) {
+        m_result->addListener(m_listener);
+      }
+    }
+
+    ~ListenerGuard() {
+      if (m_result) {
+        m_result->removeListener(m_listener);
+      }
+    }
+
+   private:
+    CPPUNIT_NS::TestResult* m_result;
+    CPPUNIT_NS::TestListener* m_listener;
+  };
+
+ public:
+  BenchmarkCaller(std::string name, TestMethod test)
+    : TestCase(name)
+    , m_fixture(NULL)
+    , m_test(test)
+    , m_failed(false) {
+  }
+
+  virtual ~BenchmarkCaller() {
+    if (m_fixture) {
+      delete m_fixture;
+    }
+  }
+
+  // 重载TestCase::runTest()
+  virtual void runTest() override {
+    m_failed = false;
+    ListenerGuard guard(m_result, this);
+
+    Body body(m_fixture, m_test);
+    CUTEST_NS::BenchmarkResult result;
+    if (CUTEST_NS::measureBenchmark(&body, CUTEST_NS::BenchmarkOptions(), &m_failed, result)) {
+      setBenchmarkResult(result);
+    }
+  }
+
+  // 重载TestFixture::setUp()
+  virtual void setUp() override {
+    clearBenchmarkResult();
+    m_fixture = new Fixture;
+    m_fixture->SetUp();
+  }
+
+  // 重载TestFixture::tearDown()
+  virtual void tearDown() override {
+    m_fixture->TearDown();
+    delete m_fixture;
+    m_fixture = NULL;
+  }
+
+  // 重载TestListener::addFailure()
+  virtual void addFailure(const CPPUNIT_NS::TestFailure& failure) override {
+    if (failure.failedTest() == this) {
+      m_failed = true;
+    }
+  }
+
+ private:
+  BenchmarkCaller(const BenchmarkCaller&);
+  BenchmarkCaller& operator =(const BenchmarkCaller&);
+
+  Fixture* m_fixture;
+  TestMethod m_test;
+  volatile bool m_failed;
+};
+
+} // namespace testing {
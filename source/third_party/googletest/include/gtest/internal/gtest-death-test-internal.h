@@ -159,6 +159,11 @@ class DefaultDeathTestFactory : public DeathTestFactory {
 // by a signal, or exited normally with a nonzero exit code.
 GTEST_API_ bool ExitedUnsuccessfully(int exit_status);
 
+// Generates a textual description of a given exit code, in the format
+// specified by wait(2).  Also used by CUTest's process-isolated runner to
+// describe a crashed child.
+GTEST_API_ std::string ExitSummary(int exit_code);
+
 // Traps C++ exceptions escaping statement and reports them as test
 // failures. Note that trapping SEH exceptions is not implemented here.
 # if GTEST_HAS_EXCEPTIONS
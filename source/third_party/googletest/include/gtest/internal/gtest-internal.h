@@ -68,6 +68,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/TestNamer.h>
+#include "gtest-benchmark-caller.h"
 #include "gtest-caller.h"
 #include "gtest-explicit-end-caller.h"
 
@@ -1384,6 +1385,12 @@ class GTEST_TEST_CLASS_NAME_(test_case_name, test_name) : public parent_class {
         namer.getTestNameFor(#test_name), \
         &GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::TestBody); \
     } \
+    virtual const CPPUNIT_NS::TestMetadata* metadata() const { \
+      static const CPPUNIT_NS::TestMetadata metadata = { \
+        #test_case_name, #test_name, __FILE__, __LINE__, 0, false \
+      }; \
+      return &metadata; \
+    } \
   } factory; \
  private: \
   virtual void TestBody(); \
@@ -1418,6 +1425,47 @@ class GTEST_TEST_CLASS_NAME_(test_case_name, test_name) : public parent_class {
         namer.getTestNameFor(#test_name), \
         &GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::TestBody); \
     } \
+    virtual const CPPUNIT_NS::TestMetadata* metadata() const { \
+      static const CPPUNIT_NS::TestMetadata metadata = { \
+        #test_case_name, #test_name, __FILE__, __LINE__, timeout_ms, true \
+      }; \
+      return &metadata; \
+    } \
+  } factory; \
+ private: \
+  virtual void TestBody(); \
+}; \
+GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::TestFactory \
+GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::factory; \
+void GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::TestBody()
+
+// 和GTEST_TEST_一样注册到TestFactoryRegistry，只是由BenchmarkCaller来反复执行TestBody()
+#define GTEST_BENCHMARK_(test_case_name, test_name, parent_class) \
+class GTEST_TEST_CLASS_NAME_(test_case_name, test_name) : public parent_class { \
+  friend class testing::BenchmarkCaller<GTEST_TEST_CLASS_NAME_(test_case_name, test_name)>; \
+ public: \
+  GTEST_TEST_CLASS_NAME_(test_case_name, test_name)() {} \
+  static class TestFactory : public CPPUNIT_NS::TestFactory { \
+   public: \
+    TestFactory() { \
+      CPPUNIT_NS::TestFactoryRegistry &registry = CPPUNIT_NS::TestFactoryRegistry::getRegistry(#test_case_name); \
+      registry.registerFactory(this); \
+      CPPUNIT_NS::TestFactoryRegistry::getRegistry().registerFactory(&registry); \
+      CPPUNIT_NS::TestSuite::RegisterSetUpTestCase(#test_case_name, GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::SetUpTestCase); \
+      CPPUNIT_NS::TestSuite::RegisterTearDownTestCase(#test_case_name, GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::TearDownTestCase); \
+    } \
+    virtual CPPUNIT_NS::Test* makeTest() { \
+      CPPUNIT_NS::TestNamer namer(#test_case_name); \
+      return new testing::BenchmarkCaller<GTEST_TEST_CLASS_NAME_(test_case_name, test_name)>( \
+        namer.getTestNameFor(#test_name), \
+        &GTEST_TEST_CLASS_NAME_(test_case_name, test_name)::TestBody); \
+    } \
+    virtual const CPPUNIT_NS::TestMetadata* metadata() const { \
+      static const CPPUNIT_NS::TestMetadata metadata = { \
+        #test_case_name, #test_name, __FILE__, __LINE__, 0, false \
+      }; \
+      return &metadata; \
+    } \
   } factory; \
  private: \
   virtual void TestBody(); \
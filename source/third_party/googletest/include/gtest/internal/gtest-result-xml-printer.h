@@ -3,7 +3,8 @@
 #include "gtest/gtest-export.h"
 #include "cutest/ProgressListener.h"
 
-#include <list>
+#include <stdio.h>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -19,76 +20,62 @@ class TestResultXmlPrinter
   //////////////////////////////////////////////////////////////////////////
   // 重载TestProgressListener的成员方法
   virtual void onRunnerStart(CPPUNIT_NS::Test* test);
-  virtual void onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms);
+  virtual void onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns);
 
   virtual void onSuiteStart(CPPUNIT_NS::Test* suite);
-  virtual void onSuiteEnd(CPPUNIT_NS::Test* suite, unsigned int elapsed_ms);
+  virtual void onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns);
 
   virtual void onTestStart(CPPUNIT_NS::Test* test);
   virtual void onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure);
-  virtual void onTestEnd(
+  virtual void onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<CUTEST_NS::OmittedFailure>& omitted);
+  virtual void onBenchmarkEnd(CPPUNIT_NS::Test* test, const CUTEST_NS::BenchmarkResult& result);
+  virtual void onTestEndNs(
     CPPUNIT_NS::Test* test,
     unsigned int error_count,
     unsigned int failure_count,
-    unsigned int elapsed_ms);
+    unsigned long long elapsed_ns);
   //////////////////////////////////////////////////////////////////////////
 
  protected:
   TimeInMillis _startTestRunMs; // 在StartTestRun()中记录本次测试启动的时刻
+  unsigned int _testCases; // 已经写出的用例数
   unsigned int _failedTestCases; // 所有失败的用例数
 
-  struct TestCaseInfo {
-    TestCaseInfo()
-      : test(NULL)
-      , elapsedMs(0) {
-    }
-
-    CPPUNIT_NS::Test* test;
-    unsigned int elapsedMs;
-    std::vector<unsigned int> failureIndexs;
-  };
-  typedef std::list<TestCaseInfo*> TestCaseInfoList;
-
-  struct TestSuiteInfo {
-    TestSuiteInfo()
+  /*
+    报告边执行边写入文件，内存占用和用例数无关，进程中途崩溃时已经写出的部分也不会丢失：
+    - 每个用例结束时写出对应的<testcase>元素；
+    - <testsuites>、<testsuite>起始标签中的计数要到结束时才知道，先用空格占位，结束时再回填；
+    - 写入经过固定大小的缓冲区，每个Suite结束时刷新到系统，并且至少每秒同步到磁盘一次。
+  */
+  FILE* _file;
+  long _countersOffset; // <testsuites>起始标签中预留给计数的位置
+  TimeInMillis _lastSyncMs; // 上次同步到磁盘的时刻
+
+  // 执行中的Suite，外层的在前；<testsuite>元素在Suite下第一个用例开始时才写出
+  struct SuiteState {
+    SuiteState()
       : suite(NULL)
-      , elapsedMs(0)
-      , failedTestCases(0) {
-    }
-
-    ~TestSuiteInfo() {
-      TestCaseInfoList::iterator it = testCaseInfos.begin();
-      while (it != testCaseInfos.end()) {
-        delete (*it);
-        ++it;
-      }
-    }
-
-    const std::string& name() {
-      if (!suiteName.empty()) {
-        return suiteName;
-      }
-
-      std::string wholeName = suite->getName();
-      std::string::size_type pos = wholeName.find(".");
-      if (std::string::npos == pos) {
-        suiteName = wholeName;
-      } else {
-        suiteName = wholeName.substr(0, pos);
-      }
-
-      return suiteName;
+      , opened(false)
+      , countersOffset(0)
+      , testCases(0)
+      , failedTestCases(0)
+      , elapsedNs(0) {
     }
 
     CPPUNIT_NS::Test* suite;
-    std::string suiteName;
-    unsigned int elapsedMs;
-    unsigned int failedTestCases;
-    TestCaseInfoList testCaseInfos;
+    std::string name;
+    bool opened; // 已经写出<testsuite>起始标签，还没有写出结束标签
+    long countersOffset; // 起始标签中预留给计数的位置
+    unsigned int testCases; // 当前<testsuite>元素中的用例数
+    unsigned int failedTestCases; // 当前<testsuite>元素中失败的用例数
+    unsigned long long elapsedNs; // 当前<testsuite>元素中用例的总耗时
   };
-  typedef std::list<TestSuiteInfo*> TestSuiteInfoList;
+  std::vector<SuiteState> _suites;
 
-  TestSuiteInfoList _testSuiteInfos;
+  // 当前用例的<failure>元素和测量结果，用例结束时和<testcase>一起写出
+  std::string _failures;
+  bool _hasBenchmark;
+  CUTEST_NS::BenchmarkResult _benchmark;
 
  private:
   // Is c a whitespace character that is normalized to a space character
@@ -111,6 +98,10 @@ class TestResultXmlPrinter
   // Returns the given string with all characters invalid in XML removed.
   static std::string removeInvalidXmlCharacters(const std::string& str);
 
+  // Formats the given time in nanoseconds as seconds, keeping microseconds,
+  // e.g. "0.000125" or "1.5".
+  static std::string formatTimeInNanosAsSeconds(unsigned long long ns);
+
   // Convenience wrapper around EscapeXml when str is an attribute value.
   static std::string escapeXmlAttribute(const std::string& str) {
     return escapeXml(str, true);
@@ -126,16 +117,36 @@ class TestResultXmlPrinter
   // Streams an XML CDATA section, escaping invalid CDATA sequences as needed.
   static void outputXmlCDataSection(::std::ostream* stream, const char* data);
 
-  // Streams an XML representation of a TestCaseInfo object.
+  // Streams an XML representation of the test that just ended.
   void outputXmlTestCase(::std::ostream* stream,
-                         const char* test_case_name,
-                         TestCaseInfo* test_case_info);
+                         const std::string& test_case_name,
+                         CPPUNIT_NS::Test* test,
+                         unsigned long long elapsed_ns);
+
+  // Streams an XML representation of a BenchmarkResult object.
+  static void outputXmlBenchmark(::std::ostream* stream,
+                                 const CUTEST_NS::BenchmarkResult& result);
+
+  // 写出<testsuite>起始标签，计数先用空格占位
+  void openXmlTestSuite(SuiteState& state);
+
+  // 写出</testsuite>，回填起始标签中的计数；elapsed_ns为整个元素的耗时
+  void closeXmlTestSuite(SuiteState& state, unsigned long long elapsed_ns);
+
+  // 在offset处回填计数，不足预留宽度的部分保留空格
+  void patchCounters(long offset, const std::string& counters);
+
+  // 把stream中的内容追加到文件末尾
+  void write(std::stringstream* stream);
+
+  // 把缓冲区中的内容交给系统，sync为true时还要同步到磁盘
+  void flush(bool sync);
 
-  // Prints an XML representation of a TestSuiteInfo object
-  void outputXmlTestSuite(::std::ostream* stream, TestSuiteInfo* test_suite_info);
+  // 起始标签中预留给计数的宽度，足够容纳最大的计数和耗时
+  enum { kCountersWidth = 100 };
 
-  // Prints an XML summary of unit_test to output stream out.
-  void printXmlTestSuites(::std::ostream* stream, CPPUNIT_NS::Test* test, unsigned int elapsed_ms);
+  // 写入文件的缓冲区大小
+  enum { kBufferSize = 64 * 1024 };
 
   // The output file.
   const std::string _filePath;
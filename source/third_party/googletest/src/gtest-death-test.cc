@@ -193,7 +193,7 @@ namespace internal {
 
 // Generates a textual description of a given exit code, in the format
 // specified by wait(2).
-static std::string ExitSummary(int exit_code) {
+std::string ExitSummary(int exit_code) {
   Message m;
 
 # if GTEST_OS_WINDOWS || GTEST_OS_FUCHSIA
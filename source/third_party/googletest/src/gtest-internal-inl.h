@@ -356,6 +356,42 @@ class TestPropertyKeyIs {
   std::string key_;
 };
 
+// A --gtest_filter value parsed once, so that it can be matched against
+// every registered test without re-splitting it or allocating memory.
+// Patterns without wildcards are kept sorted and found by binary search;
+// the remaining ones are matched one by one without backtracking
+// recursion.
+class GTEST_API_ TestFilter {
+ public:
+  explicit TestFilter(const std::string& filter);
+
+  // The --gtest_filter value this object was compiled from.
+  const std::string& filter() const { return filter_; }
+
+  // Returns true iff the filter matches the full name of a test
+  // ("TestCaseName.TestName").
+  bool Matches(const std::string& full_name) const;
+
+ private:
+  // A colon-separated list of patterns.  It matches a name if any
+  // pattern in it matches the name.
+  class PatternList {
+   public:
+    void Parse(const char* begin, const char* end);
+    bool Matches(const std::string& name) const;
+
+   private:
+    std::vector<std::string> literals_;   // Sorted.
+    std::vector<std::string> wildcards_;  // Contain '*' or '?'.
+  };
+
+  std::string filter_;
+  PatternList positive_;
+  PatternList negative_;
+
+  GTEST_DISALLOW_COPY_AND_ASSIGN_(TestFilter);
+};
+
 // Class UnitTestOptions.
 //
 // This class contains functions for processing options the user
@@ -382,15 +418,16 @@ class GTEST_API_ UnitTestOptions {
 
   // Returns true iff the wildcard pattern matches the string.  The
   // first ':' or '\0' character in pattern marks the end of it.
-  //
-  // This recursive algorithm isn't very efficient, but is clear and
-  // works well enough for matching test names, which are short.
   static bool PatternMatchesString(const char *pattern, const char *str);
 
   // Returns true iff the user-specified filter matches the test case
-  // name and the test name.
+  // name and the test name.  The filter is compiled into a TestFilter
+  // the first time it is used and again only when GTEST_FLAG(filter)
+  // changes.  Thread-safe.
   static bool FilterMatchesTest(const std::string &test_case_name,
                                 const std::string &test_name);
+  static bool FilterMatchesTest(const char *test_case_name,
+                                const char *test_name);
 
   static bool FilterMatchesTest(const std::string &full_name);
 
@@ -1,7 +1,8 @@
 ﻿#include "gtest/internal/gtest-result-xml-printer.h"
 
 #include <cppunit/TestFailure.h>
-#include "cutest/Runner.h"
+
+#include <iomanip>
 
 namespace testing {
 namespace internal {
@@ -9,7 +10,12 @@ namespace internal {
 // Creates a new TestResultXmlPrinter.
 TestResultXmlPrinter::TestResultXmlPrinter(const char* file_path)
   : _startTestRunMs(0)
+  , _testCases(0)
   , _failedTestCases(0)
+  , _file(NULL)
+  , _countersOffset(0)
+  , _lastSyncMs(0)
+  , _hasBenchmark(false)
   , _filePath(file_path) {
   if (_filePath.c_str() == NULL || _filePath.empty()) {
     fprintf(stderr, "XML output file may not be null\n");
@@ -19,79 +25,264 @@ TestResultXmlPrinter::TestResultXmlPrinter(const char* file_path)
 }
 
 TestResultXmlPrinter::~TestResultXmlPrinter() {
-  TestSuiteInfoList::iterator it = _testSuiteInfos.begin();
-  while (it != _testSuiteInfos.end()) {
-    delete (*it);
-    ++it;
+  // 没有正常结束时保留已经写出的部分
+  if (_file) {
+    posix::FClose(_file);
   }
 }
 
 void TestResultXmlPrinter::onRunnerStart(CPPUNIT_NS::Test* test) {
   _startTestRunMs = GetTimeInMillis();
+  _lastSyncMs = _startTestRunMs;
+  _testCases = 0;
   _failedTestCases = 0;
 
-  TestSuiteInfo* info = new TestSuiteInfo;
-  info->suite = test;
-  _testSuiteInfos.push_back(info);
-}
-
-// Called after the unit test ends.
-void TestResultXmlPrinter::onRunnerEnd(CPPUNIT_NS::Test* test, unsigned int elapsed_ms) {
-  if (_testSuiteInfos.back()->suite == test) {
-    _testSuiteInfos.back()->elapsedMs = elapsed_ms;
-  }
-
-  FILE* xmlout = NULL;
   FilePath filePath(_filePath);
   FilePath dirPath(filePath.RemoveFileName());
 
   if (dirPath.CreateDirectoriesRecursively()) {
-    xmlout = posix::FOpen(_filePath.c_str(), "w");
+    _file = posix::FOpen(_filePath.c_str(), "w");
   }
-  if (xmlout == NULL) {
+  if (_file == NULL) {
     fprintf(stderr,
             "Unable to open file \"%s\"\n",
             _filePath.c_str());
     fflush(stderr);
     exit(EXIT_FAILURE);
   }
+  setvbuf(_file, NULL, _IOFBF, kBufferSize);
+
+  const std::string kTestsuites = "testsuites";
+  std::stringstream stream;
+  stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+  stream << "<" << kTestsuites;
+  write(&stream);
+
+  // 总的用例数、失败的用例数和总耗时在结束时回填
+  _countersOffset = ftell(_file);
+  stream << std::string(kCountersWidth, ' ');
+
+  // 启动本次测试的时刻
+  outputXmlAttribute(
+    &stream, kTestsuites, "timestamp",
+    FormatEpochTimeInMillisAsIso8601(_startTestRunMs));
+
+  // if (GTEST_FLAG(shuffle)) {
+  //     OutputXmlAttribute(stream, kTestsuites, "random_seed",
+  //          StreamableToString(unit_test.random_seed()));
+  // }
+
+  // *stream << TestPropertiesAsXmlAttributes(unit_test.ad_hoc_test_result());
+
+  outputXmlAttribute(&stream, kTestsuites, "name", test->getName());
+  stream << ">\n";
+  write(&stream);
+
+  SuiteState state;
+  state.suite = test;
+  _suites.push_back(state);
+}
+
+// Called after the unit test ends.
+void TestResultXmlPrinter::onRunnerEndNs(CPPUNIT_NS::Test* test, unsigned long long elapsed_ns) {
+  if (_file == NULL) {
+    return;
+  }
+
+  while (!_suites.empty()) {
+    if (_suites.back().opened) {
+      closeXmlTestSuite(_suites.back(), _suites.back().suite == test ? elapsed_ns : _suites.back().elapsedNs);
+    }
+    _suites.pop_back();
+  }
+
+  const std::string kTestsuites = "testsuites";
   std::stringstream stream;
-  printXmlTestSuites(&stream, test, elapsed_ms);
-  fprintf(xmlout, "%s", StringStreamToString(&stream).c_str());
-  fclose(xmlout);
+  stream << "</" << kTestsuites << ">\n";
+  write(&stream);
+
+  // 总的测试用例数
+  outputXmlAttribute(&stream, kTestsuites, "tests",
+                     StreamableToString(_testCases));
+
+  // 失败的测试用例数
+  outputXmlAttribute(&stream, kTestsuites, "failures",
+                     StreamableToString(_failedTestCases));
+
+  // 预留字段，目前总是填0
+  outputXmlAttribute(
+    &stream, kTestsuites, "disabled",
+    StreamableToString(0));
+
+  // 预留字段，目前总是填0
+  outputXmlAttribute(&stream, kTestsuites, "errors", "0");
+
+  // 所有测试的总耗时，单位：秒
+  outputXmlAttribute(&stream, kTestsuites, "time",
+                     formatTimeInNanosAsSeconds(elapsed_ns));
+  patchCounters(_countersOffset, StringStreamToString(&stream));
+
+  flush(true);
+  posix::FClose(_file);
+  _file = NULL;
 }
 
 void TestResultXmlPrinter::onSuiteStart(CPPUNIT_NS::Test* suite) {
-  TestSuiteInfo* info = new TestSuiteInfo;
-  info->suite = suite;
-  _testSuiteInfos.push_back(info);
+  // <testsuite>不能嵌套，外层Suite的元素先结束，之后还有用例时再写出一个新的元素
+  if (!_suites.empty() && _suites.back().opened) {
+    closeXmlTestSuite(_suites.back(), _suites.back().elapsedNs);
+  }
+
+  SuiteState state;
+  state.suite = suite;
+  _suites.push_back(state);
 }
 
-void TestResultXmlPrinter::onSuiteEnd(CPPUNIT_NS::Test* suite, unsigned int elapsed_ms) {
-  _testSuiteInfos.back()->elapsedMs = elapsed_ms;
+void TestResultXmlPrinter::onSuiteEndNs(CPPUNIT_NS::Test* suite, unsigned long long elapsed_ns) {
+  if (_suites.size() <= 1 || _suites.back().suite != suite) {
+    return;
+  }
+
+  if (_suites.back().opened) {
+    closeXmlTestSuite(_suites.back(), elapsed_ns);
+  }
+  _suites.pop_back();
 }
 
 void TestResultXmlPrinter::onTestStart(CPPUNIT_NS::Test* test) {
-  TestCaseInfo* info = new TestCaseInfo;
-  info->test = test;
-  _testSuiteInfos.back()->testCaseInfos.push_back(info);
+  _failures.clear();
+  _hasBenchmark = false;
+
+  if (!_suites.empty() && !_suites.back().opened) {
+    openXmlTestSuite(_suites.back());
+  }
 }
 
 void TestResultXmlPrinter::onFailureAdd(unsigned int index, const CPPUNIT_NS::TestFailure& failure) {
-  // 记录每个TestFailure的index
-  _testSuiteInfos.back()->testCaseInfos.back()->failureIndexs.push_back(index);
+  // failure只在通知期间有效，先转成<failure>元素保存下来
+  const string location = internal::FormatCompilerIndependentFileLocation(
+                            failure.sourceLine().fileName().c_str(),
+                            failure.sourceLine().lineNumber());
+  const string summary = location + "\n" + failure.thrownException()->what();
+
+  std::stringstream stream;
+  stream << "      <failure message=\""
+         << escapeXmlAttribute(summary.c_str())
+         << "\" type=\"\">";
+  const string detail = location + "\n" + failure.thrownException()->what();
+  outputXmlCDataSection(&stream, removeInvalidXmlCharacters(detail).c_str());
+  stream << "</failure>\n";
+  _failures += StringStreamToString(&stream);
+}
+
+void TestResultXmlPrinter::onFailuresOmitted(CPPUNIT_NS::Test* test, const CppUnitVector<CUTEST_NS::OmittedFailure>& omitted) {
+  // 每处合并成一个<failure>元素，报告的大小只和出错位置的个数有关
+  for (size_t i = 0; i < omitted.size(); ++i) {
+    const CUTEST_NS::OmittedFailure& failure = omitted[i];
+    const string location = internal::FormatCompilerIndependentFileLocation(
+                              failure.source_line.fileName().c_str(),
+                              failure.source_line.lineNumber());
+    const string summary = location + "\n"
+                           + StreamableToString(failure.count)
+                           + (failure.is_error ? " more errors" : " more failures")
+                           + " omitted, the first one:\n" + failure.message;
+
+    std::stringstream stream;
+    stream << "      <failure message=\""
+           << escapeXmlAttribute(summary.c_str())
+           << "\" type=\"\">";
+    outputXmlCDataSection(&stream, removeInvalidXmlCharacters(summary).c_str());
+    stream << "</failure>\n";
+    _failures += StringStreamToString(&stream);
+  }
 }
 
-void TestResultXmlPrinter::onTestEnd(
+void TestResultXmlPrinter::onBenchmarkEnd(CPPUNIT_NS::Test* test, const CUTEST_NS::BenchmarkResult& result) {
+  _hasBenchmark = true;
+  _benchmark = result;
+}
+
+void TestResultXmlPrinter::onTestEndNs(
   CPPUNIT_NS::Test* test,
   unsigned int error_count,
   unsigned int failure_count,
-  unsigned int elapsed_ms) {
+  unsigned long long elapsed_ns) {
+  if (_file == NULL || _suites.empty()) {
+    return;
+  }
+
+  SuiteState& state = _suites.back();
+  if (!state.opened) {
+    openXmlTestSuite(state);
+  }
+
+  ++_testCases;
+  state.testCases += 1;
+  state.elapsedNs += elapsed_ns;
   if (error_count || failure_count) {
     ++_failedTestCases; // 所有失败的用例数
-    _testSuiteInfos.back()->failedTestCases += 1; // 当前Suite的失败的用例数
+    state.failedTestCases += 1; // 当前Suite的失败的用例数
+  }
+
+  std::stringstream stream;
+  outputXmlTestCase(&stream, state.name, test, elapsed_ns);
+  write(&stream);
+
+  _failures.clear();
+  _hasBenchmark = false;
+
+  // 至少每秒同步一次，机器掉电时也只丢失最后一秒的结果
+  if (GetTimeInMillis() - _lastSyncMs >= 1000) {
+    flush(true);
+  }
+}
+
+void TestResultXmlPrinter::write(std::stringstream* stream) {
+  const std::string content = StringStreamToString(stream);
+  fwrite(content.c_str(), 1, content.size(), _file);
+  stream->str("");
+}
+
+void TestResultXmlPrinter::flush(bool sync) {
+  fflush(_file);
+  if (sync) {
+#if GTEST_OS_WINDOWS
+    _commit(posix::FileNo(_file));
+#else
+    fsync(posix::FileNo(_file));
+#endif
+    _lastSyncMs = GetTimeInMillis();
+  }
+}
+
+void TestResultXmlPrinter::patchCounters(long offset, const std::string& counters) {
+  std::string padded = counters;
+  GTEST_CHECK_(padded.size() <= static_cast<size_t>(kCountersWidth))
+      << "Counters \"" << padded << "\" exceed the reserved width.";
+  padded.resize(kCountersWidth, ' ');
+
+  // fseek()会先把缓冲区中的内容写入文件
+  fseek(_file, offset, SEEK_SET);
+  fwrite(padded.c_str(), 1, padded.size(), _file);
+  fseek(_file, 0, SEEK_END);
+}
+
+// Formats the given time in nanoseconds as seconds, keeping microseconds.
+std::string TestResultXmlPrinter::formatTimeInNanosAsSeconds(unsigned long long ns) {
+  unsigned int us = (unsigned int)(ns / 1000 % 1000000);
+
+  std::stringstream stream;
+  stream << ns / 1000000000;
+  if (us) {
+    stream << '.' << std::setw(6) << std::setfill('0') << us;
   }
-  _testSuiteInfos.back()->testCaseInfos.back()->elapsedMs = elapsed_ms;
+
+  // 去掉小数部分末尾的0，和FormatTimeInMillisAsSeconds()的格式一致
+  std::string seconds = StringStreamToString(&stream);
+  if (us) {
+    seconds.erase(seconds.find_last_not_of('0') + 1);
+  }
+  return seconds;
 }
 
 // Returns an XML-escaped copy of the input string str.  If is_attribute
@@ -223,13 +414,14 @@ void TestResultXmlPrinter::outputXmlAttribute(
 // TODO(wan): There is also value in printing properties with the plain printer.
 void TestResultXmlPrinter::outputXmlTestCase(
   ::std::ostream* stream,
-  const char* test_case_name,
-  TestCaseInfo* test_case_info) {
+  const std::string& test_case_name,
+  CPPUNIT_NS::Test* test,
+  unsigned long long elapsed_ns) {
   const std::string kTestcase = "testcase";
 
   // Test方法的名称
   *stream << "    <testcase";
-  std::string name = test_case_info->test->getName();
+  std::string name = test->getName();
   // 将Test名字中Suite.的部分精简掉
   // 比如："ExampleTestCase.testAdd"精简为"testAdd"
   std::string prefix = test_case_name;
@@ -250,136 +442,107 @@ void TestResultXmlPrinter::outputXmlTestCase(
   outputXmlAttribute(stream, kTestcase, "status", "run");
 
   outputXmlAttribute(stream, kTestcase, "time",
-                     FormatTimeInMillisAsSeconds(test_case_info->elapsedMs));
+                     formatTimeInNanosAsSeconds(elapsed_ns));
 
   outputXmlAttribute(stream, kTestcase, "classname", test_case_name);
   // *stream << TestPropertiesAsXmlAttributes(result);
 
-  int failures = 0;
-  for (std::vector<unsigned int>::size_type i = 0; i < test_case_info->failureIndexs.size(); ++i) {
-    const CPPUNIT_NS::TestFailure* testFailure =
-      CUTEST_NS::Runner::instance()->failureAt(test_case_info->failureIndexs[i]);
-
-    if (++failures == 1) {
-      *stream << ">\n";
-    }
-
-    const string location = internal::FormatCompilerIndependentFileLocation(
-                              testFailure->sourceLine().fileName().c_str(),
-                              testFailure->sourceLine().lineNumber());
-    const string summary = location + "\n" + testFailure->thrownException()->what();
-    *stream << "      <failure message=\""
-            << escapeXmlAttribute(summary.c_str())
-            << "\" type=\"\">";
-    const string detail = location + "\n" + testFailure->thrownException()->what();
-    outputXmlCDataSection(stream, removeInvalidXmlCharacters(detail).c_str());
-    *stream << "</failure>\n";
+  if (_failures.empty() && !_hasBenchmark) {
+    *stream << " />\n";
+    return;
   }
 
-  if (failures == 0) {
-    *stream << " />\n";
-  } else {
-    *stream << "    </testcase>\n";
+  *stream << ">\n";
+  *stream << _failures;
+  if (_hasBenchmark) {
+    outputXmlBenchmark(stream, _benchmark);
   }
+  *stream << "    </testcase>\n";
 }
 
-// Prints an XML representation of a TestSuiteInfo object
-void TestResultXmlPrinter::outputXmlTestSuite(
+// Prints an XML representation of a BenchmarkResult object, all times are
+// nanoseconds per iteration.
+void TestResultXmlPrinter::outputXmlBenchmark(
   std::ostream* stream,
-  TestSuiteInfo* test_suite_info) {
-  const std::string kTestsuite = "testsuite";
-  *stream << "  <" << kTestsuite;
-
-  // TestCase的名称
-  outputXmlAttribute(stream, kTestsuite, "name", test_suite_info->name());
-
-  // TestCase下的用例数
-  outputXmlAttribute(stream, kTestsuite, "tests",
-                     StreamableToString(test_suite_info->suite->countTestCases()));
+  const CUTEST_NS::BenchmarkResult& result) {
+  *stream << "      <benchmark"
+          << " iterations=\"" << result.iterations << "\""
+          << " samples=\"" << result.samples_ns.size() << "\""
+          << " outliers=\"" << result.outliers << "\""
+          << " mean_ns=\"" << result.mean_ns << "\""
+          << " median_ns=\"" << result.median_ns << "\""
+          << " p99_ns=\"" << result.p99_ns << "\""
+          << " stddev_ns=\"" << result.stddev_ns << "\""
+          << " min_ns=\"" << result.min_ns << "\""
+          << " max_ns=\"" << result.max_ns << "\""
+          << " ci_low_ns=\"" << result.ci_low_ns << "\""
+          << " ci_high_ns=\"" << result.ci_high_ns << "\"";
+
+  // 每个样本的单次迭代耗时，以空格分隔，供之后的运行做统计比较
+  *stream << " samples_ns=\"";
+  for (size_t i = 0; i < result.samples_ns.size(); ++i) {
+    *stream << (i ? " " : "") << result.samples_ns[i];
+  }
+  *stream << "\" />\n";
+}
 
-  // TestCase下失败的用例数
-  outputXmlAttribute(stream, kTestsuite, "failures",
-                     StreamableToString(test_suite_info->failedTestCases));
+void TestResultXmlPrinter::openXmlTestSuite(SuiteState& state) {
+  if (state.name.empty()) {
+    std::string wholeName = state.suite->getName();
+    state.name = wholeName.substr(0, wholeName.find("."));
+  }
+  state.opened = true;
+  state.testCases = 0;
+  state.failedTestCases = 0;
+  state.elapsedNs = 0;
 
-  // 预留字段，目前总是填0
-  outputXmlAttribute(
-    stream, kTestsuite, "disabled",
-    StreamableToString(0));
+  const std::string kTestsuite = "testsuite";
+  std::stringstream stream;
+  stream << "  <" << kTestsuite;
 
-  // 预留字段，目前总是填0
-  outputXmlAttribute(stream, kTestsuite, "errors", "0");
+  // TestCase的名称
+  outputXmlAttribute(&stream, kTestsuite, "name", state.name);
+  write(&stream);
 
-  // 当前TestCase的总耗时，单位：秒
-  outputXmlAttribute(stream, kTestsuite, "time",
-                     FormatTimeInMillisAsSeconds(test_suite_info->elapsedMs));
+  // 用例数、失败的用例数和耗时在结束时回填
+  state.countersOffset = ftell(_file);
+  stream << std::string(kCountersWidth, ' ');
 
   // *stream << TestPropertiesAsXmlAttributes(test_case.ad_hoc_test_result());
-  *stream << ">\n";
-
-  TestCaseInfoList::iterator it = test_suite_info->testCaseInfos.begin();
-  while (it != test_suite_info->testCaseInfos.end()) {
-    outputXmlTestCase(stream, test_suite_info->name().c_str(), *it);
-    ++it;
-  }
-
-  *stream << "  </" << kTestsuite << ">\n";
+  stream << ">\n";
+  write(&stream);
 }
 
-// Prints an XML summary of unit_test to output stream out.
-void TestResultXmlPrinter::printXmlTestSuites(
-  std::ostream* stream,
-  CPPUNIT_NS::Test* test,
-  unsigned int elapsed_ms) {
-  const std::string kTestsuites = "testsuites";
-
-  *stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-  *stream << "<" << kTestsuites;
-
-  // 总的测试用例数
-  outputXmlAttribute(stream, kTestsuites, "tests",
-                     StreamableToString(test->countTestCases()));
+void TestResultXmlPrinter::closeXmlTestSuite(SuiteState& state, unsigned long long elapsed_ns) {
+  const std::string kTestsuite = "testsuite";
+  std::stringstream stream;
+  stream << "  </" << kTestsuite << ">\n";
+  write(&stream);
 
+  // TestCase下的用例数
+  outputXmlAttribute(&stream, kTestsuite, "tests",
+                     StreamableToString(state.testCases));
 
-  // 失败的测试用例数
-  outputXmlAttribute(stream, kTestsuites, "failures",
-                     StreamableToString(_failedTestCases));
+  // TestCase下失败的用例数
+  outputXmlAttribute(&stream, kTestsuite, "failures",
+                     StreamableToString(state.failedTestCases));
 
   // 预留字段，目前总是填0
   outputXmlAttribute(
-    stream, kTestsuites, "disabled",
+    &stream, kTestsuite, "disabled",
     StreamableToString(0));
 
   // 预留字段，目前总是填0
-  outputXmlAttribute(stream, kTestsuites, "errors", "0");
+  outputXmlAttribute(&stream, kTestsuite, "errors", "0");
 
-  // 启动本次测试的时刻
-  outputXmlAttribute(
-    stream, kTestsuites, "timestamp",
-    FormatEpochTimeInMillisAsIso8601(_startTestRunMs));
-
-  // 所有测试的总耗时，单位：秒
-  outputXmlAttribute(stream, kTestsuites, "time",
-                     FormatTimeInMillisAsSeconds(elapsed_ms));
-
-  // if (GTEST_FLAG(shuffle)) {
-  //     OutputXmlAttribute(stream, kTestsuites, "random_seed",
-  //          StreamableToString(unit_test.random_seed()));
-  // }
-
-  // *stream << TestPropertiesAsXmlAttributes(unit_test.ad_hoc_test_result());
-
-  outputXmlAttribute(stream, kTestsuites, "name", test->getName());
-  *stream << ">\n";
-
-  TestSuiteInfoList::iterator it = _testSuiteInfos.begin();
-  while (it != _testSuiteInfos.end()) {
-    if ((*it)->testCaseInfos.size()) {
-      outputXmlTestSuite(stream, *it);
-    }
-    ++it;
-  }
+  // 当前TestCase的总耗时，单位：秒
+  outputXmlAttribute(&stream, kTestsuite, "time",
+                     formatTimeInNanosAsSeconds(elapsed_ns));
+  patchCounters(state.countersOffset, StringStreamToString(&stream));
 
-  *stream << "</" << kTestsuites << ">\n";
+  // 每个Suite结束时把缓冲区交给系统，进程崩溃时不会丢失已经结束的Suite
+  flush(false);
+  state.opened = false;
 }
 
 } // namespace internal
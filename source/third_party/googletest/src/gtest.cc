@@ -553,26 +553,52 @@ std::string UnitTestOptions::GetAbsolutePathToOutputFile() {
   return result.string();
 }
 
+namespace {
+
+// Returns true iff the wildcard pattern [pattern, pattern_end) matches
+// the string [str, str_end).
+//
+// When a mismatch happens after a '*', only the last '*' needs to be
+// retried one character further: whatever the earlier '*'s matched
+// can't make the rest of the pattern match where the last one failed.
+// So this takes O(len(pattern) * len(str)) in the worst case and is
+// linear for the usual "Prefix*" and "*Suffix" patterns, unlike the
+// recursive algorithm which is exponential in the number of '*'s.
+bool WildcardMatches(const char* pattern, const char* pattern_end,
+                     const char* str, const char* str_end) {
+  const char* star = NULL;    // The pattern right after the last '*'.
+  const char* resume = NULL;  // Where that '*' stopped matching.
+  while (str != str_end) {
+    if (pattern != pattern_end && *pattern == '*') {
+      star = ++pattern;
+      resume = str;
+    } else if (pattern != pattern_end &&
+               (*pattern == '?' || *pattern == *str)) {
+      ++pattern;
+      ++str;
+    } else if (star != NULL) {
+      // Lets the last '*' swallow one more character.
+      pattern = star;
+      str = ++resume;
+    } else {
+      return false;
+    }
+  }
+
+  while (pattern != pattern_end && *pattern == '*') {
+    ++pattern;
+  }
+  return pattern == pattern_end;
+}
+
+}  // namespace
+
 // Returns true iff the wildcard pattern matches the string.  The
 // first ':' or '\0' character in pattern marks the end of it.
-//
-// This recursive algorithm isn't very efficient, but is clear and
-// works well enough for matching test names, which are short.
 bool UnitTestOptions::PatternMatchesString(const char *pattern,
                                            const char *str) {
-  switch (*pattern) {
-    case '\0':
-    case ':':  // Either ':' or '\0' marks the end of the pattern.
-      return *str == '\0';
-    case '?':  // Matches any single character.
-      return *str != '\0' && PatternMatchesString(pattern + 1, str + 1);
-    case '*':  // Matches any string (possibly empty) of characters.
-      return (*str != '\0' && PatternMatchesString(pattern, str + 1)) ||
-          PatternMatchesString(pattern + 1, str);
-    default:  // Non-special character.  Matches itself.
-      return *pattern == *str &&
-          PatternMatchesString(pattern + 1, str + 1);
-  }
+  return WildcardMatches(pattern, pattern + strcspn(pattern, ":"),
+                         str, str + strlen(str));
 }
 
 bool UnitTestOptions::MatchesFilter(
@@ -596,41 +622,123 @@ bool UnitTestOptions::MatchesFilter(
   }
 }
 
-// Returns true iff the user-specified filter matches the test case
-// name and the test name.
-bool UnitTestOptions::FilterMatchesTest(const std::string &test_case_name,
-                                        const std::string &test_name) {
-  const std::string& full_name = test_case_name + "." + test_name.c_str();
-#ifdef _CUTEST_IMPL
-  return UnitTestOptions::FilterMatchesTest(full_name);
-}
-
-bool UnitTestOptions::FilterMatchesTest(const std::string &full_name) {
-#endif
+TestFilter::TestFilter(const std::string& filter) : filter_(filter) {
   // Split --gtest_filter at '-', if there is one, to separate into
   // positive filter and negative filter portions
-  const char* const p = GTEST_FLAG(filter).c_str();
+  const char* const p = filter_.c_str();
+  const char* const end = p + strlen(p);
   const char* const dash = strchr(p, '-');
-  std::string positive;
-  std::string negative;
   if (dash == NULL) {
-    positive = GTEST_FLAG(filter).c_str();  // Whole string is a positive filter
-    negative = "";
+    positive_.Parse(p, end);  // Whole string is a positive filter
   } else {
-    positive = std::string(p, dash);   // Everything up to the dash
-    negative = std::string(dash + 1);  // Everything after the dash
-    if (positive.empty()) {
+    if (dash == p) {
       // Treat '-test1' as the same as '*-test1'
-      positive = kUniversalFilter;
+      positive_.Parse(kUniversalFilter,
+                      kUniversalFilter + strlen(kUniversalFilter));
+    } else {
+      positive_.Parse(p, dash);  // Everything up to the dash
     }
+    negative_.Parse(dash + 1, end);  // Everything after the dash
   }
+}
 
-  // A filter is a colon-separated list of patterns.  It matches a
-  // test if any pattern in it matches the test.
-  return (MatchesFilter(full_name, positive.c_str()) &&
-          !MatchesFilter(full_name, negative.c_str()));
+bool TestFilter::Matches(const std::string& full_name) const {
+  return positive_.Matches(full_name) && !negative_.Matches(full_name);
 }
 
+void TestFilter::PatternList::Parse(const char* begin, const char* end) {
+  literals_.clear();
+  wildcards_.clear();
+
+  for (;;) {
+    const char* const colon = std::find(begin, end, ':');
+    const std::string pattern(begin, colon);
+    if (pattern.find_first_of("*?") == std::string::npos) {
+      literals_.push_back(pattern);
+    } else {
+      wildcards_.push_back(pattern);
+    }
+
+    if (colon == end) {
+      break;
+    }
+    begin = colon + 1;
+  }
+
+  std::sort(literals_.begin(), literals_.end());
+  literals_.erase(std::unique(literals_.begin(), literals_.end()),
+                  literals_.end());
+}
+
+bool TestFilter::PatternList::Matches(const std::string& name) const {
+  if (std::binary_search(literals_.begin(), literals_.end(), name)) {
+    return true;
+  }
+
+  const char* const str = name.c_str();
+  const char* const str_end = str + name.length();
+  for (size_t i = 0; i < wildcards_.size(); ++i) {
+    const std::string& pattern = wildcards_[i];
+    if (WildcardMatches(pattern.c_str(), pattern.c_str() + pattern.length(),
+                        str, str_end)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+
+// Guards the compiled filter below.  Test suites may be built on more
+// than one thread.
+GTEST_DEFINE_STATIC_MUTEX_(g_filter_mutex);
+
+// Returns GTEST_FLAG(filter) compiled into a TestFilter, recompiling it
+// only when the flag has changed since the last call.  Comparing the
+// flag costs a memcmp() of its length, which is far cheaper than
+// splitting it again.  g_filter_mutex must be held.
+const TestFilter& CompiledFilter() {
+  static TestFilter* compiled = NULL;
+  if (compiled == NULL || compiled->filter() != GTEST_FLAG(filter)) {
+    delete compiled;
+    compiled = new TestFilter(GTEST_FLAG(filter));
+  }
+  return *compiled;
+}
+
+// Reused to build "TestCaseName.TestName" without allocating for every
+// test.  g_filter_mutex must be held.
+std::string& FullNameBuffer() {
+  static std::string* buffer = new std::string;
+  return *buffer;
+}
+
+}  // namespace
+
+// Returns true iff the user-specified filter matches the test case
+// name and the test name.
+bool UnitTestOptions::FilterMatchesTest(const std::string &test_case_name,
+                                        const std::string &test_name) {
+  return FilterMatchesTest(test_case_name.c_str(), test_name.c_str());
+}
+
+bool UnitTestOptions::FilterMatchesTest(const char *test_case_name,
+                                        const char *test_name) {
+  MutexLock lock(&g_filter_mutex);
+  std::string& full_name = FullNameBuffer();
+  full_name.assign(test_case_name);
+  full_name += '.';
+  full_name += test_name;
+  return CompiledFilter().Matches(full_name);
+}
+
+#ifdef _CUTEST_IMPL
+bool UnitTestOptions::FilterMatchesTest(const std::string &full_name) {
+  MutexLock lock(&g_filter_mutex);
+  return CompiledFilter().Matches(full_name);
+}
+#endif
+
 #if GTEST_HAS_SEH
 // Returns EXCEPTION_EXECUTE_HANDLER if Google Test should handle the
 // given SEH exception, or EXCEPTION_CONTINUE_SEARCH otherwise.
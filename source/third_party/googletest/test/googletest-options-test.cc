@@ -116,6 +116,100 @@ TEST(OutputFileHelpersTest, GetCurrentExecutableName) {
     FAIL() << "GetCurrentExecutableName() returns " << exe_str;
 }
 
+// Testing UnitTestOptions::PatternMatchesString.
+
+TEST(PatternMatchesStringTest, QuestionMarkMatchesExactlyOneCharacter) {
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("a?c", "abc"));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("???", "xyz"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("a?c", "ac"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("a?c", "abbc"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("?", ""));
+}
+
+TEST(PatternMatchesStringTest, SeveralStarsInOnePattern) {
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("*a*b*", "xaybz"));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("a*b*c", "abc"));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("a*b*c", "aXbYbZc"));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("*ab*ab", "xabyabab"));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("**", ""));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("*?*", "a"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("a*b*c", "acb"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("a*b*c", "abcabd"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("*.*.*", "A.B"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("*?*", ""));
+}
+
+TEST(PatternMatchesStringTest, ColonEndsThePattern) {
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("abc:def", "abc"));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("abc:def", "def"));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString("", ""));
+  EXPECT_TRUE(UnitTestOptions::PatternMatchesString(":abc", ""));
+  EXPECT_FALSE(UnitTestOptions::PatternMatchesString("", "a"));
+}
+
+// Testing UnitTestOptions::FilterMatchesTest.
+
+class FilterMatchesTestTest : public Test {
+ protected:
+  bool Matches(const char* filter, const char* test_case_name,
+               const char* test_name) {
+    GTEST_FLAG(filter) = filter;
+    return UnitTestOptions::FilterMatchesTest(test_case_name, test_name);
+  }
+
+ private:
+  // Restores GTEST_FLAG(filter) for the tests that follow.
+  GTestFlagSaver saver_;
+};
+
+TEST_F(FilterMatchesTestTest, NegativeOnlyFilterMatchesEverythingElse) {
+  EXPECT_FALSE(Matches("-A.*", "A", "b"));
+  EXPECT_TRUE(Matches("-A.*", "B", "b"));
+  EXPECT_TRUE(Matches("-A.*", "AB", "b"));
+  EXPECT_FALSE(Matches("-A.*:B.b", "B", "b"));
+  EXPECT_TRUE(Matches("-A.*:B.b", "B", "c"));
+}
+
+TEST_F(FilterMatchesTestTest, EmptyPositivePattern) {
+  // An empty filter only matches an empty name, which no test has.
+  EXPECT_FALSE(Matches("", "A", "b"));
+  // An empty pattern in a list adds nothing to the other patterns.
+  EXPECT_TRUE(Matches("A.b:", "A", "b"));
+  EXPECT_FALSE(Matches("A.b:", "A", "c"));
+  EXPECT_TRUE(Matches(":A.*", "A", "c"));
+  // An empty negative part excludes nothing.
+  EXPECT_TRUE(Matches("A.*-", "A", "b"));
+}
+
+TEST_F(FilterMatchesTestTest, ListMixingLiteralsAndWildcards) {
+  const char* const filter = "C.d:A.*:B.b?:C.d:*.e";
+  EXPECT_TRUE(Matches(filter, "A", "x"));
+  EXPECT_TRUE(Matches(filter, "B", "b1"));
+  EXPECT_TRUE(Matches(filter, "C", "d"));
+  EXPECT_TRUE(Matches(filter, "D", "e"));
+  EXPECT_FALSE(Matches(filter, "B", "b"));
+  EXPECT_FALSE(Matches(filter, "C", "dd"));
+  EXPECT_FALSE(Matches(filter, "D", "f"));
+
+  // Literals and wildcards in the negative part.
+  EXPECT_FALSE(Matches("*-A.b:B.*", "A", "b"));
+  EXPECT_FALSE(Matches("*-A.b:B.*", "B", "x"));
+  EXPECT_TRUE(Matches("*-A.b:B.*", "A", "c"));
+}
+
+TEST_F(FilterMatchesTestTest, FilterIsRebuiltWhenTheFlagChanges) {
+  EXPECT_TRUE(Matches("A.*", "A", "b"));
+  EXPECT_FALSE(Matches("A.*", "B", "b"));
+
+  // Same length, different patterns.
+  EXPECT_FALSE(Matches("B.*", "A", "b"));
+  EXPECT_TRUE(Matches("B.*", "B", "b"));
+
+  EXPECT_TRUE(Matches("B.*:A.b", "A", "b"));
+  EXPECT_FALSE(Matches("B.*-B.b", "B", "b"));
+  EXPECT_TRUE(Matches("A.*", "A", "b"));
+}
+
 #if !GTEST_OS_FUCHSIA
 
 class XmlOutputChangeDirTest : public Test {